@@ -15,6 +15,7 @@ struct PS_In {
 	float3 worldPos : TEXCOORD0;
 	float4 materialWeights[2] : TEXCOORD1;
     float fog : TEXCOORD3;
+    float alpha : TEXCOORD4;
 };
 
 //
@@ -85,7 +86,7 @@ PS_Out main(PS_In input)
     //  Put it all together.
     //
 	PS_Out output;
-	output.color = float4(blendColor * saturate(AmbientColor + diffuse), Transparency);
+	output.color = float4(blendColor * saturate(AmbientColor + diffuse), input.alpha);
 
 	return output;
 }
@@ -9,6 +9,7 @@ struct VS_In {
 	float3 position : POSITION;
 	uint normal : NORMAL;
 	uint2 material : TEXCOORD0;
+	float4 instance : INSTANCE;
 };
 
 struct VS_Out {
@@ -17,6 +18,7 @@ struct VS_Out {
 	float3 worldPos : TEXCOORD0;
 	float4 materialWeights[2] : TEXCOORD1;
     float fog : TEXCOORD3;
+    float alpha : TEXCOORD4;
     float clip : SV_ClipDistance;
 };
 
@@ -25,22 +27,21 @@ struct VS_Out {
 //
 //  To save memory the vertex format is compacted, so this performs the unpacking
 //  before passing the values to the pixel shader. Both the normal and material
-//  weights are packed.
+//  weights are packed. The world offset and alpha of the mesh come from the
+//  per-instance data.
 //
 VS_Out main(VS_In input)
 {
 	VS_Out output;
 
-	float4x4 finalMatrix = mul(WorldMatrix, ProjectionViewMatrix);
-	
-	float3 pos = input.position.xyz;
-	output.position = mul(float4(pos, 1.0f), finalMatrix);
+	float3 pos = input.position.xyz + input.instance.xyz;
+	output.position = mul(float4(pos, 1.0f), ProjectionViewMatrix);
 
 	uint3 unpackedNormal = uint3((input.normal >> 24) & 0xFF, 
 								 (input.normal >> 16) & 0xFF, 
 								  input.normal & 0xFF);
 	output.normal = normalize((float3(unpackedNormal) - 127.0f) / 128.0f);
-	output.worldPos = mul(float4(input.position.xyz, 1.0f), WorldMatrix);
+	output.worldPos = pos;
 	output.materialWeights[0] = float4(
 		float((input.material.x >> 24) & 0xFF) / 255.0f,
 		float((input.material.x >> 16) & 0xFF) / 255.0f,
@@ -52,6 +53,7 @@ VS_Out main(VS_In input)
 		float((input.material.y >> 8) & 0xFF) / 255.0f,
 		float((input.material.y >> 0) & 0xFF) / 255.0f);
     output.fog = 0;
+    output.alpha = input.instance.w;
     output.clip = dot(ClipPlane, float4(output.worldPos, 1.0f));
     //output.clip = output.worldPos.y - 1000.0f;
     //output.clip = 1.0f;
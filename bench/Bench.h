@@ -0,0 +1,52 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef __NYX_BENCH_H__
+#define __NYX_BENCH_H__
+
+//
+//  Returns the current time in seconds.
+//
+inline double GetBenchTime()
+{
+    uint64_t time, freq;
+    QueryPerformanceCounter(reinterpret_cast<LARGE_INTEGER*>(&time));
+    QueryPerformanceFrequency(reinterpret_cast<LARGE_INTEGER*>(&freq));
+    return static_cast<double>(time) / static_cast<double>(freq);
+}
+
+//
+//  Benchmarks VoxelField loading and cell listing at each chunk size.
+//
+void RunVoxelFieldBench();
+
+//
+//  Benchmarks the scalar and batched frustum tests against each other.
+//
+void RunFrustumBench();
+
+//
+//  Benchmarks render op sorting with std::sort, radix sorting and reuse of
+//  the previous frame's order.
+//
+void RunRenderQueueBench();
+
+//
+//  Checks the buddy allocator behind the mesh heap, then measures how its
+//  free space fragments under mesh-like load and eviction.
+//
+void RunBuddyAllocatorBench();
+
+//
+//  Times the core CPU kernels on fixed, seeded inputs, and writes the
+//  results as JSON so that runs can be compared with each other.
+//
+//  Parameters:
+//      [in] path
+//          Path of the JSON file to write.
+//
+void RunKernelBench(const char* path);
+
+#endif  // __NYX_BENCH_H__
@@ -0,0 +1,195 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Prefix.h"
+#include "Bench.h"
+#include "BuddyAllocator.h"
+
+//
+//  Size of the allocator, matching a vertex page of the mesh heap.
+//
+static const size_t Capacity = 1 << 18;
+
+//
+//  Smallest block, matching the vertex pool of the mesh heap.
+//
+static const size_t MinBlockSize = 64;
+
+//
+//  Number of allocate/free operations in the churn test.
+//
+static const size_t ChurnOperations = 1000000;
+
+//
+//  Operations between fragmentation samples in the churn test.
+//
+static const size_t SampleInterval = 100000;
+
+//
+//  Returns a random size shaped like chunk meshes: mostly a few thousand
+//  vertices, with a long tail of large ones.
+//
+static size_t RandomMeshSize()
+{
+    size_t size = 256 + rand() % 4096;
+    if (rand() % 16 == 0)
+    {
+        size *= 4;
+    }
+    return size;
+}
+
+//
+//  Checks that the live allocations don't overlap and lie within the
+//  allocator, and that the allocator's totals agree with them.
+//
+static void CheckAllocations(const BuddyAllocator& allocator,
+                             const std::vector<std::pair<size_t, size_t>>& live)
+{
+    std::vector<std::pair<size_t, size_t>> sorted(live);
+    std::sort(sorted.begin(), sorted.end());
+    size_t allocated = 0;
+    for (size_t i = 0; i < sorted.size(); ++i)
+    {
+        size_t blockSize = allocator.GetBlockSize(sorted[i].first);
+        CHECK(SystemError, blockSize >= sorted[i].second);
+        CHECK(SystemError, sorted[i].first % blockSize == 0);
+        CHECK(SystemError, sorted[i].first + blockSize <= allocator.GetCapacity());
+        CHECK(SystemError, !i || sorted[i - 1].first + allocator.GetBlockSize(sorted[i - 1].first) <= sorted[i].first);
+        allocated += blockSize;
+    }
+    CHECK(SystemError, allocated == allocator.GetAllocatedSize());
+    CHECK(SystemError, sorted.size() == allocator.GetAllocationCount());
+}
+
+//
+//  Exercises the edge cases of allocation, splitting and merging.
+//
+static void RunAllocatorChecks()
+{
+    BuddyAllocator allocator(Capacity, MinBlockSize);
+    CHECK(SystemError, allocator.GetLargestFreeBlock() == Capacity);
+    CHECK(SystemError, allocator.GetFragmentation() == 0.0f);
+
+    //  Zero and oversized requests fail
+    CHECK(SystemError, allocator.Allocate(0) == BuddyAllocator::InvalidOffset);
+    CHECK(SystemError, allocator.Allocate(Capacity + 1) == BuddyAllocator::InvalidOffset);
+
+    //  The whole space can be allocated at once, and nothing else fits
+    size_t whole = allocator.Allocate(Capacity);
+    CHECK(SystemError, whole == 0 && allocator.GetLargestFreeBlock() == 0);
+    CHECK(SystemError, allocator.Allocate(1) == BuddyAllocator::InvalidOffset);
+    allocator.Free(whole);
+    CHECK(SystemError, allocator.GetLargestFreeBlock() == Capacity);
+
+    //  Sizes round up to a power of two no smaller than the minimum block
+    size_t small = allocator.Allocate(1);
+    CHECK(SystemError, allocator.GetBlockSize(small) == MinBlockSize);
+    size_t odd = allocator.Allocate(MinBlockSize * 3);
+    CHECK(SystemError, allocator.GetBlockSize(odd) == MinBlockSize * 4);
+    allocator.Free(small);
+    allocator.Free(odd);
+    CHECK(SystemError, allocator.GetLargestFreeBlock() == Capacity);
+
+    //  Filling with minimum blocks uses every block exactly once
+    std::vector<std::pair<size_t, size_t>> live;
+    for (;;)
+    {
+        size_t offset = allocator.Allocate(MinBlockSize);
+        if (offset == BuddyAllocator::InvalidOffset)
+        {
+            break;
+        }
+        live.push_back(std::make_pair(offset, MinBlockSize));
+    }
+    CHECK(SystemError, live.size() == Capacity / MinBlockSize);
+    CheckAllocations(allocator, live);
+
+    //  Freeing every other block leaves half the space free but unusable for
+    //  anything larger than a minimum block
+    for (size_t i = 0; i < live.size(); i += 2)
+    {
+        allocator.Free(live[i].first);
+    }
+    CHECK(SystemError, allocator.GetLargestFreeBlock() == MinBlockSize);
+    CHECK(SystemError, allocator.Allocate(MinBlockSize * 2) == BuddyAllocator::InvalidOffset);
+    CHECK(SystemError, allocator.GetFragmentation() > 0.99f);
+
+    //  Freeing the rest merges everything back into one block
+    for (size_t i = 1; i < live.size(); i += 2)
+    {
+        allocator.Free(live[i].first);
+    }
+    CHECK(SystemError, allocator.GetAllocatedSize() == 0);
+    CHECK(SystemError, allocator.GetLargestFreeBlock() == Capacity);
+    CHECK(SystemError, allocator.GetFragmentation() == 0.0f);
+
+    printf("\nBuddy allocator checks passed\n");
+}
+
+//
+//  Loads and evicts random meshes at random, as the voxel manager does when
+//  flying over terrain, and reports how the free space fragments.
+//
+static void RunAllocatorChurn()
+{
+    BuddyAllocator allocator(Capacity, MinBlockSize);
+    std::vector<std::pair<size_t, size_t>> live;
+    size_t requested = 0, failures = 0;
+
+    printf("\nBuddy allocator churn (%u operations)\n", static_cast<uint>(ChurnOperations));
+    printf("%10s  %8s  %10s  %10s  %12s  %9s\n", "ops", "live", "occupancy", "rounding", "largest free", "fragment");
+
+    double time = 0;
+    for (size_t op = 0; op < ChurnOperations; ++op)
+    {
+        //  Keep the allocator around three quarters full
+        double t0 = GetBenchTime();
+        if (allocator.GetAllocatedSize() < Capacity * 3 / 4 || live.empty())
+        {
+            size_t size = RandomMeshSize();
+            size_t offset = allocator.Allocate(size);
+            if (offset != BuddyAllocator::InvalidOffset)
+            {
+                live.push_back(std::make_pair(offset, size));
+                requested += size;
+            }
+            else
+            {
+                ++failures;
+            }
+        }
+        else
+        {
+            size_t index = rand() % live.size();
+            allocator.Free(live[index].first);
+            requested -= live[index].second;
+            live[index] = live.back();
+            live.pop_back();
+        }
+        time += GetBenchTime() - t0;
+
+        if ((op + 1) % SampleInterval == 0)
+        {
+            CheckAllocations(allocator, live);
+            printf("%10u  %8u  %9.2f%%  %9.2f%%  %12u  %8.2f%%\n",
+                   static_cast<uint>(op + 1),
+                   static_cast<uint>(live.size()),
+                   100.0 * allocator.GetAllocatedSize() / Capacity,
+                   100.0 * (1.0 - static_cast<double>(requested) / allocator.GetAllocatedSize()),
+                   static_cast<uint>(allocator.GetLargestFreeBlock()),
+                   100.0 * allocator.GetFragmentation());
+        }
+    }
+    printf("Failed allocations: %u\n", static_cast<uint>(failures));
+    printf("Time per operation: %.2f ns\n", 1.0e9 * time / ChurnOperations);
+}
+
+void RunBuddyAllocatorBench()
+{
+    srand(1);
+    RunAllocatorChecks();
+    RunAllocatorChurn();
+}
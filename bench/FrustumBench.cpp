@@ -0,0 +1,112 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Prefix.h"
+#include "Bench.h"
+#include "Frustum.h"
+
+//
+//  Number of parent nodes along each horizontal axis.
+//
+static const size_t GridSize = 32;
+
+//
+//  Size of a parent node.
+//
+static const float NodeSize = 64.0f;
+
+//
+//  Minimum time to spend measuring each path, in seconds.
+//
+static const double MinBenchTime = 1.0;
+
+void RunFrustumBench()
+{
+    //  The camera looks along Z from just above the middle of the grid, so
+    //  roughly a third of the nodes are visible.
+    float4x4 viewMatrix = float4x4::Translation(float3(0.0f, -40.0f, 0.0f));
+    float4x4 projectionMatrix = float4x4::PerspectiveProjection(XM_PI / 3.0f,
+                                                                16.0f / 9.0f,
+                                                                1.0f,
+                                                                4000.0f);
+    Frustum frustum(viewMatrix * projectionMatrix);
+
+    //  Each parent contributes its eight children, as in VoxelManager::UpdateNode
+    std::vector<box3f> boxes;
+    std::vector<BoxBatch> batches;
+    for (size_t z = 0; z < GridSize; ++z)
+    {
+        for (size_t x = 0; x < GridSize; ++x)
+        {
+            float3 position((x - (GridSize / 2.0f)) * NodeSize,
+                            0.0f,
+                            (z - (GridSize / 2.0f)) * NodeSize);
+            float3 childSize = float3(NodeSize, NodeSize, NodeSize) * 0.5f;
+
+            BoxBatch batch;
+            for (size_t i = 0; i < 8; ++i)
+            {
+                float3 offset(static_cast<float>(i & 1),
+                              static_cast<float>((i >> 1) & 1),
+                              static_cast<float>((i >> 2) & 1));
+                float3 childPosition = position + (offset * childSize);
+                box3f box(childPosition, childPosition + childSize);
+                boxes.push_back(box);
+                batch.Set(i, box);
+            }
+            batches.push_back(batch);
+        }
+    }
+
+    //  Both paths must agree before their speeds are worth comparing
+    size_t visibleCount = 0;
+    for (size_t i = 0; i < batches.size(); ++i)
+    {
+        uint32_t mask = frustum.IntersectsBatch(batches[i], 8);
+        for (size_t j = 0; j < 8; ++j)
+        {
+            bool visible = frustum.Intersects(boxes[(i * 8) + j]);
+            CHECK(SystemError, visible == ((mask & (1 << j)) != 0));
+            visibleCount += visible ? 1 : 0;
+        }
+    }
+
+    //  The results are accumulated so the tests can't be optimized away.
+    size_t scalarCount = 0, scalarBoxes = 0;
+    double scalarTime = 0;
+    while (scalarTime < MinBenchTime)
+    {
+        double t0 = GetBenchTime();
+        for (size_t i = 0; i < boxes.size(); ++i)
+        {
+            scalarCount += frustum.Intersects(boxes[i]) ? 1 : 0;
+        }
+        scalarTime += GetBenchTime() - t0;
+        scalarBoxes += boxes.size();
+    }
+
+    size_t batchCount = 0, batchBoxes = 0;
+    double batchTime = 0;
+    while (batchTime < MinBenchTime)
+    {
+        double t0 = GetBenchTime();
+        for (size_t i = 0; i < batches.size(); ++i)
+        {
+            batchCount += frustum.IntersectsBatch(batches[i], 8);
+        }
+        batchTime += GetBenchTime() - t0;
+        batchBoxes += batches.size() * 8;
+    }
+
+    double scalarRate = scalarBoxes / scalarTime;
+    double batchRate = batchBoxes / batchTime;
+    printf("\nFrustum (%u boxes, %.1f%% visible, checksum %u)\n",
+           static_cast<uint>(boxes.size()),
+           (visibleCount * 100.0) / boxes.size(),
+           static_cast<uint>(scalarCount + batchCount));
+    printf("%8s  %12s  %10s  %8s\n", "path", "Mboxes/s", "ns/box", "speedup");
+    printf("%8s  %12.2f  %10.2f  %7.2fx\n", "scalar", scalarRate / 1.0e6, 1.0e9 / scalarRate, 1.0);
+    printf("%8s  %12.2f  %10.2f  %7.2fx\n", "batch", batchRate / 1.0e6, 1.0e9 / batchRate, batchRate / scalarRate);
+}
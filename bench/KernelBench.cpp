@@ -0,0 +1,387 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Prefix.h"
+#include "Bench.h"
+#include "Camera.h"
+#include "Frustum.h"
+#include "Noise.h"
+#include "Random.h"
+#include "RenderQueue.h"
+#include "ScratchArena.h"
+#include "VoxelField.h"
+#include "VoxelManager.h"
+
+//
+//  Seed for every input, so that runs on any machine measure the same work.
+//
+static const uint32_t KernelSeed = 1;
+
+//
+//  Minimum time to spend measuring each kernel, and the number of calls
+//  timed together as one sample, in seconds.
+//
+static const double MinKernelTime = 0.5;
+static const double MinSampleTime = 0.005;
+
+//
+//  Size of the chunks classified, and the number of distinct chunks.
+//
+static const size_t ChunkSize = 32;
+static const size_t ChunkCount = 8;
+
+//
+//  Number of ops sorted per frame, as in a busy VoxelRenderer::Flush.
+//
+static const size_t RenderOpCount = 10000;
+
+//
+//  Results are accumulated here so that no kernel can be optimized away.
+//
+static volatile double s_sink;
+
+//
+//  The measurements of one kernel.
+//
+struct KernelResult
+{
+    const char* name;
+    const char* unit;
+    size_t itemsPerCall;
+    uint64_t callCount;
+    double medianNanoseconds;
+    double bestNanoseconds;
+};
+
+//
+//  Returns a random float in [0, 1).
+//
+static float RandomFloat(uint32_t& state)
+{
+    return static_cast<float>(NextRandom(state)) / 16777216.0f;
+}
+
+//
+//  Returns a random point in a box. The components are drawn in order, since
+//  the order in which arguments are evaluated varies between compilers.
+//
+static float3 RandomPoint(uint32_t& state, const float3& origin, const float3& size)
+{
+    float x = RandomFloat(state);
+    float y = RandomFloat(state);
+    float z = RandomFloat(state);
+    return origin + (float3(x, y, z) * size);
+}
+
+//
+//  Times a kernel. Calls are grouped into samples long enough for the timer,
+//  and the median and best time per item across the samples are kept.
+//
+//  Parameters:
+//      [in] results
+//          List to append the measurements to.
+//      [in] name
+//          Name of the kernel.
+//      [in] unit
+//          What one item of work is.
+//      [in] itemsPerCall
+//          Items of work done by each call.
+//      [in] kernel
+//          Function which does the work and returns a checksum of it.
+//
+template <typename Kernel>
+static void MeasureKernel(std::vector<KernelResult>& results,
+                          const char* name,
+                          const char* unit,
+                          size_t itemsPerCall,
+                          Kernel kernel)
+{
+    //  Warm up, and size the samples
+    size_t callsPerSample = 1;
+    for (;;)
+    {
+        double t0 = GetBenchTime();
+        for (size_t i = 0; i < callsPerSample; ++i)
+        {
+            s_sink = s_sink + kernel();
+        }
+        if (GetBenchTime() - t0 >= MinSampleTime)
+        {
+            break;
+        }
+        callsPerSample *= 2;
+    }
+
+    std::vector<double> samples;
+    double totalTime = 0;
+    while (totalTime < MinKernelTime)
+    {
+        double t0 = GetBenchTime();
+        for (size_t i = 0; i < callsPerSample; ++i)
+        {
+            s_sink = s_sink + kernel();
+        }
+        double time = GetBenchTime() - t0;
+        totalTime += time;
+        samples.push_back((time * 1.0e9) / (static_cast<double>(callsPerSample) * itemsPerCall));
+    }
+    std::sort(samples.begin(), samples.end());
+
+    KernelResult result =
+    {
+        name,
+        unit,
+        itemsPerCall,
+        static_cast<uint64_t>(callsPerSample) * samples.size(),
+        samples[samples.size() / 2],
+        samples[0]
+    };
+    results.push_back(result);
+    printf("%-32s  %12.2f  %12.2f  %10.2f  %s\n",
+           name,
+           result.medianNanoseconds,
+           result.bestNanoseconds,
+           1.0e3 / result.medianNanoseconds,
+           unit);
+}
+
+//
+//  Writes the measurements as JSON.
+//
+static void WriteKernelResults(const std::vector<KernelResult>& results, const char* path)
+{
+    FILE* file = nullptr;
+    CHECK(SystemError, fopen_s(&file, path, "w") == 0 && file);
+
+#ifdef _DEBUG
+    const char* configuration = "Debug";
+#else
+    const char* configuration = "Release";
+#endif
+    fprintf(file,
+            "{\n  \"seed\": %u,\n  \"configuration\": \"%s\",\n  \"kernels\": [\n",
+            KernelSeed,
+            configuration);
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const KernelResult& result = results[i];
+        fprintf(file,
+                "    {\"name\": \"%s\", \"unit\": \"%s\", \"items_per_call\": %u, \"calls\": %llu, "
+                "\"median_ns_per_item\": %.4f, \"best_ns_per_item\": %.4f}%s\n",
+                result.name,
+                result.unit,
+                static_cast<uint>(result.itemsPerCall),
+                static_cast<unsigned long long>(result.callCount),
+                result.medianNanoseconds,
+                result.bestNanoseconds,
+                (i + 1 < results.size()) ? "," : "");
+    }
+    fputs("  ]\n}\n", file);
+    fclose(file);
+}
+
+void RunKernelBench(const char* path)
+{
+    printf("\nKernels (seed %u)\n", KernelSeed);
+    printf("%-32s  %12s  %12s  %10s  %s\n", "kernel", "median ns", "best ns", "M/s", "per");
+
+    std::vector<KernelResult> results;
+    uint32_t state = KernelSeed;
+    Noise noise(KernelSeed);
+
+    //  Noise
+    std::vector<float3> points(4096);
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        points[i] = RandomPoint(state, float3(0.0f, 0.0f, 0.0f), float3(64.0f, 64.0f, 64.0f));
+    }
+    MeasureKernel(results, "Noise::Sample", "sample", points.size(), [&]() -> double
+    {
+        float sum = 0;
+        for (size_t i = 0; i < points.size(); ++i)
+        {
+            sum += noise.Sample(points[i].x, points[i].y, points[i].z);
+        }
+        return sum;
+    });
+
+    std::vector<float> grid(ChunkSize * ChunkSize * ChunkSize);
+    MeasureKernel(results, "Noise::Fill", "sample", grid.size(), [&]() -> double
+    {
+        noise.Fill(grid.data(), ChunkSize, ChunkSize, ChunkSize, 1.0f / 32.0f, 1.0f / 32.0f, 1.0f / 32.0f);
+        return grid[0];
+    });
+
+    //  Frustum tests against the children of a grid of nodes around a camera
+    //  looking along Z, as in VoxelManager::UpdateNode
+    Camera camera;
+    camera.SetProjectionMatrix(float4x4::PerspectiveProjection(XM_PI / 3.0f, 4.0f / 3.0f, 1.0f, 32000.0f));
+    camera.SetPosition(float3(0.0f, 40.0f, 0.0f));
+    Frustum frustum = camera.GetFrustum();
+    std::vector<box3f> boxes;
+    std::vector<BoxBatch> batches(512);
+    for (size_t i = 0; i < batches.size(); ++i)
+    {
+        float3 position = RandomPoint(state, float3(-2048.0f, -128.0f, -2048.0f), float3(4096.0f, 256.0f, 4096.0f));
+        for (size_t j = 0; j < 8; ++j)
+        {
+            float3 offset(static_cast<float>(j & 1),
+                          static_cast<float>((j >> 1) & 1),
+                          static_cast<float>((j >> 2) & 1));
+            float3 childPosition = position + (offset * 32.0f);
+            box3f box(childPosition, childPosition + float3(32.0f, 32.0f, 32.0f));
+            boxes.push_back(box);
+            batches[i].Set(j, box);
+        }
+    }
+    MeasureKernel(results, "Frustum::Intersects", "box", boxes.size(), [&]() -> double
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < boxes.size(); ++i)
+        {
+            count += frustum.Intersects(boxes[i]) ? 1 : 0;
+        }
+        return static_cast<double>(count);
+    });
+    MeasureKernel(results, "Frustum::IntersectsBatch", "box", boxes.size(), [&]() -> double
+    {
+        uint32_t count = 0;
+        for (size_t i = 0; i < batches.size(); ++i)
+        {
+            count += frustum.IntersectsBatch(batches[i], 8);
+        }
+        return static_cast<double>(count);
+    });
+
+    //  Matrices and the camera
+    std::vector<float4x4> matrices(1024);
+    std::vector<float3> positions(1024);
+    for (size_t i = 0; i < matrices.size(); ++i)
+    {
+        float pitch = RandomFloat(state) * XM_PI;
+        float yaw = RandomFloat(state) * XM_2PI;
+        float4 rotation = float4::RotationQuaternion(pitch, yaw, 0.0f);
+        positions[i] = RandomPoint(state, float3(0.0f, 0.0f, 0.0f), float3(4096.0f, 2048.0f, 4096.0f));
+        matrices[i] = float4x4::Translation(-positions[i]) * float4x4::Rotation(rotation);
+    }
+    MeasureKernel(results, "float4x4 multiply", "product", matrices.size() - 1, [&]() -> double
+    {
+        float sum = 0;
+        for (size_t i = 0; i + 1 < matrices.size(); ++i)
+        {
+            float4x4 product = matrices[i] * matrices[i + 1];
+            sum += product[3].x;
+        }
+        return sum;
+    });
+    MeasureKernel(results, "Camera::Update", "update", positions.size(), [&]() -> double
+    {
+        float sum = 0;
+        for (size_t i = 0; i < positions.size(); ++i)
+        {
+            camera.SetPosition(positions[i]);
+            sum += camera.GetCombinedMatrix()[3].x;
+        }
+        return sum;
+    });
+
+    //  Node IDs for the children of every node in a two-level tree
+    MeasureKernel(results, "VoxelManager::MakeNodeId", "id", 64 * 64 * 8, [&]() -> double
+    {
+        uint64_t hash = 0;
+        for (int16_t z = 0; z < 64; ++z)
+        {
+            for (int16_t x = 0; x < 64; ++x)
+            {
+                for (size_t i = 0; i < 8; ++i)
+                {
+                    hash ^= VoxelManager::MakeNodeId(static_cast<int16_t>(x - 32),
+                                                     static_cast<int16_t>(z - 32),
+                                                     0,
+                                                     1,
+                                                     i & 1,
+                                                     (i >> 1) & 1,
+                                                     (i >> 2) & 1);
+                }
+            }
+        }
+        return static_cast<double>(hash & 0xFFFFFFFF);
+    });
+
+    //  Marching cubes classification of terrain chunks straddling the surface
+    typedef VoxelField<ChunkSize> Field;
+    std::vector<std::vector<float>> chunks(ChunkCount);
+    for (size_t i = 0; i < ChunkCount; ++i)
+    {
+        chunks[i].resize(ChunkSize * ChunkSize * ChunkSize);
+        for (size_t z = 0; z < ChunkSize; ++z)
+        {
+            for (size_t y = 0; y < ChunkSize; ++y)
+            {
+                for (size_t x = 0; x < ChunkSize; ++x)
+                {
+                    float3 p(static_cast<float>(x + (i * ChunkSize)),
+                             static_cast<float>(y),
+                             static_cast<float>(z));
+                    chunks[i][(((z * ChunkSize) + y) * ChunkSize) + x] = ((ChunkSize / 2.0f) - p.y) +
+                                                                         (noise.Sample(p.x / 32.0f, p.y / 32.0f, p.z / 32.0f) * 16.0f);
+                }
+            }
+        }
+    }
+    ScratchArena arena(0);
+    size_t chunk = 0;
+    MeasureKernel(results, "VoxelField<32>::Load+ListCells", "cell", ChunkSize * ChunkSize * ChunkSize, [&]() -> double
+    {
+        arena.Reset();
+        Field* field = new (arena.Allocate(sizeof(Field))) Field(arena,
+                                                                 float3(ChunkSize - 2.0f, ChunkSize - 2.0f, ChunkSize - 2.0f),
+                                                                 float3(1.0f, 1.0f, 1.0f));
+        field->Load(chunks[chunk].data(), ChunkSize * sizeof(float), ChunkSize * ChunkSize * sizeof(float));
+        chunk = (chunk + 1) % ChunkCount;
+        uint32_t* cells;
+        return static_cast<double>(field->ListCells(arena, cells));
+    });
+
+    //  Render op sorting as VoxelRenderer::Flush does it, with the camera
+    //  moving a little each frame. Dropping an op every other frame forces
+    //  the radix path.
+    std::vector<float3> opPositions(RenderOpCount);
+    std::vector<RenderQueue::Pass> opPasses(RenderOpCount);
+    for (size_t i = 0; i < RenderOpCount; ++i)
+    {
+        opPositions[i] = RandomPoint(state, float3(0.0f, 0.0f, 0.0f), float3(8192.0f, 256.0f, 8192.0f));
+        float r = RandomFloat(state);
+        opPasses[i] = (r < 0.8f) ? RenderQueue::Pass_Opaque :
+                      (r < 0.9f) ? RenderQueue::Pass_GapFiller :
+                                   RenderQueue::Pass_Transparent;
+    }
+    RenderQueue queue;
+    size_t frame = 0;
+    auto sortFrame = [&](size_t count) -> double
+    {
+        float3 cameraPos(frame * 10.0f, 100.0f, 4096.0f);
+        ++frame;
+        queue.Clear();
+        for (size_t i = 0; i < count; ++i)
+        {
+            float3 diff = opPositions[i] - cameraPos;
+            queue.Add(opPasses[i], Dot(diff, diff));
+        }
+        queue.Sort();
+        return queue.GetIndex(0);
+    };
+    MeasureKernel(results, "RenderQueue::Sort (radix)", "op", RenderOpCount, [&]() -> double
+    {
+        return sortFrame(RenderOpCount - (frame & 1));
+    });
+    MeasureKernel(results, "RenderQueue::Sort (coherent)", "op", RenderOpCount, [&]() -> double
+    {
+        return sortFrame(RenderOpCount);
+    });
+
+    WriteKernelResults(results, path);
+    printf("Results written to %s\n", path);
+}
@@ -0,0 +1,54 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Prefix.h"
+#include "Bench.h"
+
+//
+//  Default path of the kernel results.
+//
+static const char* DefaultKernelPath = "NyxBench.json";
+
+int main(int argc, char** argv)
+{
+    //  -kernels runs only the kernel suite, which is quick enough to compare
+    //  every change against
+    bool kernelsOnly = false;
+    const char* kernelPath = DefaultKernelPath;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-kernels") == 0)
+        {
+            kernelsOnly = true;
+        }
+        else if (strcmp(argv[i], "-json") == 0 && i + 1 < argc)
+        {
+            kernelPath = argv[++i];
+        }
+        else
+        {
+            fprintf(stderr, "Usage: NyxBench [-kernels] [-json path]\n");
+            return 1;
+        }
+    }
+
+    try
+    {
+        if (!kernelsOnly)
+        {
+            RunVoxelFieldBench();
+            RunFrustumBench();
+            RunRenderQueueBench();
+            RunBuddyAllocatorBench();
+        }
+        RunKernelBench(kernelPath);
+    }
+    catch (std::exception& e)
+    {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
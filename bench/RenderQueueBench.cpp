@@ -0,0 +1,205 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Prefix.h"
+#include "Bench.h"
+#include "RenderQueue.h"
+
+//
+//  Size of the area the ops are scattered over.
+//
+static const float WorldSize = 8192.0f;
+
+//
+//  Distance the camera moves each frame.
+//
+static const float CameraStep = 10.0f;
+
+//
+//  Minimum time to spend measuring each path, in seconds.
+//
+static const double MinBenchTime = 1.0;
+
+//
+//  A render op as VoxelRenderer queued them before RenderQueue, sorted with
+//  std::sort in one list per pass.
+//
+struct FatRenderOp
+{
+    const void* geometry;
+    float3 position;
+    float distance2;
+    float alpha;
+    bool gapFiller;
+};
+
+//
+//  Returns a random float in [0, 1).
+//
+static float RandomFloat()
+{
+    return static_cast<float>(rand()) / (static_cast<float>(RAND_MAX) + 1.0f);
+}
+
+//
+//  Returns the camera position for a frame.
+//
+static float3 GetCameraPosition(size_t frame)
+{
+    return float3(frame * CameraStep, 100.0f, WorldSize * 0.5f);
+}
+
+//
+//  Sorts the ops the way VoxelRenderer used to.
+//
+static void SortFat(std::array<std::vector<FatRenderOp>, RenderQueue::Pass_Count>& ops, float3 cameraPos)
+{
+    for (size_t pass = 0; pass < RenderQueue::Pass_Count; ++pass)
+    {
+        for (size_t i = 0; i < ops[pass].size(); ++i)
+        {
+            float3 diff = ops[pass][i].position - cameraPos;
+            ops[pass][i].distance2 = Dot(diff, diff);
+        }
+    }
+    auto opaqueSorter = [](const FatRenderOp& lhs, const FatRenderOp& rhs)
+    {
+        return lhs.distance2 < rhs.distance2;
+    };
+    auto transparentSorter = [](const FatRenderOp& lhs, const FatRenderOp& rhs)
+    {
+        return lhs.distance2 > rhs.distance2;
+    };
+    std::sort(ops[RenderQueue::Pass_Opaque].begin(), ops[RenderQueue::Pass_Opaque].end(), opaqueSorter);
+    std::sort(ops[RenderQueue::Pass_GapFiller].begin(), ops[RenderQueue::Pass_GapFiller].end(), opaqueSorter);
+    std::sort(ops[RenderQueue::Pass_Transparent].begin(), ops[RenderQueue::Pass_Transparent].end(), transparentSorter);
+}
+
+//
+//  Fills a render queue with the ops seen from a camera position.
+//
+static void FillQueue(RenderQueue& queue,
+                      const std::vector<float3>& positions,
+                      const std::vector<RenderQueue::Pass>& passes,
+                      size_t count,
+                      float3 cameraPos)
+{
+    queue.Clear();
+    for (size_t i = 0; i < count; ++i)
+    {
+        float3 diff = positions[i] - cameraPos;
+        queue.Add(passes[i], Dot(diff, diff));
+    }
+}
+
+//
+//  Measures one op count.
+//
+static void RunOpCount(size_t opCount)
+{
+    //  Mostly opaque ops, with a few gap fillers and transparent ops as when
+    //  nodes are fading.
+    std::vector<float3> positions(opCount);
+    std::vector<RenderQueue::Pass> passes(opCount);
+    std::array<std::vector<FatRenderOp>, RenderQueue::Pass_Count> fatOps;
+    for (size_t i = 0; i < opCount; ++i)
+    {
+        positions[i] = float3(RandomFloat() * WorldSize, RandomFloat() * 256.0f, RandomFloat() * WorldSize);
+        float r = RandomFloat();
+        passes[i] = (r < 0.8f) ? RenderQueue::Pass_Opaque :
+                    (r < 0.9f) ? RenderQueue::Pass_GapFiller :
+                                 RenderQueue::Pass_Transparent;
+        FatRenderOp op = {nullptr, positions[i], 0.0f, 1.0f, passes[i] == RenderQueue::Pass_GapFiller};
+        fatOps[passes[i]].push_back(op);
+    }
+
+    //  The queue must produce the same order as the fat sort, up to the
+    //  precision of its distance keys.
+    RenderQueue checkQueue;
+    for (size_t frame = 0; frame < 2; ++frame)
+    {
+        float3 cameraPos = GetCameraPosition(frame);
+        FillQueue(checkQueue, positions, passes, opCount, cameraPos);
+        checkQueue.Sort();
+        std::vector<bool> seen(opCount, false);
+        float lastDistance2 = 0;
+        for (size_t i = 0; i < opCount; ++i)
+        {
+            size_t index = checkQueue.GetIndex(i);
+            CHECK(SystemError, !seen[index] && checkQueue.GetPass(i) == passes[index]);
+            seen[index] = true;
+
+            float3 diff = positions[index] - cameraPos;
+            float distance2 = Dot(diff, diff);
+            if (i && checkQueue.GetPass(i) == checkQueue.GetPass(i - 1))
+            {
+                float tolerance = max(distance2, lastDistance2) * 1.0e-4f;
+                CHECK(SystemError, (passes[index] == RenderQueue::Pass_Transparent) ?
+                                   (distance2 <= lastDistance2 + tolerance) :
+                                   (distance2 + tolerance >= lastDistance2));
+            }
+            else if (i)
+            {
+                CHECK(SystemError, checkQueue.GetPass(i) > checkQueue.GetPass(i - 1));
+            }
+            lastDistance2 = distance2;
+        }
+    }
+
+    //  The camera moves a little each frame, as it does in flight.
+    size_t fatFrames = 0;
+    double fatTime = 0;
+    while (fatTime < MinBenchTime)
+    {
+        double t0 = GetBenchTime();
+        SortFat(fatOps, GetCameraPosition(fatFrames));
+        fatTime += GetBenchTime() - t0;
+        ++fatFrames;
+    }
+
+    //  Dropping one op every other frame defeats the coherent path
+    RenderQueue radixQueue;
+    size_t radixFrames = 0;
+    double radixTime = 0;
+    while (radixTime < MinBenchTime)
+    {
+        double t0 = GetBenchTime();
+        FillQueue(radixQueue, positions, passes, opCount - (radixFrames & 1), GetCameraPosition(radixFrames));
+        radixQueue.Sort();
+        radixTime += GetBenchTime() - t0;
+        ++radixFrames;
+    }
+
+    RenderQueue coherentQueue;
+    size_t coherentFrames = 0;
+    double coherentTime = 0;
+    while (coherentTime < MinBenchTime)
+    {
+        double t0 = GetBenchTime();
+        FillQueue(coherentQueue, positions, passes, opCount, GetCameraPosition(coherentFrames));
+        coherentQueue.Sort();
+        coherentTime += GetBenchTime() - t0;
+        ++coherentFrames;
+    }
+
+    double fatRate = fatFrames / fatTime;
+    double radixRate = radixFrames / radixTime;
+    double coherentRate = coherentFrames / coherentTime;
+    printf("\nRender queue (%u ops, %u/%u coherent sorts)\n",
+           static_cast<uint>(opCount),
+           static_cast<uint>(coherentQueue.GetCoherentSortCount()),
+           static_cast<uint>(coherentQueue.GetCoherentSortCount() + coherentQueue.GetRadixSortCount()));
+    printf("%10s  %12s  %10s  %8s\n", "path", "us/frame", "ns/op", "speedup");
+    printf("%10s  %12.2f  %10.2f  %7.2fx\n", "std::sort", 1.0e6 / fatRate, 1.0e9 / (fatRate * opCount), 1.0);
+    printf("%10s  %12.2f  %10.2f  %7.2fx\n", "radix", 1.0e6 / radixRate, 1.0e9 / (radixRate * opCount), radixRate / fatRate);
+    printf("%10s  %12.2f  %10.2f  %7.2fx\n", "coherent", 1.0e6 / coherentRate, 1.0e9 / (coherentRate * opCount), coherentRate / fatRate);
+}
+
+void RunRenderQueueBench()
+{
+    srand(1);
+    RunOpCount(10000);
+    RunOpCount(50000);
+}
@@ -0,0 +1,131 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Prefix.h"
+#include "Bench.h"
+#include "Noise.h"
+#include "ScratchArena.h"
+#include "VoxelField.h"
+
+//
+//  Number of distinct chunks generated for each size.
+//
+static const size_t ChunkCount = 16;
+
+//
+//  Minimum time to spend measuring each size, in seconds.
+//
+static const double MinBenchTime = 1.0;
+
+//
+//  Fills a density texture with terrain. Every chunk size covers the same
+//  volume per cell, so larger chunks span more of the world.
+//
+static void GenerateTerrain(Noise& noise,
+                            std::vector<float>& texels,
+                            size_t size,
+                            float3 origin)
+{
+    texels.resize(size * size * size);
+    for (size_t z = 0; z < size; ++z)
+    {
+        for (size_t y = 0; y < size; ++y)
+        {
+            for (size_t x = 0; x < size; ++x)
+            {
+                float3 p = origin + float3(static_cast<float>(x),
+                                           static_cast<float>(y),
+                                           static_cast<float>(z));
+                texels[(((z * size) + y) * size) + x] = (16.0f - p.y) +
+                                                        (noise.Sample(p.x / 32.0f, p.y / 32.0f, p.z / 32.0f) * 16.0f) +
+                                                        (noise.Sample(p.x / 8.0f, p.y / 8.0f, p.z / 8.0f) * 2.0f);
+            }
+        }
+    }
+}
+
+//
+//  Measures one chunk size.
+//
+template <size_t N>
+static void RunChunkSize(Noise& noise)
+{
+    typedef VoxelField<N> Field;
+
+    //  Chunks are laid out in a row along X, straddling the surface.
+    std::vector<std::vector<float>> chunks(ChunkCount);
+    for (size_t i = 0; i < ChunkCount; ++i)
+    {
+        GenerateTerrain(noise,
+                        chunks[i],
+                        N,
+                        float3(static_cast<float>(i * N), 16.0f - (N / 2.0f), 0.0f));
+    }
+
+    //  The arena starts out empty so that it has to grow to fit the largest
+    //  chunk; a warm-up pass over every chunk does that before timing starts.
+    ScratchArena arena(0);
+    for (size_t i = 0; i < ChunkCount; ++i)
+    {
+        arena.Reset();
+        Field* field = new (arena.Allocate(sizeof(Field))) Field(arena,
+                                                                 float3(N - 2.0f, N - 2.0f, N - 2.0f),
+                                                                 float3(1.0f, 1.0f, 1.0f));
+        uint32_t* cells;
+        field->Load(chunks[i].data(), N * sizeof(float), N * N * sizeof(float));
+        field->ListCells(arena, cells);
+    }
+    size_t warmAllocationCount = arena.GetHeapAllocationCount();
+
+    size_t chunkCount = 0, activeCellCount = 0;
+    double loadTime = 0, listTime = 0;
+    while (loadTime + listTime < MinBenchTime)
+    {
+        for (size_t i = 0; i < ChunkCount; ++i)
+        {
+            double t0 = GetBenchTime();
+            arena.Reset();
+            Field* field = new (arena.Allocate(sizeof(Field))) Field(arena,
+                                                                     float3(N - 2.0f, N - 2.0f, N - 2.0f),
+                                                                     float3(1.0f, 1.0f, 1.0f));
+            field->Load(chunks[i].data(), N * sizeof(float), N * N * sizeof(float));
+            double t1 = GetBenchTime();
+            uint32_t* cells;
+            activeCellCount += field->ListCells(arena, cells);
+            double t2 = GetBenchTime();
+
+            loadTime += t1 - t0;
+            listTime += t2 - t1;
+            chunkCount++;
+        }
+    }
+
+    double cellCount = static_cast<double>(chunkCount) * N * N * N;
+    printf("%3u^3  %10.0f  %10.2f  %10.2f  %10.2f  %8.2f%%  %10u  %6u\n",
+           static_cast<uint>(N),
+           chunkCount / (loadTime + listTime),
+           (cellCount / (loadTime + listTime)) / 1.0e6,
+           (cellCount / loadTime) / 1.0e6,
+           (cellCount / listTime) / 1.0e6,
+           (activeCellCount / cellCount) * 100.0,
+           static_cast<uint>(arena.GetPeakBytesUsed()),
+           static_cast<uint>(arena.GetHeapAllocationCount() - warmAllocationCount));
+}
+
+void RunVoxelFieldBench()
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+
+    printf("VoxelField (single thread, %u logical processors)\n",
+           static_cast<uint>(info.dwNumberOfProcessors));
+    printf("%5s  %10s  %10s  %10s  %10s  %9s  %10s  %6s\n",
+           "size", "chunks/s", "Mcells/s", "load Mc/s", "list Mc/s", "active", "bytes", "allocs");
+
+    Noise noise;
+    RunChunkSize<16>(noise);
+    RunChunkSize<32>(noise);
+    RunChunkSize<64>(noise);
+}
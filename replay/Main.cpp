@@ -0,0 +1,347 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Prefix.h"
+#include "Camera.h"
+#include "FlightPath.h"
+#include "GraphicsDevice.h"
+#include "Histogram.h"
+#include "Metrics.h"
+#include "NodeTimeline.h"
+#include "Profiler.h"
+#include "SceneManager.h"
+
+#include <psapi.h>
+
+const size_t ViewportWidth = 1024;
+const size_t ViewportHeight = 768;
+const char* StatisticsPath = "NyxReplay.profile.csv";
+
+//
+//  Distance moved in a single tick beyond which the camera is taken to have
+//  teleported.
+//
+static const float TeleportDistance = 512.0f;
+
+//
+//  Consecutive frames without any node work after which the detail around
+//  the camera is complete, and the longest wait for it, in frames.
+//
+static const size_t SettledFrameCount = 3;
+static const size_t MaxSettleFrameCount = 60 * 60;
+
+//
+//  Percentiles of the frame time reported.
+//
+static const double ReportedPercentiles[] = {50.0, 90.0, 99.0, 99.9};
+static const char* ReportedPercentileNames[] = {"p50", "p90", "p99", "p99.9"};
+static const size_t ReportedPercentileCount = sizeof(ReportedPercentiles) / sizeof(ReportedPercentiles[0]);
+
+//
+//  Depths for which node latencies are reported.
+//
+static const size_t ReportedDepthCount = 8;
+
+//
+//  Builds the path flown when none is given: a flight across the terrain at
+//  speed, two teleports to fresh ground, and a low pass near the surface.
+//
+static void BuildDefaultPath(FlightPath& path)
+{
+    float4 north = float4::IdentityQuaternion();
+    float4 east = float4::RotationQuaternion(0.0f, XM_PIDIV2, 0.0f);
+    path.AddLine(float3(0.0f, 2000.0f, 0.0f), float3(0.0f, 2000.0f, 6000.0f), north, 600);
+    path.AddLine(float3(-12000.0f, 1500.0f, 9000.0f), float3(-6000.0f, 1500.0f, 9000.0f), east, 600);
+    path.AddLine(float3(8000.0f, 400.0f, -8000.0f), float3(8000.0f, 400.0f, -6000.0f), north, 600);
+}
+
+//
+//  Returns true if the camera jumps between two ticks.
+//
+static bool IsTeleport(const FlightPath::Tick& from, const FlightPath::Tick& to)
+{
+    float3 d = to.position - from.position;
+    return (d.x * d.x) + (d.y * d.y) + (d.z * d.z) > TeleportDistance * TeleportDistance;
+}
+
+//
+//  Watches the voxel manager's metrics for node work.
+//
+class WorkMonitor : public boost::noncopyable
+{
+public:
+    //
+    //  Constructor.
+    //
+    //  Parameters:
+    //      [in] metrics
+    //          Registry the voxel manager publishes to.
+    //
+    WorkMonitor(MetricsRegistry& metrics);
+
+    //
+    //  Samples the metrics after a frame.
+    //
+    //  Returns:
+    //      True once no node has been queued, pending or in flight for
+    //      SettledFrameCount frames in a row.
+    //
+    bool Update();
+
+private:
+    //
+    //  Properties.
+    //
+    Gauge& m_pendingNodes;
+    Gauge& m_inflightJobs;
+    Counter& m_queuedNodes;
+    int64_t m_lastQueuedCount;
+    size_t m_idleFrameCount;
+};
+
+WorkMonitor::WorkMonitor(MetricsRegistry& metrics)
+: m_pendingNodes(metrics.GetGauge("nyx_pending_nodes", "")),
+  m_inflightJobs(metrics.GetGauge("nyx_inflight_jobs", "")),
+  m_queuedNodes(metrics.GetCounter("nyx_nodes_queued_total", "")),
+  m_lastQueuedCount(0),
+  m_idleFrameCount(0)
+{
+}
+
+bool WorkMonitor::Update()
+{
+    int64_t queuedCount = m_queuedNodes.GetValue();
+    bool idle = !m_pendingNodes.GetValue() &&
+                !m_inflightJobs.GetValue() &&
+                queuedCount == m_lastQueuedCount;
+    m_lastQueuedCount = queuedCount;
+    m_idleFrameCount = idle ? m_idleFrameCount + 1 : 0;
+    return m_idleFrameCount >= SettledFrameCount;
+}
+
+//
+//  Prints a row of the node latency table: the count and percentiles of a
+//  histogram of microseconds, in milliseconds.
+//
+static void PrintLatency(const char* name, const Histogram& histogram)
+{
+    printf("  %-22s %8llu", name, static_cast<unsigned long long>(histogram.GetCount()));
+    for (size_t i = 0; i < ReportedPercentileCount; ++i)
+    {
+        printf(" %9.2f", histogram.GetPercentile(ReportedPercentiles[i]) / 1.0e3);
+    }
+    printf("\n");
+}
+
+//
+//  Prints the node latencies the voxel manager recorded: the time taken to
+//  reach each event of a node's life from the one before it, and, by depth,
+//  the time for new nodes to become visible and the lifetime of those which
+//  never did.
+//
+static void PrintNodeLatencies(MetricsRegistry& metrics)
+{
+    printf("\nNode latency (ms)           count");
+    for (size_t i = 0; i < ReportedPercentileCount; ++i)
+    {
+        printf(" %9s", ReportedPercentileNames[i]);
+    }
+    printf("\n");
+    for (size_t i = NodeTimeline::Event_Created + 1; i < NodeTimeline::Event_Count; ++i)
+    {
+        const char* name = NodeTimeline::GetEventName(static_cast<NodeTimeline::Event>(i));
+        char labels[32];
+        sprintf_s(labels, "event=\"%s\"", name);
+        PrintLatency(name, metrics.GetHistogram("nyx_node_event_microseconds", "", labels));
+    }
+    for (size_t i = 0; i < ReportedDepthCount; ++i)
+    {
+        char labels[32], name[32];
+        sprintf_s(labels, "depth=\"%u\"", static_cast<uint>(i));
+        const Histogram& visible = metrics.GetHistogram("nyx_node_visible_microseconds", "", labels);
+        const Histogram& abandoned = metrics.GetHistogram("nyx_node_abandoned_microseconds", "", labels);
+        if (visible.GetCount())
+        {
+            sprintf_s(name, "depth %u visible", static_cast<uint>(i));
+            PrintLatency(name, visible);
+        }
+        if (abandoned.GetCount())
+        {
+            sprintf_s(name, "depth %u abandoned", static_cast<uint>(i));
+            PrintLatency(name, abandoned);
+        }
+    }
+}
+
+static void PrintUsage()
+{
+    fprintf(stderr,
+            "Usage: NyxReplay [-hardware | -warp | -null] [path]\n"
+            "\n"
+            "Replays a flight path, one tick per frame, without a window. Paths\n"
+            "are recorded by Nyx as Nyx.flightpath.txt. A built-in path is flown\n"
+            "if none is given.\n"
+            "\n"
+            "  -hardware  Render on the default adapter (default)\n"
+            "  -warp      Render on the WARP software rasterizer\n"
+            "  -null      Use the null driver; no terrain is generated\n");
+}
+
+int main(int argc, char** argv)
+{
+    D3D_DRIVER_TYPE driverType = D3D_DRIVER_TYPE_HARDWARE;
+    const char* pathName = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-hardware") == 0)
+        {
+            driverType = D3D_DRIVER_TYPE_HARDWARE;
+        }
+        else if (strcmp(argv[i], "-warp") == 0)
+        {
+            driverType = D3D_DRIVER_TYPE_WARP;
+        }
+        else if (strcmp(argv[i], "-null") == 0)
+        {
+            driverType = D3D_DRIVER_TYPE_NULL;
+        }
+        else if (argv[i][0] != '-' && !pathName)
+        {
+            pathName = argv[i];
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    Profiler::SetThreadName("Main");
+    try
+    {
+        FlightPath path;
+        if (pathName)
+        {
+            path.Load(pathName);
+        }
+        else
+        {
+            BuildDefaultPath(path);
+        }
+        CHECK(SystemError, path.GetLength() > 0);
+
+        MetricsRegistry metrics;
+        GraphicsDevice graphicsDevice(ViewportWidth, ViewportHeight, driverType);
+        SceneManager sceneManager(graphicsDevice);
+        sceneManager.SetMetrics(metrics);
+        WorkMonitor workMonitor(metrics);
+        Counter& processedNodes = metrics.GetCounter("nyx_nodes_processed_total", "");
+        Gauge& residentBytes = metrics.GetGauge("nyx_resident_mesh_bytes", "");
+
+        Camera camera;
+        camera.SetProjectionMatrix(float4x4::PerspectiveProjection(XM_PI / 3.0f,
+                                                                   static_cast<float>(ViewportWidth) / static_cast<float>(ViewportHeight),
+                                                                   1.0f,
+                                                                   32000.0f));
+
+        Histogram frameTimes;
+        Histogram settleTimes;
+        double ticksPerNanosecond = Profiler::GetTicksPerSecond() / 1.0e9;
+        size_t frameCount = 0,
+               teleportCount = 0,
+               unsettledCount = 0;
+        double peakResidentBytes = 0.0;
+
+        //  Each tick draws one frame. After a teleport, the camera holds still
+        //  until the detail around it is complete, and the wait is timed.
+        auto drawFrame = [&](const FlightPath::Tick& tick) -> bool
+        {
+            uint64_t start = Profiler::GetTicks();
+            camera.SetPosition(tick.position);
+            camera.SetRotation(tick.rotation);
+            sceneManager.Update();
+            sceneManager.SetCamera(camera);
+            sceneManager.Draw();
+            frameTimes.Record(static_cast<uint64_t>((Profiler::GetTicks() - start) / ticksPerNanosecond));
+            ++frameCount;
+            peakResidentBytes = max(peakResidentBytes, residentBytes.GetValue());
+            return workMonitor.Update();
+        };
+
+        printf("Replaying %u ticks\n", static_cast<uint>(path.GetLength()));
+        uint64_t startTicks = Profiler::GetTicks();
+        int64_t startProcessedCount = processedNodes.GetValue();
+        for (size_t i = 0; i < path.GetLength(); ++i)
+        {
+            const FlightPath::Tick& tick = path[i];
+            bool settled = drawFrame(tick);
+            if (i != 0 && !IsTeleport(path[i - 1], tick))
+            {
+                continue;
+            }
+
+            uint64_t teleportTicks = Profiler::GetTicks();
+            size_t waitFrameCount = 0;
+            while (!settled && waitFrameCount < MaxSettleFrameCount)
+            {
+                settled = drawFrame(tick);
+                ++waitFrameCount;
+            }
+            double settleTime = (Profiler::GetTicks() - teleportTicks) / static_cast<double>(Profiler::GetTicksPerSecond());
+            printf("Teleport %u to (%.0f, %.0f, %.0f): %s in %.3f s, %u frames\n",
+                   static_cast<uint>(teleportCount),
+                   tick.position.x,
+                   tick.position.y,
+                   tick.position.z,
+                   settled ? "complete" : "INCOMPLETE",
+                   settleTime,
+                   static_cast<uint>(waitFrameCount));
+            settleTimes.Record(static_cast<uint64_t>(settleTime * 1.0e3));
+            ++teleportCount;
+            if (!settled)
+            {
+                ++unsettledCount;
+            }
+        }
+        double totalTime = (Profiler::GetTicks() - startTicks) / static_cast<double>(Profiler::GetTicksPerSecond());
+        int64_t processedCount = processedNodes.GetValue() - startProcessedCount;
+
+        PROCESS_MEMORY_COUNTERS memoryCounters;
+        ZeroMemory(&memoryCounters, sizeof(memoryCounters));
+        memoryCounters.cb = sizeof(memoryCounters);
+        WINCHECK(GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters)));
+
+        printf("\nFlight path replay (%u ticks, %u frames, %.2f s)\n",
+               static_cast<uint>(path.GetLength()),
+               static_cast<uint>(frameCount),
+               totalTime);
+        printf("Chunks generated: %lld\t(%.1f per second)\n",
+               static_cast<long long>(processedCount),
+               processedCount / totalTime);
+        printf("Teleports: %u\t(%u incomplete, median %.0f ms, longest %.0f ms)\n",
+               static_cast<uint>(teleportCount),
+               static_cast<uint>(unsettledCount),
+               static_cast<double>(settleTimes.GetPercentile(50.0)),
+               static_cast<double>(settleTimes.GetPercentile(100.0)));
+        printf("Frame CPU time (ms):");
+        for (size_t i = 0; i < ReportedPercentileCount; ++i)
+        {
+            printf("  %s %.3f", ReportedPercentileNames[i], frameTimes.GetPercentile(ReportedPercentiles[i]) / 1.0e6);
+        }
+        printf("\nPeak working set: %.1f MB\nPeak commit: %.1f MB\nPeak resident meshes: %.1f MB\n",
+               memoryCounters.PeakWorkingSetSize / (1024.0 * 1024.0),
+               memoryCounters.PeakPagefileUsage / (1024.0 * 1024.0),
+               peakResidentBytes / (1024.0 * 1024.0));
+        PrintNodeLatencies(metrics);
+
+        Profiler::WriteStatistics(StatisticsPath, Profiler::StatisticsFormat_Csv);
+    }
+    catch (std::exception& e)
+    {
+        fprintf(stderr, "%s\n", boost::diagnostic_information(e).c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,116 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef __NYX_ATOMIC_H__
+#define __NYX_ATOMIC_H__
+
+//
+//  Atomic operations on plain integers and pointers.
+//
+//  These wrap the Interlocked functions on Windows and the GCC __sync
+//  builtins elsewhere. Every operation is a full memory barrier.
+//
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+//
+//  Increments a counter.
+//
+//  Returns:
+//      The incremented value.
+//
+inline int32_t AtomicIncrement(volatile int32_t* target)
+{
+#ifdef _WIN32
+    return InterlockedIncrement(reinterpret_cast<volatile LONG*>(target));
+#else
+    return __sync_add_and_fetch(target, 1);
+#endif
+}
+
+//
+//  Adds to a 64-bit counter.
+//
+//  Returns:
+//      The sum.
+//
+inline int64_t AtomicAdd(volatile int64_t* target, int64_t value)
+{
+#ifdef _WIN32
+    return InterlockedExchangeAdd64(target, value) + value;
+#else
+    return __sync_add_and_fetch(target, value);
+#endif
+}
+
+//
+//  Replaces a 64-bit value if it equals the comparand.
+//
+//  Returns:
+//      The value before the operation.
+//
+inline int64_t AtomicCompareExchange(volatile int64_t* target, int64_t value, int64_t comparand)
+{
+#ifdef _WIN32
+    return InterlockedCompareExchange64(target, value, comparand);
+#else
+    return __sync_val_compare_and_swap(target, comparand, value);
+#endif
+}
+
+//
+//  Replaces a pointer if it equals the comparand.
+//
+//  Returns:
+//      The pointer before the operation.
+//
+inline void* AtomicCompareExchangePointer(void* volatile* target, void* value, void* comparand)
+{
+#ifdef _WIN32
+    return InterlockedCompareExchangePointer(target, value, comparand);
+#else
+    return __sync_val_compare_and_swap(target, comparand, value);
+#endif
+}
+
+//
+//  Lowers a 64-bit value to at most the given value.
+//
+inline void AtomicMin(volatile int64_t* target, int64_t value)
+{
+    for (int64_t current = *target; value < current; )
+    {
+        current = AtomicCompareExchange(target, value, current);
+    }
+}
+
+//
+//  Raises a 64-bit value to at least the given value.
+//
+inline void AtomicMax(volatile int64_t* target, int64_t value)
+{
+    for (int64_t current = *target; value > current; )
+    {
+        current = AtomicCompareExchange(target, value, current);
+    }
+}
+
+//
+//  Orders all memory accesses before the barrier ahead of those after it.
+//
+inline void FullBarrier()
+{
+#ifdef _WIN32
+    MemoryBarrier();
+#else
+    __sync_synchronize();
+#endif
+}
+
+#endif  // __NYX_ATOMIC_H__
@@ -0,0 +1,163 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Prefix.h"
+#include "BuddyAllocator.h"
+
+const size_t BuddyAllocator::InvalidOffset;
+const uint32_t BuddyAllocator::Nil;
+
+BuddyAllocator::BuddyAllocator(size_t capacity, size_t minBlockSize)
+: m_capacity(capacity),
+  m_minBlockSize(minBlockSize),
+  m_maxOrder(0),
+  m_allocatedSize(0),
+  m_allocationCount(0)
+{
+    assert(capacity && !(capacity & (capacity - 1)));
+    assert(minBlockSize && !(minBlockSize & (minBlockSize - 1)));
+    assert(minBlockSize <= capacity);
+
+    while ((m_minBlockSize << m_maxOrder) < m_capacity)
+    {
+        ++m_maxOrder;
+    }
+    size_t blockCount = m_capacity / m_minBlockSize;
+    m_states.resize(blockCount, 0);
+    m_next.resize(blockCount, Nil);
+    m_prev.resize(blockCount, Nil);
+    m_freeLists.resize(m_maxOrder + 1, Nil);
+    PushFree(0, m_maxOrder);
+}
+
+BuddyAllocator::~BuddyAllocator()
+{
+}
+
+size_t BuddyAllocator::Allocate(size_t size)
+{
+    if (!size || size > m_capacity)
+    {
+        return InvalidOffset;
+    }
+
+    //  Take the smallest free block which is large enough
+    size_t order = GetOrder(size), freeOrder = order;
+    while (freeOrder <= m_maxOrder && m_freeLists[freeOrder] == Nil)
+    {
+        ++freeOrder;
+    }
+    if (freeOrder > m_maxOrder)
+    {
+        return InvalidOffset;
+    }
+    uint32_t block = m_freeLists[freeOrder];
+    RemoveFree(block, freeOrder);
+
+    //  Split it down to size, freeing the upper halves
+    while (freeOrder > order)
+    {
+        --freeOrder;
+        PushFree(block + (1 << freeOrder), freeOrder);
+    }
+    m_states[block] = static_cast<uint8_t>(order + 1);
+    m_allocatedSize += m_minBlockSize << order;
+    ++m_allocationCount;
+    return block * m_minBlockSize;
+}
+
+void BuddyAllocator::Free(size_t offset)
+{
+    assert(offset % m_minBlockSize == 0);
+    uint32_t block = static_cast<uint32_t>(offset / m_minBlockSize);
+    assert(block < m_states.size() && m_states[block] && !(m_states[block] & FreeFlag));
+
+    size_t order = m_states[block] - 1;
+    m_states[block] = 0;
+    m_allocatedSize -= m_minBlockSize << order;
+    --m_allocationCount;
+
+    //  Merge with the buddy for as long as it's free
+    while (order < m_maxOrder)
+    {
+        uint32_t buddy = block ^ (1 << order);
+        if (m_states[buddy] != ((order + 1) | FreeFlag))
+        {
+            break;
+        }
+        RemoveFree(buddy, order);
+        block = min(block, buddy);
+        ++order;
+    }
+    PushFree(block, order);
+}
+
+size_t BuddyAllocator::GetBlockSize(size_t offset) const
+{
+    uint32_t block = static_cast<uint32_t>(offset / m_minBlockSize);
+    assert(block < m_states.size() && m_states[block] && !(m_states[block] & FreeFlag));
+    return m_minBlockSize << (m_states[block] - 1);
+}
+
+size_t BuddyAllocator::GetLargestFreeBlock() const
+{
+    for (size_t order = m_maxOrder + 1; order-- > 0; )
+    {
+        if (m_freeLists[order] != Nil)
+        {
+            return m_minBlockSize << order;
+        }
+    }
+    return 0;
+}
+
+float BuddyAllocator::GetFragmentation() const
+{
+    size_t freeSize = m_capacity - m_allocatedSize;
+    if (!freeSize)
+    {
+        return 0.0f;
+    }
+    return 1.0f - static_cast<float>(GetLargestFreeBlock()) / static_cast<float>(freeSize);
+}
+
+size_t BuddyAllocator::GetOrder(size_t size) const
+{
+    size_t order = 0;
+    while ((m_minBlockSize << order) < size)
+    {
+        ++order;
+    }
+    return order;
+}
+
+void BuddyAllocator::PushFree(uint32_t block, size_t order)
+{
+    m_states[block] = static_cast<uint8_t>((order + 1) | FreeFlag);
+    m_prev[block] = Nil;
+    m_next[block] = m_freeLists[order];
+    if (m_freeLists[order] != Nil)
+    {
+        m_prev[m_freeLists[order]] = block;
+    }
+    m_freeLists[order] = block;
+}
+
+void BuddyAllocator::RemoveFree(uint32_t block, size_t order)
+{
+    if (m_prev[block] != Nil)
+    {
+        m_next[m_prev[block]] = m_next[block];
+    }
+    else
+    {
+        m_freeLists[order] = m_next[block];
+    }
+    if (m_next[block] != Nil)
+    {
+        m_prev[m_next[block]] = m_prev[block];
+    }
+    m_states[block] = 0;
+}
@@ -0,0 +1,145 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef __NYX_BUDDYALLOCATOR_H__
+#define __NYX_BUDDYALLOCATOR_H__
+
+//
+//  Sub-allocates ranges of an abstract address space with the buddy system.
+//
+//  The space is split into power of two blocks. An allocation is rounded up
+//  to the smallest block which holds it, splitting larger free blocks in
+//  halves as needed, and a freed block is merged with its buddy whenever the
+//  buddy is free too. Allocating and freeing take time proportional to the
+//  number of block sizes. Units are whatever the caller likes; MeshHeap uses
+//  vertices and indices.
+//
+class BuddyAllocator : public boost::noncopyable
+{
+public:
+    //
+    //  Offset returned when an allocation fails.
+    //
+    static const size_t InvalidOffset = ~static_cast<size_t>(0);
+
+    //
+    //  Constructor.
+    //
+    //  Parameters:
+    //      [in] capacity
+    //          Size of the address space. Must be a power of two.
+    //      [in] minBlockSize
+    //          Size of the smallest block. Must be a power of two no larger
+    //          than the capacity.
+    //
+    BuddyAllocator(size_t capacity, size_t minBlockSize);
+
+    //
+    //  Destructor.
+    //
+    ~BuddyAllocator();
+
+    //
+    //  Allocates a range.
+    //
+    //  Returns:
+    //      The offset of the range, or InvalidOffset if no free block is
+    //      large enough.
+    //
+    size_t Allocate(size_t size);
+
+    //
+    //  Frees a range returned by Allocate().
+    //
+    void Free(size_t offset);
+
+    //
+    //  Returns the size of the block backing an allocation.
+    //
+    size_t GetBlockSize(size_t offset) const;
+
+    //
+    //  Returns the size of the address space.
+    //
+    size_t GetCapacity() const;
+
+    //
+    //  Returns the total size of the allocated blocks.
+    //
+    size_t GetAllocatedSize() const;
+
+    //
+    //  Returns the number of allocations.
+    //
+    size_t GetAllocationCount() const;
+
+    //
+    //  Returns the size of the largest free block.
+    //
+    size_t GetLargestFreeBlock() const;
+
+    //
+    //  Returns the fraction of the free space which lies outside the largest
+    //  free block, from 0 (all free space is in one block) towards 1.
+    //
+    float GetFragmentation() const;
+
+private:
+    //
+    //  Returns the order of the smallest block which holds a size.
+    //
+    size_t GetOrder(size_t size) const;
+
+    //
+    //  Adds a block to the free list of its order.
+    //
+    void PushFree(uint32_t block, size_t order);
+
+    //
+    //  Removes a block from the free list of its order.
+    //
+    void RemoveFree(uint32_t block, size_t order);
+
+    //
+    //  Properties.
+    //
+    //  Blocks are identified by the index of their first minimum size block.
+    //  The state of a block is kept at that index: zero if no block starts
+    //  there, otherwise its order plus one, with FreeFlag set if it's free.
+    //  Free blocks are linked into one list per order through m_next and
+    //  m_prev.
+    //
+    enum
+    {
+        FreeFlag = 0x80
+    };
+    static const uint32_t Nil = 0xFFFFFFFF;
+    size_t m_capacity;
+    size_t m_minBlockSize;
+    size_t m_maxOrder;
+    size_t m_allocatedSize;
+    size_t m_allocationCount;
+    std::vector<uint8_t> m_states;
+    std::vector<uint32_t> m_next;
+    std::vector<uint32_t> m_prev;
+    std::vector<uint32_t> m_freeLists;
+};
+
+inline size_t BuddyAllocator::GetCapacity() const
+{
+    return m_capacity;
+}
+
+inline size_t BuddyAllocator::GetAllocatedSize() const
+{
+    return m_allocatedSize;
+}
+
+inline size_t BuddyAllocator::GetAllocationCount() const
+{
+    return m_allocationCount;
+}
+
+#endif  // __NYX_BUDDYALLOCATOR_H__
@@ -0,0 +1,90 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Prefix.h"
+#include "FlightPath.h"
+
+void FlightPath::Add(const float3& position, const float4& rotation)
+{
+    Tick tick;
+    tick.position = position;
+    tick.rotation = rotation;
+    m_ticks.push_back(tick);
+}
+
+void FlightPath::AddLine(const float3& from,
+                         const float3& to,
+                         const float4& rotation,
+                         size_t tickCount)
+{
+    for (size_t i = 0; i < tickCount; ++i)
+    {
+        float t = tickCount > 1 ? static_cast<float>(i) / static_cast<float>(tickCount - 1) : 0.0f;
+        Add(from + ((to - from) * t), rotation);
+    }
+}
+
+void FlightPath::Clear()
+{
+    m_ticks.clear();
+}
+
+void FlightPath::Load(const char* path)
+{
+    FILE* file = nullptr;
+    CHECK(SystemError, fopen_s(&file, path, "r") == 0 && file);
+
+    m_ticks.clear();
+    char line[256];
+    size_t lineNumber = 0;
+    while (fgets(line, sizeof(line), file))
+    {
+        ++lineNumber;
+        const char* start = line + strspn(line, " \t\r\n");
+        if (!*start || *start == '#')
+        {
+            continue;
+        }
+
+        Tick tick;
+        if (sscanf_s(start,
+                     "%f %f %f %f %f %f %f",
+                     &tick.position.x,
+                     &tick.position.y,
+                     &tick.position.z,
+                     &tick.rotation.x,
+                     &tick.rotation.y,
+                     &tick.rotation.z,
+                     &tick.rotation.w) != 7)
+        {
+            fclose(file);
+            THROW(SystemError(boost::format("%s(%u): expected x y z qx qy qz qw") % path % lineNumber));
+        }
+        m_ticks.push_back(tick);
+    }
+    fclose(file);
+}
+
+void FlightPath::Save(const char* path) const
+{
+    FILE* file = nullptr;
+    CHECK(SystemError, fopen_s(&file, path, "w") == 0 && file);
+
+    fputs("# Nyx flight path, one tick per line\n# x y z qx qy qz qw\n", file);
+    for (size_t i = 0; i < m_ticks.size(); ++i)
+    {
+        const Tick& tick = m_ticks[i];
+        fprintf(file,
+                "%.4f %.4f %.4f %.6f %.6f %.6f %.6f\n",
+                tick.position.x,
+                tick.position.y,
+                tick.position.z,
+                tick.rotation.x,
+                tick.rotation.y,
+                tick.rotation.z,
+                tick.rotation.w);
+    }
+    fclose(file);
+}
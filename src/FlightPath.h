@@ -0,0 +1,113 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef __NYX_FLIGHTPATH_H__
+#define __NYX_FLIGHTPATH_H__
+
+//
+//  A camera position and rotation for every tick of a flight.
+//
+//  Paths are recorded from live input, or written by hand, and replayed one
+//  tick per frame. They are stored as text, one tick per line:
+//
+//      x y z qx qy qz qw
+//
+//  where the rotation is a quaternion. Blank lines and lines starting with
+//  '#' are ignored.
+//
+class FlightPath
+{
+public:
+    //
+    //  The camera at one tick.
+    //
+    struct Tick
+    {
+        float3 position;
+        float4 rotation;
+    };
+
+    //
+    //  Constructor. The path starts out empty.
+    //
+    FlightPath();
+
+    //
+    //  Appends a tick.
+    //
+    //  Parameters:
+    //      [in] position
+    //          Camera position.
+    //      [in] rotation
+    //          Camera rotation quaternion.
+    //
+    void Add(const float3& position, const float4& rotation);
+
+    //
+    //  Appends ticks flying in a straight line, without turning.
+    //
+    //  Parameters:
+    //      [in] from
+    //          Position at the first tick.
+    //      [in] to
+    //          Position at the last tick.
+    //      [in] rotation
+    //          Camera rotation quaternion.
+    //      [in] tickCount
+    //          Number of ticks to append.
+    //
+    void AddLine(const float3& from,
+                 const float3& to,
+                 const float4& rotation,
+                 size_t tickCount);
+
+    //
+    //  Removes every tick.
+    //
+    void Clear();
+
+    //
+    //  Returns the number of ticks.
+    //
+    size_t GetLength() const;
+
+    //
+    //  Returns a tick.
+    //
+    const Tick& operator[](size_t tick) const;
+
+    //
+    //  Replaces the path with one read from a file.
+    //
+    void Load(const char* path);
+
+    //
+    //  Writes the path to a file.
+    //
+    void Save(const char* path) const;
+
+private:
+    //
+    //  Properties.
+    //
+    std::vector<Tick> m_ticks;
+};
+
+inline FlightPath::FlightPath()
+{
+}
+
+inline size_t FlightPath::GetLength() const
+{
+    return m_ticks.size();
+}
+
+inline const FlightPath::Tick& FlightPath::operator[](size_t tick) const
+{
+    assert(tick < m_ticks.size());
+    return m_ticks[tick];
+}
+
+#endif  // __NYX_FLIGHTPATH_H__
@@ -38,3 +38,107 @@ void Frustum::Extract(const float4x4& m)
     m_planes[FrustumPlane_Near].z = m[2][3] - m[2][2];
     m_planes[FrustumPlane_Near].w = m[3][3] - m[3][2];
 }
+
+FrustumTest Frustum::Classify(const box3f& box,
+                              uint32_t& planeMask,
+                              uint32_t& lastFailedPlane) const
+{
+    assert(lastFailedPlane < FrustumPlane_Max);
+
+    //  A box which was rejected last frame is most likely rejected by the
+    //  same plane again.
+    for (size_t i = 0; i < FrustumPlane_Max; ++i)
+    {
+        size_t p = (lastFailedPlane + i) % FrustumPlane_Max;
+        if (planeMask & (1 << p))
+        {
+            FrustumTest result = TestPlane(box, p);
+            if (result == FrustumTest_Outside)
+            {
+                lastFailedPlane = static_cast<uint32_t>(p);
+                return FrustumTest_Outside;
+            }
+            else if (result == FrustumTest_Inside)
+            {
+                planeMask &= ~(1 << p);
+            }
+        }
+    }
+    return planeMask ? FrustumTest_Intersects : FrustumTest_Inside;
+}
+
+uint32_t Frustum::IntersectsBatch(const BoxBatch& batch,
+                                  size_t count,
+                                  uint32_t planeMask,
+                                  uint32_t* planeMasks,
+                                  uint32_t& lastFailedPlane) const
+{
+    assert(count <= BoxBatch::MaxBoxes);
+    assert(lastFailedPlane < FrustumPlane_Max);
+    if (planeMasks)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            planeMasks[i] = planeMask;
+        }
+    }
+
+    //  The plane which last rejected a box in the batch is tested first.
+    size_t firstPlane = lastFailedPlane;
+    uint32_t mask = 0;
+    for (size_t i = 0; i < count; i += 4)
+    {
+        __m128 minX = _mm_loadu_ps(batch.minX + i), maxX = _mm_loadu_ps(batch.maxX + i),
+               minY = _mm_loadu_ps(batch.minY + i), maxY = _mm_loadu_ps(batch.maxY + i),
+               minZ = _mm_loadu_ps(batch.minZ + i), maxZ = _mm_loadu_ps(batch.maxZ + i);
+
+        //  A box is outside if its p-vertex is behind any plane. Once every
+        //  box in the group is outside there is nothing left to test.
+        uint32_t laneMask = (count - i >= 4) ? 0xF : ((1 << (count - i)) - 1);
+        uint32_t outside = 0;
+        for (size_t j = 0; j < FrustumPlane_Max && outside != laneMask; ++j)
+        {
+            size_t p = (firstPlane + j) % FrustumPlane_Max;
+            if (!(planeMask & (1 << p)))
+            {
+                continue;
+            }
+
+            const float4& plane = m_planes[p];
+            __m128 a = _mm_set1_ps(plane.x), b = _mm_set1_ps(plane.y),
+                   c = _mm_set1_ps(plane.z), d = _mm_set1_ps(plane.w);
+            __m128 x = plane.x >= 0 ? maxX : minX,
+                   y = plane.y >= 0 ? maxY : minY,
+                   z = plane.z >= 0 ? maxZ : minZ;
+            __m128 pd = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, a), _mm_mul_ps(y, b)),
+                                   _mm_add_ps(_mm_mul_ps(z, c), d));
+            uint32_t rejected = _mm_movemask_ps(_mm_cmplt_ps(pd, _mm_setzero_ps())) & laneMask;
+            if (rejected & ~outside)
+            {
+                lastFailedPlane = static_cast<uint32_t>(p);
+            }
+            outside |= rejected;
+
+            //  Boxes whose n-vertex is in front of the plane are entirely
+            //  inside it, so boxes they contain needn't test it again.
+            if (planeMasks)
+            {
+                x = plane.x >= 0 ? minX : maxX;
+                y = plane.y >= 0 ? minY : maxY;
+                z = plane.z >= 0 ? minZ : maxZ;
+                __m128 nd = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, a), _mm_mul_ps(y, b)),
+                                       _mm_add_ps(_mm_mul_ps(z, c), d));
+                uint32_t inside = _mm_movemask_ps(_mm_cmpge_ps(nd, _mm_setzero_ps())) & laneMask;
+                for (size_t k = 0; k < 4; ++k)
+                {
+                    if (inside & (1 << k))
+                    {
+                        planeMasks[i + k] &= ~(1 << p);
+                    }
+                }
+            }
+        }
+        mask |= (~outside & laneMask) << i;
+    }
+    return mask;
+}
@@ -16,9 +16,41 @@ enum FrustumPlane {
     FrustumPlane_Max
 };
 
+enum FrustumTest {
+    FrustumTest_Outside,
+    FrustumTest_Intersects,
+    FrustumTest_Inside
+};
+
+//
+//  A batch of axis-aligned boxes in structure-of-arrays layout, sized for the
+//  eight children of a node.
+//
+struct BoxBatch
+{
+    enum { MaxBoxes = 8 };
+
+    float minX[MaxBoxes];
+    float minY[MaxBoxes];
+    float minZ[MaxBoxes];
+    float maxX[MaxBoxes];
+    float maxY[MaxBoxes];
+    float maxZ[MaxBoxes];
+
+    //
+    //  Stores a box in the batch.
+    //
+    void Set(size_t i, const box3f& box);
+};
+
 class Frustum
 {
 public:
+    //
+    //  Mask with a bit set for every plane.
+    //
+    enum { AllPlanes = (1 << FrustumPlane_Max) - 1 };
+
     //
     //  Default constructor.
     //
@@ -44,6 +76,74 @@ public:
     //
     bool Intersects(const box3f& box) const;
 
+    //
+    //  Classifies an axis-aligned box against a single plane.
+    //
+    FrustumTest TestPlane(const box3f& box, size_t plane) const;
+
+    //
+    //  Classifies an axis-aligned box against the frustum, testing only the
+    //  planes which a containing box was found to intersect.
+    //
+    //  Parameters:
+    //      [in] box
+    //          Box to test.
+    //      [in,out] planeMask
+    //          On input, the planes to test; the box is taken to be inside the
+    //          rest. On output, the planes which the box intersects, to be
+    //          passed on when testing boxes it contains.
+    //      [in,out] lastFailedPlane
+    //          The plane which last rejected the box. It is tested first, and
+    //          updated if a different plane rejects the box.
+    //
+    //  Returns whether the box is outside, intersecting or inside the frustum.
+    //
+    FrustumTest Classify(const box3f& box,
+                         uint32_t& planeMask,
+                         uint32_t& lastFailedPlane) const;
+
+    //
+    //  Intersection test with a batch of axis-aligned boxes.
+    //
+    //  The boxes are tested four at a time with SSE; each plane's p-vertex is
+    //  chosen once for the whole batch since the plane normal is shared.
+    //
+    //  Parameters:
+    //      [in] batch
+    //          Boxes to test.
+    //      [in] count
+    //          Number of boxes in the batch, at most BoxBatch::MaxBoxes.
+    //
+    //  Returns a mask with bit i set if box i intersects the frustum.
+    //
+    uint32_t IntersectsBatch(const BoxBatch& batch, size_t count) const;
+
+    //
+    //  Intersection test with a batch of axis-aligned boxes, testing only the
+    //  planes which a box containing the whole batch was found to intersect.
+    //
+    //  Parameters:
+    //      [in] batch
+    //          Boxes to test.
+    //      [in] count
+    //          Number of boxes in the batch, at most BoxBatch::MaxBoxes.
+    //      [in] planeMask
+    //          The planes to test; the boxes are taken to be inside the rest.
+    //      [out] planeMasks
+    //          Receives the planes which each box intersects, as Classify
+    //          does. May be null.
+    //      [in,out] lastFailedPlane
+    //          The plane which last rejected a box in the batch. It is tested
+    //          first, and updated if a different plane rejects a box.
+    //
+    //  Returns a mask with bit i set if box i intersects the frustum.
+    //
+    uint32_t IntersectsBatch(const BoxBatch& batch,
+                             size_t count,
+                             uint32_t planeMask,
+                             uint32_t* planeMasks,
+                             uint32_t& lastFailedPlane) const;
+
 private:
     //
     //  Extract from a matrix.
@@ -56,6 +156,17 @@ private:
     float4 m_planes[FrustumPlane_Max];
 };
 
+inline void BoxBatch::Set(size_t i, const box3f& box)
+{
+    assert(i < MaxBoxes);
+    minX[i] = box.first.x;
+    minY[i] = box.first.y;
+    minZ[i] = box.first.z;
+    maxX[i] = box.second.x;
+    maxY[i] = box.second.y;
+    maxZ[i] = box.second.z;
+}
+
 inline Frustum::Frustum()
 {
 }
@@ -96,5 +207,35 @@ inline bool Frustum::Intersects(const box3f& box) const
     return true;
 }
 
+inline FrustumTest Frustum::TestPlane(const box3f& box, size_t plane) const
+{
+    assert(plane < FrustumPlane_Max);
+    const float4& p = m_planes[plane];
+
+    //  The p-vertex is the corner furthest along the plane normal and the
+    //  n-vertex the corner opposite it.
+    float3 pv(p.x >= 0 ? box.second.x : box.first.x,
+              p.y >= 0 ? box.second.y : box.first.y,
+              p.z >= 0 ? box.second.z : box.first.z);
+    if ((p.x * pv.x) + (p.y * pv.y) + (p.z * pv.z) + p.w < 0.0f)
+    {
+        return FrustumTest_Outside;
+    }
+
+    float3 nv(p.x >= 0 ? box.first.x : box.second.x,
+              p.y >= 0 ? box.first.y : box.second.y,
+              p.z >= 0 ? box.first.z : box.second.z);
+    if ((p.x * nv.x) + (p.y * nv.y) + (p.z * nv.z) + p.w >= 0.0f)
+    {
+        return FrustumTest_Inside;
+    }
+    return FrustumTest_Intersects;
+}
+
+inline uint32_t Frustum::IntersectsBatch(const BoxBatch& batch, size_t count) const
+{
+    uint32_t lastFailedPlane = 0;
+    return IntersectsBatch(batch, count, AllPlanes, nullptr, lastFailedPlane);
+}
 
 #endif  //  __NYX_FRUSTUM_H__
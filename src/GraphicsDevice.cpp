@@ -9,32 +9,19 @@
 #include "Profiler.h"
 #include "RenderContext.h"
 #include "SkyRenderer.h"
+#include "UploadRing.h"
 #include "VoxelRenderer.h"
 
+//
+//  Initial size of the upload ring, in bytes.
+//
+static const size_t UploadRingCapacity = 4 * 1024 * 1024;
+
 GraphicsDevice::GraphicsDevice(HWND hwnd)
 {
     assert(hwnd);
 
-    //
-    //  Create the Direct3D device.
-    //
-    D3DCHECK(CreateDXGIFactory(__uuidof(IDXGIFactory), AttachPtr(m_factory)));
-    D3DCHECK(m_factory->EnumAdapters(0, AttachPtr(m_adapter)));
-
-    UINT flags = 0;
-#ifdef _DEBUG
-    flags = D3D11_CREATE_DEVICE_DEBUG;
-#endif
-    D3DCHECK(D3D11CreateDevice(m_adapter.get(),             //  pAdapter
-                               D3D_DRIVER_TYPE_UNKNOWN,     //  DriverType
-                               NULL,                        //  Software
-                               flags,                       //  Flags
-                               NULL,                        //  pFeatureLevels
-                               0,                           //  FeatureLevels
-                               D3D11_SDK_VERSION,           //  SDKVersion
-                               AttachPtr(m_device),         //  ppDevice
-                               &m_featureLevel,             //  pFeatureLevel
-                               AttachPtr(m_context)));      //  ppImmediateContext
+    CreateDevice(D3D_DRIVER_TYPE_UNKNOWN);
 
     //
     //  Create the swap chain.
@@ -73,6 +60,87 @@ GraphicsDevice::GraphicsDevice(HWND hwnd)
     boost::intrusive_ptr<ID3D11Texture2D> backBuffer;
     D3DCHECK(m_swapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), AttachPtr(backBuffer)));
 
+    CreateRenderTargets(*backBuffer,
+                        wndRect.right - wndRect.left,
+                        wndRect.bottom - wndRect.top);
+}
+
+GraphicsDevice::GraphicsDevice(size_t width,
+                               size_t height,
+                               D3D_DRIVER_TYPE driverType)
+{
+    assert(driverType != D3D_DRIVER_TYPE_UNKNOWN);
+
+    CreateDevice(driverType);
+
+    //
+    //  Create the offscreen color buffer.
+    //
+    boost::intrusive_ptr<ID3D11Texture2D> colorBuffer;
+    D3D11_TEXTURE2D_DESC colorBufferDesc =
+    {
+        width,                                              //  Width
+        height,                                             //  Height
+        1,                                                  //  MipLevels
+        1,                                                  //  ArraySize
+        DXGI_FORMAT_R8G8B8A8_UNORM,                         //  Format
+        {                                                   //  SampleDesc
+            1,                                              //      Count
+            0                                               //      Quality
+        },
+        D3D11_USAGE_DEFAULT,                                //  Usage
+        D3D11_BIND_RENDER_TARGET,                           //  BindFlags
+        0,                                                  //  CPUAccessFlags
+        0                                                   //  MiscFlags
+    };
+    D3DCHECK(m_device->CreateTexture2D(&colorBufferDesc,
+                                       NULL,
+                                       AttachPtr(colorBuffer)));
+
+    CreateRenderTargets(*colorBuffer, width, height);
+}
+
+GraphicsDevice::~GraphicsDevice()
+{
+}
+
+void GraphicsDevice::CreateDevice(D3D_DRIVER_TYPE driverType)
+{
+    //
+    //  Create the Direct3D device. Only an unknown driver type names an
+    //  adapter; the others pick their own.
+    //
+    D3DCHECK(CreateDXGIFactory(__uuidof(IDXGIFactory), AttachPtr(m_factory)));
+    if (driverType == D3D_DRIVER_TYPE_UNKNOWN)
+    {
+        D3DCHECK(m_factory->EnumAdapters(0, AttachPtr(m_adapter)));
+    }
+
+    UINT flags = 0;
+#ifdef _DEBUG
+    flags = D3D11_CREATE_DEVICE_DEBUG;
+#endif
+    D3DCHECK(D3D11CreateDevice(m_adapter.get(),             //  pAdapter
+                               driverType,                  //  DriverType
+                               NULL,                        //  Software
+                               flags,                       //  Flags
+                               NULL,                        //  pFeatureLevels
+                               0,                           //  FeatureLevels
+                               D3D11_SDK_VERSION,           //  SDKVersion
+                               AttachPtr(m_device),         //  ppDevice
+                               &m_featureLevel,             //  pFeatureLevel
+                               AttachPtr(m_context)));      //  ppImmediateContext
+
+    m_uploadRing.reset(new UploadRing(*this, UploadRingCapacity));
+}
+
+void GraphicsDevice::CreateRenderTargets(ID3D11Texture2D& colorBuffer,
+                                         size_t width,
+                                         size_t height)
+{
+    m_width = width;
+    m_height = height;
+
     D3D11_RENDER_TARGET_VIEW_DESC renderTargetViewDesc =
     {
         DXGI_FORMAT_R8G8B8A8_UNORM,                         //  Format
@@ -81,7 +149,7 @@ GraphicsDevice::GraphicsDevice(HWND hwnd)
             0                                               //      MipSlice
         }
     };
-    D3DCHECK(m_device->CreateRenderTargetView(backBuffer.get(),
+    D3DCHECK(m_device->CreateRenderTargetView(&colorBuffer,
                                               &renderTargetViewDesc,
                                               AttachPtr(m_renderTargetView)));
 
@@ -94,8 +162,8 @@ GraphicsDevice::GraphicsDevice(HWND hwnd)
     boost::intrusive_ptr<ID3D11Texture2D> depthStencilBuffer;
     D3D11_TEXTURE2D_DESC depthStencilBufferDesc =
     {
-        wndRect.right - wndRect.left,                       //  Width
-        wndRect.bottom - wndRect.top,                       //  Height
+        width,                                              //  Width
+        height,                                             //  Height
         1,                                                  //  MipLevels
         1,                                                  //  ArraySize
         DXGI_FORMAT_D24_UNORM_S8_UINT ,                     //  Format
@@ -133,8 +201,8 @@ GraphicsDevice::GraphicsDevice(HWND hwnd)
     {
         0.0f,                                               //  TopLeftX
         0.0f,                                               //  TopLeftY
-        static_cast<float>(wndRect.right - wndRect.left),   //  Width
-        static_cast<float>(wndRect.bottom - wndRect.top),   //  Height
+        static_cast<float>(width),                          //  Width
+        static_cast<float>(height),                         //  Height
         0.0f,                                               //  MinDepth
         1.0f                                                //  MaxDepth
     };
@@ -148,21 +216,28 @@ GraphicsDevice::GraphicsDevice(HWND hwnd)
     m_renderContext->PushViewport(viewport);
 }
 
-GraphicsDevice::~GraphicsDevice()
-{
-}
-
 void GraphicsDevice::Begin()
 {
 }
 
 void GraphicsDevice::End()
 {
-    static Profiler profiler("GraphicsDevice::End()\n");
+    static Profiler profiler("GraphicsDevice::End()");
     profiler.Begin();
 
-    m_swapChain->Present(0, 0);
+    m_uploadRing->EndFrame();
+    if (m_swapChain)
+    {
+        m_swapChain->Present(0, 0);
+    }
+    else
+    {
+        //  Nothing presents a headless frame, so submit its commands here;
+        //  otherwise readbacks polled without waiting might never complete
+        m_context->Flush();
+    }
     profiler.End();
+    m_renderContext->EndFrame();
 
     float clearColor[4] = {0.0f, 0.0f, 0.0f, 1.0f};
     m_context->ClearRenderTargetView(m_renderTargetView.get(), clearColor);
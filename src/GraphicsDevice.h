@@ -10,6 +10,7 @@
 //  Forward declarations.
 //
 class RenderContext;
+class UploadRing;
 
 //
 //  Encapsulates the graphics engine.
@@ -26,6 +27,27 @@ public:
     //
     GraphicsDevice(HWND hwnd);
 
+    //
+    //  Constructor for a headless device.
+    //
+    //  The device draws into an offscreen render target instead of a window.
+    //  By default it is created on the Direct3D null driver, which accepts
+    //  and validates every call but renders nothing. This measures the CPU
+    //  side of rendering without a GPU. Anything which reads back GPU results,
+    //  such as voxel processing, needs a hardware or WARP device instead.
+    //
+    //  Parameters:
+    //      [in] width
+    //          Width of the render target.
+    //      [in] height
+    //          Height of the render target.
+    //      [in] driverType
+    //          Driver to create the device on.
+    //
+    GraphicsDevice(size_t width,
+                   size_t height,
+                   D3D_DRIVER_TYPE driverType = D3D_DRIVER_TYPE_NULL);
+
     //
     //  Destructor.
     //
@@ -61,7 +83,40 @@ public:
     //
     RenderContext& GetRenderContext();
 
+    //
+    //  Returns the ring through which dynamic vertex data is uploaded.
+    //
+    UploadRing& GetUploadRing();
+
+    //
+    //  Returns true if the device is headless.
+    //
+    bool IsHeadless() const;
+
+    //
+    //  Returns the width of the render target, in pixels.
+    //
+    size_t GetWidth() const;
+
+    //
+    //  Returns the height of the render target, in pixels.
+    //
+    size_t GetHeight() const;
+
 private:
+    //
+    //  Creates the Direct3D device and immediate context.
+    //
+    void CreateDevice(D3D_DRIVER_TYPE driverType);
+
+    //
+    //  Creates the render target views, depth/stencil buffer and default
+    //  render context for a color buffer.
+    //
+    void CreateRenderTargets(ID3D11Texture2D& colorBuffer,
+                             size_t width,
+                             size_t height);
+
     //
     //  Properties.
     //
@@ -73,7 +128,10 @@ private:
     boost::intrusive_ptr<ID3D11RenderTargetView> m_renderTargetView;
     boost::intrusive_ptr<ID3D11DepthStencilView> m_depthStencilView;
     D3D_FEATURE_LEVEL m_featureLevel;
+    size_t m_width;
+    size_t m_height;
     std::unique_ptr<RenderContext> m_renderContext;
+    std::unique_ptr<UploadRing> m_uploadRing;
 };
 
 inline ID3D11Device& GraphicsDevice::GetD3DDevice()
@@ -94,4 +152,25 @@ inline RenderContext& GraphicsDevice::GetRenderContext()
     return *m_renderContext;
 }
 
+inline UploadRing& GraphicsDevice::GetUploadRing()
+{
+    assert(m_uploadRing);
+    return *m_uploadRing;
+}
+
+inline bool GraphicsDevice::IsHeadless() const
+{
+    return !m_swapChain;
+}
+
+inline size_t GraphicsDevice::GetWidth() const
+{
+    return m_width;
+}
+
+inline size_t GraphicsDevice::GetHeight() const
+{
+    return m_height;
+}
+
 #endif  // __NYX_GRAPHICSDEVICE_H__
@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Prefix.h"
+#include "Atomic.h"
+#include "Histogram.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//
+//  Returns the index of the highest set bit of a nonzero value.
+//
+static size_t GetHighestBit(uint64_t value)
+{
+    assert(value);
+#ifdef _MSC_VER
+    unsigned long index;
+    if (_BitScanReverse(&index, static_cast<unsigned long>(value >> 32)))
+    {
+        return index + 32;
+    }
+    _BitScanReverse(&index, static_cast<unsigned long>(value));
+    return index;
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+Histogram::Histogram()
+{
+    Reset();
+}
+
+Histogram::~Histogram()
+{
+}
+
+void Histogram::Record(uint64_t value)
+{
+    AtomicIncrement(&m_counts[GetBucket(value)]);
+    AtomicAdd(&m_sum, static_cast<int64_t>(value));
+}
+
+void Histogram::Reset()
+{
+    for (size_t i = 0; i < BucketCount; ++i)
+    {
+        m_counts[i] = 0;
+    }
+    m_sum = 0;
+}
+
+uint64_t Histogram::GetCount() const
+{
+    uint64_t count = 0;
+    for (size_t i = 0; i < BucketCount; ++i)
+    {
+        count += static_cast<uint32_t>(m_counts[i]);
+    }
+    return count;
+}
+
+uint64_t Histogram::GetSum() const
+{
+    return static_cast<uint64_t>(m_sum);
+}
+
+uint64_t Histogram::GetPercentile(double percentile) const
+{
+    assert(percentile >= 0 && percentile <= 100.0);
+
+    //  Take a copy, so that the total and the walk agree while other threads
+    //  keep recording
+    uint32_t counts[BucketCount];
+    uint64_t total = 0;
+    for (size_t i = 0; i < BucketCount; ++i)
+    {
+        counts[i] = static_cast<uint32_t>(m_counts[i]);
+        total += counts[i];
+    }
+    if (!total)
+    {
+        return 0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(ceil(percentile / 100.0 * total));
+    if (!rank)
+    {
+        rank = 1;
+    }
+    uint64_t cumulative = 0;
+    size_t bucket = 0;
+    for (; bucket < BucketCount - 1; ++bucket)
+    {
+        cumulative += counts[bucket];
+        if (cumulative >= rank)
+        {
+            break;
+        }
+    }
+
+    uint64_t start = GetBucketStart(bucket);
+    if (bucket < 2 * HalfSubBucketCount)
+    {
+        return start;
+    }
+    return start + ((GetBucketStart(bucket + 1) - start) / 2);
+}
+
+size_t Histogram::GetBucket(uint64_t value)
+{
+    uint64_t maxValue = (static_cast<uint64_t>(1) << MaxValueBits) - 1;
+    if (value > maxValue)
+    {
+        value = maxValue;
+    }
+    if (value < 2 * HalfSubBucketCount)
+    {
+        return static_cast<size_t>(value);
+    }
+
+    //  Keep the top SubBucketBits bits of the value
+    size_t shift = GetHighestBit(value) - (SubBucketBits - 1);
+    return static_cast<size_t>((shift * HalfSubBucketCount) + (value >> shift));
+}
+
+uint64_t Histogram::GetBucketStart(size_t bucket)
+{
+    if (bucket < 2 * HalfSubBucketCount)
+    {
+        return bucket;
+    }
+    size_t shift = (bucket / HalfSubBucketCount) - 1;
+    uint64_t subBucket = (bucket % HalfSubBucketCount) + HalfSubBucketCount;
+    return subBucket << shift;
+}
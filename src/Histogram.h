@@ -0,0 +1,89 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef __NYX_HISTOGRAM_H__
+#define __NYX_HISTOGRAM_H__
+
+//
+//  Counts values in logarithmic buckets, so that percentiles can be read
+//  back with a bounded relative error.
+//
+//  Values below 64 each have their own bucket. Above that, every power of
+//  two is split into 32 buckets, so a percentile is within about 3% of the
+//  true value across the whole range, which covers 2^40 (about 18 minutes
+//  in nanoseconds); larger values are clamped, except in the sum. Recording
+//  is two atomic additions, so any number of threads may record into the
+//  same histogram while another reads it.
+//
+class Histogram : public boost::noncopyable
+{
+public:
+    //
+    //  Constructor.
+    //
+    Histogram();
+
+    //
+    //  Destructor.
+    //
+    ~Histogram();
+
+    //
+    //  Records a value.
+    //
+    void Record(uint64_t value);
+
+    //
+    //  Forgets every recorded value. Values recorded concurrently may or may
+    //  not survive.
+    //
+    void Reset();
+
+    //
+    //  Returns the number of recorded values.
+    //
+    uint64_t GetCount() const;
+
+    //
+    //  Returns the sum of the recorded values.
+    //
+    uint64_t GetSum() const;
+
+    //
+    //  Returns a percentile of the recorded values.
+    //
+    //  Parameters:
+    //      [in] percentile
+    //          Percentile to return, from 0 to 100.
+    //
+    //  Returns:
+    //      The middle of the bucket which holds the percentile, or zero if
+    //      nothing has been recorded.
+    //
+    uint64_t GetPercentile(double percentile) const;
+
+private:
+    //
+    //  Returns the bucket of a value.
+    //
+    static size_t GetBucket(uint64_t value);
+
+    //
+    //  Returns the smallest value in a bucket.
+    //
+    static uint64_t GetBucketStart(size_t bucket);
+
+    //
+    //  Properties.
+    //
+    static const size_t SubBucketBits = 6;
+    static const size_t HalfSubBucketCount = 1 << (SubBucketBits - 1);
+    static const size_t MaxValueBits = 40;
+    static const size_t BucketCount = (MaxValueBits - SubBucketBits + 2) * HalfSubBucketCount;
+    volatile int32_t m_counts[BucketCount];
+    volatile int64_t m_sum;
+};
+
+#endif  // __NYX_HISTOGRAM_H__
@@ -9,12 +9,12 @@
 #include "RenderContext.h"
 #include "LineRenderer.h"
 #include "SceneManager.h"
+#include "UploadRing.h"
 
 std::weak_ptr<LineRenderer::SharedProperties> LineRenderer::m_sharedWeakPtr;
 
 LineRenderer::LineRenderer(GraphicsDevice& graphicsDevice)
-: m_graphicsDevice(graphicsDevice),
-  m_vertexBufferSize(0)
+: m_graphicsDevice(graphicsDevice)
 {
     if (!m_sharedWeakPtr.expired())
     {
@@ -215,8 +215,6 @@ void LineRenderer::Flush(RenderContext& renderContext,
     m_constants.projectionViewMatrix = sceneConstants.projectionMatrix *
                                        sceneConstants.viewMatrix;
 
-    ID3D11DeviceContext& context = m_graphicsDevice.GetD3DContext();
-
     if (!m_vertices.size())
     {
         return;
@@ -225,76 +223,35 @@ void LineRenderer::Flush(RenderContext& renderContext,
     //
     //  Update the constant buffer.
     //
-    D3D11_MAPPED_SUBRESOURCE map;
-    D3DCHECK(m_graphicsDevice.GetD3DContext().Map(m_shared->constantBuffer.get(),   //  pResource
-                                                 0,                                 //  Subresource
-                                                 D3D11_MAP_WRITE_DISCARD,           //  MapType
-                                                 0,                                 //  MapFlags
-                                                 &map));                            //  pMappedResource
-    memcpy(map.pData, &m_constants, sizeof(m_constants));
-    m_graphicsDevice.GetD3DContext().Unmap(m_shared->constantBuffer.get(), 0);
+    memcpy(renderContext.Map(m_shared->constantBuffer.get(), D3D11_MAP_WRITE_DISCARD),
+           &m_constants,
+           sizeof(m_constants));
+    renderContext.Unmap(m_shared->constantBuffer.get());
 
     //
-    //  Update the vertex buffer.
+    //  Upload the vertices.
     //
-    if (m_vertexBufferSize < m_vertices.size())
-    {
-        m_vertexBufferSize = m_vertices.size();
-        D3D11_SUBRESOURCE_DATA vertexBufferData =
-        {
-            m_vertices.data(),                                              //  pSysMem
-            0,                                                              //  SysMemPitch
-            0                                                               //  SysMemSlicePitch
-        };
-        D3D11_BUFFER_DESC vertexBufferDesc =
-        {
-            m_vertexBufferSize * sizeof(Vertex),                            //  ByteWidth
-            D3D11_USAGE_DYNAMIC,                                            //  Usage
-            D3D11_BIND_VERTEX_BUFFER,                                       //  BindFlags
-            D3D11_CPU_ACCESS_WRITE,                                         //  CPUAccessFlags
-            0,                                                              //  MiscFlags
-            0                                                               //  StructureByteStride
-        };
-        D3DCHECK(m_graphicsDevice.GetD3DDevice().CreateBuffer(&vertexBufferDesc,
-                                                              &vertexBufferData,
-                                                              AttachPtr(m_shared->vertexBuffer)));
-    }
-    else
-    {
-        D3D11_MAPPED_SUBRESOURCE map;
-        D3DCHECK(m_graphicsDevice.GetD3DContext().Map(m_shared->vertexBuffer.get(),     //  pResource
-                                                     0,                                 //  Subresource
-                                                     D3D11_MAP_WRITE_DISCARD,           //  MapType
-                                                     0,                                 //  MapFlags
-                                                     &map));                            //  pMappedResource
-        memcpy(map.pData, m_vertices.data(), m_vertices.size() * sizeof(Vertex));
-        m_graphicsDevice.GetD3DContext().Unmap(m_shared->vertexBuffer.get(), 0);
-    }
+    size_t offset = m_graphicsDevice.GetUploadRing().Upload(renderContext,
+                                                            m_vertices.data(),
+                                                            m_vertices.size() * sizeof(Vertex),
+                                                            sizeof(Vertex));
 
     //
     //  Execute the render op.
     //
-    ID3D11Buffer* vertexBufferPtr = m_shared->vertexBuffer.get();
-    size_t offset = 0,
-           stride = sizeof(Vertex);
-
-    context.IASetVertexBuffers(0, 1, &vertexBufferPtr, &stride, &offset);
-    context.IASetIndexBuffer(NULL, DXGI_FORMAT_R16_UINT, 0);
-    context.IASetInputLayout(m_shared->inputLayout.get());
-    context.IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
-
-    ID3D11Buffer* constantBufferPtr = m_shared->constantBuffer.get();
-    context.VSSetConstantBuffers(0, 1, &constantBufferPtr);
-    context.VSSetShader(m_shared->vertexShader.get(), NULL, 0);
-
-    context.GSSetShader(NULL, NULL, 0);
-
-    context.PSSetShader(m_shared->pixelShader.get(), NULL, 0);
+    renderContext.SetVertexBuffer(0,
+                                  m_graphicsDevice.GetUploadRing().GetBuffer(),
+                                  sizeof(Vertex),
+                                  offset);
+    renderContext.SetIndexBuffer(NULL, DXGI_FORMAT_R16_UINT);
+    renderContext.SetInputLayout(m_shared->inputLayout.get(), D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
+    renderContext.SetShaders(m_shared->vertexShader.get(), NULL, m_shared->pixelShader.get());
+    renderContext.SetConstantBuffer(0, m_shared->constantBuffer.get());
 
     renderContext.PushRasterizerState(m_shared->rasterizerState);
     renderContext.PushDepthStencilState(m_shared->depthStencilState);
 
-    context.Draw(m_vertices.size(), 0);
+    renderContext.Draw(m_vertices.size(), 0);
 
     renderContext.PopRasterizerState();
     renderContext.PopDepthStencilState();
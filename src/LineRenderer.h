@@ -90,7 +90,6 @@ private:
         boost::intrusive_ptr<ID3D11Buffer> constantBuffer;
         boost::intrusive_ptr<ID3D11RasterizerState> rasterizerState;
         boost::intrusive_ptr<ID3D11DepthStencilState> depthStencilState;
-        boost::intrusive_ptr<ID3D11Buffer> vertexBuffer;
     };
     struct ShaderConstants
     {
@@ -99,9 +98,7 @@ private:
     static std::weak_ptr<SharedProperties> m_sharedWeakPtr;
     GraphicsDevice& m_graphicsDevice;
     std::shared_ptr<SharedProperties> m_shared;
-    boost::intrusive_ptr<ID3D11Buffer> m_vertexBuffer;
     std::vector<Vertex> m_vertices;
-    uint m_vertexBufferSize;
     ShaderConstants m_constants;
 };
 
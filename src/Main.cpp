@@ -5,9 +5,14 @@
 
 #include "Prefix.h"
 #include "Camera.h"
+#include "FlightPath.h"
 #include "Font.h"
 #include "GraphicsDevice.h"
+#include "Histogram.h"
 #include "LineRenderer.h"
+#include "Metrics.h"
+#include "MetricsServer.h"
+#include "Profiler.h"
 #include "SkyRenderer.h"
 #include "VoxelManager.h"
 #include "VoxelRenderer.h"
@@ -18,6 +23,11 @@ const TCHAR* WindowName = _T("Nyx");
 const DWORD WindowStyle = WS_OVERLAPPEDWINDOW ^ WS_SIZEBOX;
 const size_t WindowWidth = 1024;
 const size_t WindowHeight = 768;
+const char* TracePath = "Nyx.trace.json";
+const char* StatisticsPath = "Nyx.profile.csv";
+const char* MetricsPath = "Nyx.metrics.prom";
+const char* FlightPathPath = "Nyx.flightpath.txt";
+const uint16_t MetricsPort = 9400;
 
 LRESULT CALLBACK WindowProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam)
 {
@@ -47,9 +57,10 @@ bool PumpMessageQueue()
 	return true;
 }
 
-int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
+int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR cmdLine, int)
 {
     HWND hwnd = 0;
+    Profiler::SetThreadName("Main");
 	try
 	{
         WNDCLASSEX wc;
@@ -77,8 +88,13 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
                                      NULL));                        //  lpParam 
         ShowWindow(hwnd, SW_SHOW);
 
+        MetricsRegistry metrics;
         GraphicsDevice graphicsDevice(hwnd);
         SceneManager sceneManager(graphicsDevice);
+        MetricsServer metricsServer(metrics, MetricsPort);
+        sceneManager.SetMetrics(metrics);
+        Histogram& frameTimes = metrics.GetHistogram("nyx_frame_time_microseconds", "Time between frames.");
+        Counter& frameCount = metrics.GetCounter("nyx_frames_total", "Frames drawn.");
 
         uint64_t lastTime, curTime, elapsedTime, pcFreq;
         const float TicksPerSecond = 60.0f;
@@ -91,6 +107,7 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
         float3 position = float3(0, 2000.0f, 0);
         float roll = 0.0f,
               pitch = 0.0f;
+        float4 rotation = float4::IdentityQuaternion();
         bool mouseDown;
         float speed;
 
@@ -103,12 +120,22 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
 
         bool showGrid = false;
 
+        //  With -record, the session is recorded so that it can be replayed by
+        //  NyxReplay. It is off otherwise, since the path grows by a tick every
+        //  frame for as long as the session lasts.
+        bool recordFlightPath = cmdLine && strstr(cmdLine, "-record") != nullptr;
+        FlightPath flightPath;
+        static Profiler frameProfiler("Frame");
+
         while (PumpMessageQueue())
         {
+            ProfileScope frameScope(frameProfiler);
             QueryPerformanceCounter(reinterpret_cast<LARGE_INTEGER*>(&curTime));
             elapsedTime = curTime - lastTime;
             lastTime = curTime;
             ticks = ((float)elapsedTime / (float)pcFreq) * TicksPerSecond;
+            frameTimes.Record((elapsedTime * 1000000) / pcFreq);
+            frameCount.Add(1);
 
             showGrid = GetAsyncKeyState(VK_CONTROL);
 
@@ -131,8 +158,8 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
                     if (roll > XM_PIDIV2) {
                         roll = XM_PIDIV2;
                     }
-                    float4 rot = float4::RotationQuaternion(roll, pitch, 0);
-                    camera.SetRotation(rot);
+                    rotation = float4::RotationQuaternion(roll, pitch, 0);
+                    camera.SetRotation(rotation);
                     ShowCursor(FALSE);
                 }
                 mouseDown = true;
@@ -163,9 +190,25 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
                 position += camera.GetRightVector() * (speed * ticks);
             }
             camera.SetPosition(position);
+            if (recordFlightPath)
+            {
+                flightPath.Add(position, rotation);
+            }
             sceneManager.Update();
             sceneManager.SetCamera(camera);
             sceneManager.Draw();
+            metricsServer.Poll();
+        }
+
+        //  Keep the last frames of the session for chrome://tracing, the time
+        //  percentiles of the whole session, the final metrics and, if it was
+        //  recorded, the path flown
+        Profiler::WriteTrace(TracePath);
+        Profiler::WriteStatistics(StatisticsPath, Profiler::StatisticsFormat_Csv);
+        metrics.WriteFile(MetricsPath);
+        if (recordFlightPath)
+        {
+            flightPath.Save(FlightPathPath);
         }
     }
 	catch (std::exception& e)
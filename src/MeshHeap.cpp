@@ -0,0 +1,407 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Prefix.h"
+#include "BuddyAllocator.h"
+#include "GraphicsDevice.h"
+#include "MeshHeap.h"
+#include "Profiler.h"
+
+//
+//  A pool is compacted when more of its free space than this lies outside
+//  its largest free block.
+//
+static const float CompactionThreshold = 0.5f;
+
+//
+//  Statistics for tuning the heap, reported on exit.
+//
+static struct HeapStatistics
+{
+    std::array<size_t, MeshHeap::Pool_Count> pagesCreated;
+    std::array<size_t, MeshHeap::Pool_Count> pagesReleased;
+    std::array<size_t, MeshHeap::Pool_Count> peakCapacity;
+    std::array<size_t, MeshHeap::Pool_Count> compactions;
+    std::array<size_t, MeshHeap::Pool_Count> failedCompactions;
+    std::array<size_t, MeshHeap::Pool_Count> blocksMoved;
+    std::array<uint64_t, MeshHeap::Pool_Count> bytesMoved;
+    std::array<double, MeshHeap::Pool_Count> fragmentationSum;
+    std::array<float, MeshHeap::Pool_Count> maxFragmentation;
+    std::array<double, MeshHeap::Pool_Count> roundingWasteSum;
+    size_t sampleCount;
+
+    HeapStatistics()
+    : sampleCount(0)
+    {
+        pagesCreated.fill(0);
+        pagesReleased.fill(0);
+        peakCapacity.fill(0);
+        compactions.fill(0);
+        failedCompactions.fill(0);
+        blocksMoved.fill(0);
+        bytesMoved.fill(0);
+        fragmentationSum.fill(0);
+        maxFragmentation.fill(0);
+        roundingWasteSum.fill(0);
+    }
+
+    ~HeapStatistics()
+    {
+        if (sampleCount)
+        {
+            const char* poolNames[] = {"Vertex", "Index"};
+            char buffer[512];
+            OutputDebugStringA("========================= MESH HEAP STATISTICS =========================\n");
+            for (size_t pool = 0; pool < MeshHeap::Pool_Count; ++pool)
+            {
+                sprintf_s(buffer,
+                          "%s pool:\n"
+                          "    Pages created: %u\n    Pages released: %u\n    Peak capacity: %.02f MB\n"
+                          "    Fragmentation: %.02f%% average, %.02f%% peak\n    Rounding waste: %.02f%%\n"
+                          "    Compactions: %u (%u failed)\n    Blocks moved: %u\n    Bytes moved: %.02f MB\n",
+                          poolNames[pool],
+                          pagesCreated[pool],
+                          pagesReleased[pool],
+                          peakCapacity[pool] / (1024.0 * 1024.0),
+                          100.0 * fragmentationSum[pool] / sampleCount,
+                          100.0 * maxFragmentation[pool],
+                          100.0 * roundingWasteSum[pool] / sampleCount,
+                          compactions[pool],
+                          failedCompactions[pool],
+                          blocksMoved[pool],
+                          bytesMoved[pool] / (1024.0 * 1024.0));
+                OutputDebugStringA(buffer);
+            }
+        }
+    }
+} s_heapStatistics;
+
+MeshHeap::MeshHeap(GraphicsDevice& graphicsDevice, size_t vertexSize)
+: m_graphicsDevice(graphicsDevice)
+{
+    PoolState& vertexPool = m_pools[Pool_Vertex];
+    vertexPool.elementSize = vertexSize;
+    vertexPool.pageCapacity = VertexPageCapacity;
+    vertexPool.minBlockCount = MinVertexBlock;
+    vertexPool.bindFlags = D3D11_BIND_VERTEX_BUFFER;
+
+    PoolState& indexPool = m_pools[Pool_Index];
+    indexPool.elementSize = sizeof(uint16_t);
+    indexPool.pageCapacity = IndexPageCapacity;
+    indexPool.minBlockCount = MinIndexBlock;
+    indexPool.bindFlags = D3D11_BIND_INDEX_BUFFER;
+
+    for (size_t pool = 0; pool < Pool_Count; ++pool)
+    {
+        m_pools[pool].usedCount = 0;
+        m_pools[pool].failedUsedCount = 0;
+    }
+}
+
+MeshHeap::~MeshHeap()
+{
+}
+
+MeshHeap::Block* MeshHeap::Allocate(Pool pool, size_t count)
+{
+    if (!count)
+    {
+        return nullptr;
+    }
+
+    Block* block = new Block();
+    block->pool = pool;
+    block->count = count;
+    if (!AllocateInPages(*block, m_pools[pool].pages.size()))
+    {
+        block->page = CreatePage(pool, count);
+        block->offset = m_pools[pool].pages[block->page]->allocator->Allocate(count);
+        assert(block->offset != BuddyAllocator::InvalidOffset);
+    }
+    AttachBlock(*block);
+    m_pools[pool].usedCount += count;
+    return block;
+}
+
+void MeshHeap::Free(Block* block)
+{
+    if (block)
+    {
+        m_pools[block->pool].pages[block->page]->allocator->Free(block->offset);
+        m_pools[block->pool].usedCount -= block->count;
+        DetachBlock(*block);
+        delete block;
+    }
+}
+
+ID3D11Buffer* MeshHeap::GetBuffer(const Block& block) const
+{
+    return m_pools[block.pool].pages[block.page]->buffer.get();
+}
+
+void MeshHeap::CopyFrom(const Block& block, ID3D11Buffer* source)
+{
+    CopyRange(block.pool, source, 0, block.page, block.offset, block.count);
+}
+
+void MeshHeap::Compact()
+{
+    static Profiler profiler("MeshHeap::Compact()");
+    profiler.Begin();
+
+    for (size_t i = 0; i < Pool_Count; ++i)
+    {
+        Pool pool = static_cast<Pool>(i);
+        PoolState& state = m_pools[pool];
+
+        //  Sample the pool for the exit report
+        float fragmentation = GetFragmentation(pool);
+        size_t allocatedCount = 0, pageCount = 0, emptiestPage = 0;
+        for (size_t page = 0; page < state.pages.size(); ++page)
+        {
+            if (state.pages[page])
+            {
+                allocatedCount += state.pages[page]->allocator->GetAllocatedSize();
+                if (!pageCount++ || state.pages[page]->usedCount < state.pages[emptiestPage]->usedCount)
+                {
+                    emptiestPage = page;
+                }
+            }
+        }
+        s_heapStatistics.fragmentationSum[pool] += fragmentation;
+        s_heapStatistics.maxFragmentation[pool] = max(s_heapStatistics.maxFragmentation[pool], fragmentation);
+        if (allocatedCount)
+        {
+            s_heapStatistics.roundingWasteSum[pool] += 1.0 - static_cast<double>(state.usedCount) / allocatedCount;
+        }
+
+        //  A failed evacuation isn't retried until the pool has changed
+        if (pageCount > 1 &&
+            fragmentation > CompactionThreshold &&
+            state.usedCount != state.failedUsedCount)
+        {
+            if (EvacuatePage(pool, emptiestPage))
+            {
+                s_heapStatistics.compactions[pool]++;
+            }
+            else
+            {
+                state.failedUsedCount = state.usedCount;
+                s_heapStatistics.failedCompactions[pool]++;
+            }
+        }
+    }
+    s_heapStatistics.sampleCount++;
+    profiler.End();
+}
+
+size_t MeshHeap::GetCapacity(Pool pool) const
+{
+    const PoolState& state = m_pools[pool];
+    size_t capacity = 0;
+    for (size_t page = 0; page < state.pages.size(); ++page)
+    {
+        if (state.pages[page])
+        {
+            capacity += state.pages[page]->allocator->GetCapacity();
+        }
+    }
+    return capacity * state.elementSize;
+}
+
+size_t MeshHeap::GetBytesUsed(Pool pool) const
+{
+    return m_pools[pool].usedCount * m_pools[pool].elementSize;
+}
+
+float MeshHeap::GetFragmentation(Pool pool) const
+{
+    const PoolState& state = m_pools[pool];
+    size_t freeCount = 0, largestFreeBlock = 0;
+    for (size_t page = 0; page < state.pages.size(); ++page)
+    {
+        if (state.pages[page])
+        {
+            const BuddyAllocator& allocator = *state.pages[page]->allocator;
+            freeCount += allocator.GetCapacity() - allocator.GetAllocatedSize();
+            largestFreeBlock = max(largestFreeBlock, allocator.GetLargestFreeBlock());
+        }
+    }
+    if (!freeCount)
+    {
+        return 0.0f;
+    }
+    return 1.0f - static_cast<float>(largestFreeBlock) / static_cast<float>(freeCount);
+}
+
+bool MeshHeap::AllocateInPages(Block& block, size_t excludedPage)
+{
+    PoolState& state = m_pools[block.pool];
+    for (size_t page = 0; page < state.pages.size(); ++page)
+    {
+        if (state.pages[page] && page != excludedPage)
+        {
+            size_t offset = state.pages[page]->allocator->Allocate(block.count);
+            if (offset != BuddyAllocator::InvalidOffset)
+            {
+                block.page = page;
+                block.offset = offset;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void MeshHeap::AttachBlock(Block& block)
+{
+    Page& page = *m_pools[block.pool].pages[block.page];
+    block.slot = page.blocks.size();
+    page.blocks.push_back(&block);
+    page.usedCount += block.count;
+}
+
+void MeshHeap::DetachBlock(Block& block)
+{
+    PoolState& state = m_pools[block.pool];
+    Page& page = *state.pages[block.page];
+    page.blocks[block.slot] = page.blocks.back();
+    page.blocks[block.slot]->slot = block.slot;
+    page.blocks.pop_back();
+    page.usedCount -= block.count;
+
+    if (page.blocks.empty())
+    {
+        size_t pageCount = 0;
+        for (size_t i = 0; i < state.pages.size(); ++i)
+        {
+            pageCount += state.pages[i] ? 1 : 0;
+        }
+        if (pageCount > 1)
+        {
+            state.pages[block.page].reset();
+            s_heapStatistics.pagesReleased[block.pool]++;
+        }
+    }
+}
+
+size_t MeshHeap::CreatePage(Pool pool, size_t count)
+{
+    PoolState& state = m_pools[pool];
+
+    //  Meshes too large for a page get a page of their own
+    size_t capacity = state.pageCapacity;
+    while (capacity < count)
+    {
+        capacity *= 2;
+    }
+
+    std::unique_ptr<Page> page(new Page());
+    page->allocator.reset(new BuddyAllocator(capacity, state.minBlockCount));
+    page->usedCount = 0;
+    D3D11_BUFFER_DESC bufferDesc =
+    {
+        capacity * state.elementSize,                               //  ByteWidth
+        D3D11_USAGE_DEFAULT,                                        //  Usage
+        state.bindFlags,                                            //  BindFlags
+        0,                                                          //  CPUAccessFlags
+        0,                                                          //  MiscFlags
+        0                                                           //  StructureByteStride
+    };
+    D3DCHECK(m_graphicsDevice.GetD3DDevice().CreateBuffer(&bufferDesc,
+                                                          NULL,
+                                                          AttachPtr(page->buffer)));
+
+    //  Reuse the slot of a released page, so that pages never move
+    size_t index = 0;
+    while (index < state.pages.size() && state.pages[index])
+    {
+        ++index;
+    }
+    if (index == state.pages.size())
+    {
+        state.pages.push_back(nullptr);
+    }
+    state.pages[index] = std::move(page);
+
+    s_heapStatistics.pagesCreated[pool]++;
+    s_heapStatistics.peakCapacity[pool] = max(s_heapStatistics.peakCapacity[pool], GetCapacity(pool));
+    return index;
+}
+
+bool MeshHeap::EvacuatePage(Pool pool, size_t page)
+{
+    PoolState& state = m_pools[pool];
+    Page& source = *state.pages[page];
+
+    //  Find room for every block before moving any of them
+    std::vector<Block> destinations(source.blocks.size());
+    for (size_t i = 0; i < source.blocks.size(); ++i)
+    {
+        destinations[i] = *source.blocks[i];
+        if (!AllocateInPages(destinations[i], page))
+        {
+            for (size_t j = 0; j < i; ++j)
+            {
+                state.pages[destinations[j].page]->allocator->Free(destinations[j].offset);
+            }
+            return false;
+        }
+    }
+
+    //  Copy the blocks out, then move them over; the page is released along
+    //  with its last block
+    for (size_t i = 0; i < destinations.size(); ++i)
+    {
+        CopyRange(pool,
+                  source.buffer.get(),
+                  source.blocks[i]->offset,
+                  destinations[i].page,
+                  destinations[i].offset,
+                  destinations[i].count);
+        s_heapStatistics.bytesMoved[pool] += destinations[i].count * state.elementSize;
+    }
+    s_heapStatistics.blocksMoved[pool] += destinations.size();
+
+    std::vector<Block*> blocks(source.blocks);
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        Block& block = *blocks[i];
+        state.pages[page]->allocator->Free(block.offset);
+        DetachBlock(block);
+        block.page = destinations[i].page;
+        block.offset = destinations[i].offset;
+        AttachBlock(block);
+    }
+    return true;
+}
+
+void MeshHeap::CopyRange(Pool pool,
+                         ID3D11Buffer* source,
+                         size_t sourceOffset,
+                         size_t page,
+                         size_t offset,
+                         size_t count)
+{
+    size_t elementSize = m_pools[pool].elementSize;
+    D3D11_BOX sourceBox =
+    {
+        sourceOffset * elementSize,                                 //  left
+        0,                                                          //  top
+        0,                                                          //  front
+        (sourceOffset + count) * elementSize,                       //  right
+        1,                                                          //  bottom
+        1                                                           //  back
+    };
+    m_graphicsDevice.GetD3DContext().CopySubresourceRegion(
+                                        m_pools[pool].pages[page]->buffer.get(),   //  pDstResource
+                                        0,                                          //  DstSubresource
+                                        offset * elementSize,                       //  DstX
+                                        0,                                          //  DstY
+                                        0,                                          //  DstZ
+                                        source,                                     //  pSrcResource
+                                        0,                                          //  SrcSubresource
+                                        &sourceBox);                                //  pSrcBox
+}
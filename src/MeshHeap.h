@@ -0,0 +1,205 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef __NYX_MESHHEAP_H__
+#define __NYX_MESHHEAP_H__
+
+//
+//  Forward declarations.
+//
+class BuddyAllocator;
+class GraphicsDevice;
+
+//
+//  Sub-allocates vertex and index ranges for meshes out of a few large
+//  buffers.
+//
+//  Each pool is a list of pages, and each page is one buffer whose space is
+//  handed out by a BuddyAllocator. Ranges are measured in elements, so that
+//  a mesh can be drawn straight from its page with a base vertex and start
+//  index. Pages are created as the pools grow and released once empty, and
+//  when a pool's free space grows too scattered, Compact() moves the blocks
+//  of its emptiest page into the others.
+//
+class MeshHeap : public boost::noncopyable
+{
+public:
+    //
+    //  Pools of ranges.
+    //
+    enum Pool
+    {
+        Pool_Vertex,
+        Pool_Index,
+        Pool_Count
+    };
+
+    //
+    //  A range allocated from a pool.
+    //
+    //  Compaction may move the range, so its page and offset must be read
+    //  each time the range is used.
+    //
+    struct Block
+    {
+        Pool pool;
+        size_t page;
+        size_t offset;
+        size_t count;
+        size_t slot;
+    };
+
+    //
+    //  Constructor.
+    //
+    //  Parameters:
+    //      [in] graphicsDevice
+    //          Parent GraphicsDevice instance.
+    //      [in] vertexSize
+    //          Size of a vertex, in bytes.
+    //
+    MeshHeap(GraphicsDevice& graphicsDevice, size_t vertexSize);
+
+    //
+    //  Destructor.
+    //
+    ~MeshHeap();
+
+    //
+    //  Allocates a range.
+    //
+    //  Parameters:
+    //      [in] pool
+    //          Pool to allocate from.
+    //      [in] count
+    //          Number of elements.
+    //
+    //  Returns:
+    //      The new block, or null if count is zero.
+    //
+    Block* Allocate(Pool pool, size_t count);
+
+    //
+    //  Frees a range.
+    //
+    void Free(Block* block);
+
+    //
+    //  Returns the buffer holding a range.
+    //
+    ID3D11Buffer* GetBuffer(const Block& block) const;
+
+    //
+    //  Copies data into a range from the start of another buffer.
+    //
+    void CopyFrom(const Block& block, ID3D11Buffer* source);
+
+    //
+    //  Compacts any pool whose free space is too scattered.
+    //
+    //  At most one page per pool is emptied per call, so that the copying is
+    //  spread across frames.
+    //
+    void Compact();
+
+    //
+    //  Returns the size of a pool's pages, in bytes.
+    //
+    size_t GetCapacity(Pool pool) const;
+
+    //
+    //  Returns the size of the ranges allocated from a pool, in bytes.
+    //
+    size_t GetBytesUsed(Pool pool) const;
+
+    //
+    //  Returns the fraction of a pool's free space which lies outside its
+    //  largest free block, from 0 towards 1.
+    //
+    float GetFragmentation(Pool pool) const;
+
+private:
+    //
+    //  A buffer and the allocator for its space.
+    //
+    struct Page
+    {
+        boost::intrusive_ptr<ID3D11Buffer> buffer;
+        std::unique_ptr<BuddyAllocator> allocator;
+        std::vector<Block*> blocks;
+        size_t usedCount;
+    };
+
+    //
+    //  Settings and pages of a pool.
+    //
+    struct PoolState
+    {
+        size_t elementSize;
+        size_t pageCapacity;
+        size_t minBlockCount;
+        UINT bindFlags;
+        size_t usedCount;
+        size_t failedUsedCount;
+        std::vector<std::unique_ptr<Page>> pages;
+    };
+
+    //
+    //  Allocates a block in an existing page other than an excluded one.
+    //
+    //  Returns:
+    //      True if a page had room.
+    //
+    bool AllocateInPages(Block& block, size_t excludedPage);
+
+    //
+    //  Adds a block to its page's list of blocks.
+    //
+    void AttachBlock(Block& block);
+
+    //
+    //  Removes a block from its page's list of blocks, releasing the page if
+    //  it empties and isn't the pool's only page.
+    //
+    void DetachBlock(Block& block);
+
+    //
+    //  Creates a page able to hold a number of elements.
+    //
+    //  Returns:
+    //      Index of the page.
+    //
+    size_t CreatePage(Pool pool, size_t count);
+
+    //
+    //  Moves every block out of a page.
+    //
+    //  Returns:
+    //      True if every block fit in the other pages.
+    //
+    bool EvacuatePage(Pool pool, size_t page);
+
+    //
+    //  Copies a range of elements into a page.
+    //
+    void CopyRange(Pool pool,
+                   ID3D11Buffer* source,
+                   size_t sourceOffset,
+                   size_t page,
+                   size_t offset,
+                   size_t count);
+
+    //
+    //  Properties.
+    //
+    static const size_t VertexPageCapacity = 1 << 18;
+    static const size_t IndexPageCapacity = 1 << 20;
+    static const size_t MinVertexBlock = 64;
+    static const size_t MinIndexBlock = 256;
+    GraphicsDevice& m_graphicsDevice;
+    std::array<PoolState, Pool_Count> m_pools;
+};
+
+#endif  // __NYX_MESHHEAP_H__
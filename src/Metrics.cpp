@@ -0,0 +1,185 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Prefix.h"
+#include "Atomic.h"
+#include "Histogram.h"
+#include "Metrics.h"
+
+//
+//  Quantiles written for each histogram.
+//
+static const double SummaryQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+static const size_t SummaryQuantileCount = sizeof(SummaryQuantiles) / sizeof(SummaryQuantiles[0]);
+
+//
+//  Appends a sample line to the text format.
+//
+static void AppendSample(std::string& text,
+                         const std::string& name,
+                         const char* suffix,
+                         const std::string& labels,
+                         const char* value)
+{
+    text += name;
+    text += suffix;
+    if (!labels.empty())
+    {
+        text += '{';
+        text += labels;
+        text += '}';
+    }
+    text += ' ';
+    text += value;
+    text += '\n';
+}
+
+void Counter::Add(int64_t value)
+{
+    assert(value >= 0);
+    AtomicAdd(&m_value, value);
+}
+
+void Counter::Set(int64_t total)
+{
+    //  A running total only grows, so taking the larger value keeps the count
+    //  monotonic even if two threads sample it at once
+    AtomicMax(&m_value, total);
+}
+
+MetricsRegistry::MetricsRegistry()
+{
+}
+
+MetricsRegistry::~MetricsRegistry()
+{
+}
+
+Counter& MetricsRegistry::GetCounter(const std::string& name,
+                                     const std::string& help,
+                                     const std::string& labels)
+{
+    return *GetMetric(MetricType_Counter, name, help, labels).counter;
+}
+
+Gauge& MetricsRegistry::GetGauge(const std::string& name,
+                                 const std::string& help,
+                                 const std::string& labels)
+{
+    return *GetMetric(MetricType_Gauge, name, help, labels).gauge;
+}
+
+Histogram& MetricsRegistry::GetHistogram(const std::string& name,
+                                         const std::string& help,
+                                         const std::string& labels)
+{
+    return *GetMetric(MetricType_Histogram, name, help, labels).histogram;
+}
+
+std::string MetricsRegistry::Format() const
+{
+    //  Samples of the same name must be written together, under a single
+    //  HELP and TYPE
+    std::vector<const Metric*> metrics;
+    metrics.reserve(m_metrics.size());
+    std::for_each(m_metrics.begin(), m_metrics.end(), [&](const std::unique_ptr<Metric>& metric)
+    {
+        metrics.push_back(metric.get());
+    });
+    std::stable_sort(metrics.begin(), metrics.end(), [](const Metric* a, const Metric* b)
+    {
+        return a->name < b->name;
+    });
+
+    std::string text;
+    char value[64];
+    for (size_t i = 0; i < metrics.size(); ++i)
+    {
+        const Metric& metric = *metrics[i];
+        if (i == 0 || metrics[i - 1]->name != metric.name)
+        {
+            static const char* typeNames[] = {"counter", "gauge", "summary"};
+            text += "# HELP " + metric.name + " " + metric.help + "\n";
+            text += "# TYPE " + metric.name + " " + typeNames[metric.type] + "\n";
+        }
+
+        switch (metric.type)
+        {
+        case MetricType_Counter:
+            sprintf_s(value, "%lld", static_cast<long long>(metric.counter->GetValue()));
+            AppendSample(text, metric.name, "", metric.labels, value);
+            break;
+
+        case MetricType_Gauge:
+            sprintf_s(value, "%.9g", metric.gauge->GetValue());
+            AppendSample(text, metric.name, "", metric.labels, value);
+            break;
+
+        case MetricType_Histogram:
+            for (size_t j = 0; j < SummaryQuantileCount; ++j)
+            {
+                char quantile[64];
+                sprintf_s(quantile, "quantile=\"%g\"", SummaryQuantiles[j]);
+                std::string labels = metric.labels.empty() ? std::string(quantile) : metric.labels + "," + quantile;
+                sprintf_s(value, "%llu", static_cast<unsigned long long>(metric.histogram->GetPercentile(SummaryQuantiles[j] * 100.0)));
+                AppendSample(text, metric.name, "", labels, value);
+            }
+            sprintf_s(value, "%llu", static_cast<unsigned long long>(metric.histogram->GetSum()));
+            AppendSample(text, metric.name, "_sum", metric.labels, value);
+            sprintf_s(value, "%llu", static_cast<unsigned long long>(metric.histogram->GetCount()));
+            AppendSample(text, metric.name, "_count", metric.labels, value);
+            break;
+        }
+    }
+    return text;
+}
+
+void MetricsRegistry::WriteFile(const char* path) const
+{
+    std::string text = Format();
+
+    FILE* file = nullptr;
+    CHECK(SystemError, fopen_s(&file, path, "w") == 0 && file);
+    fwrite(text.data(), 1, text.size(), file);
+    fclose(file);
+}
+
+MetricsRegistry::Metric& MetricsRegistry::GetMetric(MetricType type,
+                                                    const std::string& name,
+                                                    const std::string& help,
+                                                    const std::string& labels)
+{
+    auto it = std::find_if(m_metrics.begin(), m_metrics.end(), [&](const std::unique_ptr<Metric>& metric)
+    {
+        return metric->name == name && metric->labels == labels;
+    });
+    if (it != m_metrics.end())
+    {
+        CHECK(SystemError, (*it)->type == type);
+        return **it;
+    }
+
+    std::unique_ptr<Metric> metric(new Metric());
+    metric->type = type;
+    metric->name = name;
+    metric->help = help;
+    metric->labels = labels;
+    switch (type)
+    {
+    case MetricType_Counter:
+        metric->counter.reset(new Counter());
+        break;
+
+    case MetricType_Gauge:
+        metric->gauge.reset(new Gauge());
+        break;
+
+    case MetricType_Histogram:
+        metric->histogram.reset(new Histogram());
+        break;
+    }
+    m_metrics.push_back(std::move(metric));
+    return *m_metrics.back();
+}
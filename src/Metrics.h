@@ -0,0 +1,197 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef __NYX_METRICS_H__
+#define __NYX_METRICS_H__
+
+//
+//  Forward declarations.
+//
+class Histogram;
+
+//
+//  A monotonically increasing count.
+//
+class Counter : public boost::noncopyable
+{
+public:
+    //
+    //  Constructor.
+    //
+    Counter();
+
+    //
+    //  Adds to the count.
+    //
+    void Add(int64_t value);
+
+    //
+    //  Sets the count from a running total kept elsewhere, which must never
+    //  decrease.
+    //
+    void Set(int64_t total);
+
+    //
+    //  Returns the count.
+    //
+    int64_t GetValue() const;
+
+private:
+    //
+    //  Properties.
+    //
+    volatile int64_t m_value;
+};
+
+//
+//  A value sampled at a point in time.
+//
+class Gauge : public boost::noncopyable
+{
+public:
+    //
+    //  Constructor.
+    //
+    Gauge();
+
+    //
+    //  Sets the value.
+    //
+    void Set(double value);
+
+    //
+    //  Returns the value.
+    //
+    double GetValue() const;
+
+private:
+    //
+    //  Properties.
+    //
+    volatile double m_value;
+};
+
+//
+//  Named counters, gauges and histograms describing the running state of the
+//  engine, which can be written out in the Prometheus text format.
+//
+//  Metrics are created once, and the references returned stay valid for the
+//  life of the registry, so owners keep them and update them each frame
+//  without looking them up again. Updating a metric never takes a lock, but
+//  creating one must not race with formatting the registry.
+//
+class MetricsRegistry : public boost::noncopyable
+{
+public:
+    //
+    //  Constructor.
+    //
+    MetricsRegistry();
+
+    //
+    //  Destructor.
+    //
+    ~MetricsRegistry();
+
+    //
+    //  Returns a metric, creating it on first use.
+    //
+    //  Parameters:
+    //      [in] name
+    //          Name of the metric, such as "nyx_pending_nodes".
+    //      [in] help
+    //          Description of the metric.
+    //      [in] labels
+    //          Labels telling apart metrics of the same name, such as
+    //          "depth=\"2\"", or an empty string.
+    //
+    Counter& GetCounter(const std::string& name,
+                        const std::string& help,
+                        const std::string& labels = std::string());
+    Gauge& GetGauge(const std::string& name,
+                    const std::string& help,
+                    const std::string& labels = std::string());
+    Histogram& GetHistogram(const std::string& name,
+                            const std::string& help,
+                            const std::string& labels = std::string());
+
+    //
+    //  Returns every metric in the Prometheus text exposition format.
+    //
+    //  Histograms are written as summaries, with their p50, p90, p99 and
+    //  p99.9 as quantiles, and their sum and count.
+    //
+    std::string Format() const;
+
+    //
+    //  Writes every metric to a file, in the format returned by Format().
+    //
+    void WriteFile(const char* path) const;
+
+private:
+    //
+    //  Kinds of metric.
+    //
+    enum MetricType
+    {
+        MetricType_Counter,
+        MetricType_Gauge,
+        MetricType_Histogram
+    };
+
+    //
+    //  A registered metric.
+    //
+    struct Metric
+    {
+        MetricType type;
+        std::string name;
+        std::string help;
+        std::string labels;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+    };
+
+    //
+    //  Returns a metric, creating it on first use.
+    //
+    Metric& GetMetric(MetricType type,
+                      const std::string& name,
+                      const std::string& help,
+                      const std::string& labels);
+
+    //
+    //  Properties.
+    //
+    std::vector<std::unique_ptr<Metric>> m_metrics;
+};
+
+inline Counter::Counter()
+: m_value(0)
+{
+}
+
+inline int64_t Counter::GetValue() const
+{
+    return m_value;
+}
+
+inline Gauge::Gauge()
+: m_value(0)
+{
+}
+
+inline void Gauge::Set(double value)
+{
+    m_value = value;
+}
+
+inline double Gauge::GetValue() const
+{
+    return m_value;
+}
+
+#endif  // __NYX_METRICS_H__
@@ -0,0 +1,220 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Prefix.h"
+#include "Metrics.h"
+#include "MetricsServer.h"
+#include "Profiler.h"
+
+//
+//  Most connections served at once, and the longest request read, in bytes.
+//  Anything beyond either is dropped.
+//
+static const size_t MaxClientCount = 8;
+static const size_t MaxRequestLength = 8192;
+
+//
+//  Time a connection is given to send its request and read the response, in
+//  seconds. Slower clients are dropped, so they can't hold on to a slot.
+//
+static const double ClientTimeout = 5.0;
+
+//
+//  Closes a connection.
+//
+static void CloseSocket(SOCKET socket)
+{
+    shutdown(socket, SD_BOTH);
+    closesocket(socket);
+}
+
+MetricsServer::MetricsServer(const MetricsRegistry& registry, uint16_t port)
+: m_registry(registry),
+  m_started(false),
+  m_listener(INVALID_SOCKET)
+{
+    WSADATA data;
+    if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+    {
+        OutputDebugStringA("Metrics server: Winsock is unavailable\n");
+        return;
+    }
+    m_started = true;
+
+    m_listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (m_listener == INVALID_SOCKET)
+    {
+        OutputDebugStringA("Metrics server: could not create a socket\n");
+        return;
+    }
+
+    //  Only listen on the loopback interface; the metrics are not meant to be
+    //  reachable from other machines
+    sockaddr_in address;
+    ZeroMemory(&address, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    u_long nonBlocking = 1;
+    if (bind(m_listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR ||
+        listen(m_listener, SOMAXCONN) == SOCKET_ERROR ||
+        ioctlsocket(m_listener, FIONBIO, &nonBlocking) == SOCKET_ERROR)
+    {
+        char buf[128];
+        sprintf_s(buf, "Metrics server: could not listen on port %u (error %d)\n", static_cast<uint>(port), WSAGetLastError());
+        OutputDebugStringA(buf);
+        closesocket(m_listener);
+        m_listener = INVALID_SOCKET;
+        return;
+    }
+
+    char buf[128];
+    sprintf_s(buf, "Metrics server: serving http://127.0.0.1:%u/metrics\n", static_cast<uint>(port));
+    OutputDebugStringA(buf);
+}
+
+MetricsServer::~MetricsServer()
+{
+    for (size_t i = 0; i < m_clients.size(); ++i)
+    {
+        CloseSocket(m_clients[i].socket);
+    }
+    if (m_listener != INVALID_SOCKET)
+    {
+        closesocket(m_listener);
+    }
+    if (m_started)
+    {
+        WSACleanup();
+    }
+}
+
+void MetricsServer::Poll()
+{
+    if (m_listener == INVALID_SOCKET)
+    {
+        return;
+    }
+
+    static Profiler profiler("MetricsServer::Poll()");
+    profiler.Begin();
+
+    //  Accepted sockets inherit the listener's non-blocking mode
+    SOCKET accepted;
+    while ((accepted = accept(m_listener, nullptr, nullptr)) != INVALID_SOCKET)
+    {
+        if (m_clients.size() >= MaxClientCount)
+        {
+            CloseSocket(accepted);
+            continue;
+        }
+        Client client;
+        client.socket = accepted;
+        client.sentBytes = 0;
+        client.acceptTicks = Profiler::GetTicks();
+        m_clients.push_back(client);
+    }
+
+    uint64_t timeoutTicks = static_cast<uint64_t>(ClientTimeout * Profiler::GetTicksPerSecond());
+    for (size_t i = 0; i < m_clients.size(); )
+    {
+        Client& client = m_clients[i];
+        bool done = false;
+        if (client.response.empty())
+        {
+            char buf[1024];
+            int result;
+            while ((result = recv(client.socket, buf, sizeof(buf), 0)) > 0)
+            {
+                client.request.append(buf, result);
+            }
+            if (client.request.find("\r\n\r\n") != std::string::npos)
+            {
+                Respond(client);
+            }
+            else if (result == 0 ||
+                     (result == SOCKET_ERROR && WSAGetLastError() != WSAEWOULDBLOCK) ||
+                     client.request.size() > MaxRequestLength)
+            {
+                CloseSocket(client.socket);
+                done = true;
+            }
+        }
+        if (!client.response.empty())
+        {
+            done = SendResponse(client);
+        }
+        if (!done && Profiler::GetTicks() - client.acceptTicks > timeoutTicks)
+        {
+            CloseSocket(client.socket);
+            done = true;
+        }
+
+        if (done)
+        {
+            m_clients.erase(m_clients.begin() + i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    profiler.End();
+}
+
+void MetricsServer::Respond(Client& client)
+{
+    std::string& response = client.response;
+    const std::string& request = client.request;
+    if (request.compare(0, 13, "GET /metrics ") == 0 ||
+        request.compare(0, 13, "GET /metrics?") == 0)
+    {
+        std::string body = m_registry.Format();
+        char header[256];
+        sprintf_s(header,
+                  "HTTP/1.0 200 OK\r\n"
+                  "Content-Type: text/plain; version=0.0.4\r\n"
+                  "Content-Length: %u\r\n"
+                  "Connection: close\r\n"
+                  "\r\n",
+                  static_cast<uint>(body.size()));
+        response = header + body;
+    }
+    else
+    {
+        response = "HTTP/1.0 404 Not Found\r\n"
+                   "Content-Type: text/plain\r\n"
+                   "Content-Length: 10\r\n"
+                   "Connection: close\r\n"
+                   "\r\n"
+                   "Not found\n";
+    }
+}
+
+bool MetricsServer::SendResponse(Client& client)
+{
+    //  A client which stops reading keeps its slot, but never holds up the
+    //  frame
+    const std::string& response = client.response;
+    while (client.sentBytes < response.size())
+    {
+        int result = send(client.socket,
+                          response.data() + client.sentBytes,
+                          static_cast<int>(response.size() - client.sentBytes),
+                          0);
+        if (result == SOCKET_ERROR)
+        {
+            if (WSAGetLastError() == WSAEWOULDBLOCK)
+            {
+                return false;
+            }
+            break;
+        }
+        client.sentBytes += result;
+    }
+    CloseSocket(client.socket);
+    return true;
+}
@@ -0,0 +1,96 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef __NYX_METRICSSERVER_H__
+#define __NYX_METRICSSERVER_H__
+
+//
+//  Forward declarations.
+//
+class MetricsRegistry;
+
+//
+//  Serves a metrics registry over HTTP on the loopback interface, so that a
+//  local Prometheus can scrape http://127.0.0.1:<port>/metrics.
+//
+//  The server has no thread of its own: its sockets are non-blocking, and
+//  the owner polls it once a frame, so the registry is only ever formatted
+//  between frames. If the port can't be bound, the server stays inactive
+//  and the engine runs as usual.
+//
+class MetricsServer : public boost::noncopyable
+{
+public:
+    //
+    //  Constructor.
+    //
+    //  Parameters:
+    //      [in] registry
+    //          Registry to serve.
+    //      [in] port
+    //          Port to listen on.
+    //
+    MetricsServer(const MetricsRegistry& registry, uint16_t port);
+
+    //
+    //  Destructor.
+    //
+    ~MetricsServer();
+
+    //
+    //  Accepts new connections, answers every connection whose request has
+    //  arrived in full, and carries on sending responses the clients have
+    //  not yet taken. It never blocks.
+    //
+    void Poll();
+
+    //
+    //  Returns true if the server is listening.
+    //
+    bool IsListening() const;
+
+private:
+    //
+    //  A connection whose request is being read, or whose response is being
+    //  sent.
+    //
+    struct Client
+    {
+        SOCKET socket;
+        std::string request;
+        std::string response;
+        size_t sentBytes;
+        uint64_t acceptTicks;
+    };
+
+    //
+    //  Prepares the response to a request.
+    //
+    void Respond(Client& client);
+
+    //
+    //  Sends as much of a response as the socket will take without blocking,
+    //  and closes the connection once all of it has been sent.
+    //
+    //  Returns:
+    //      True if the connection has been closed.
+    //
+    static bool SendResponse(Client& client);
+
+    //
+    //  Properties.
+    //
+    const MetricsRegistry& m_registry;
+    bool m_started;
+    SOCKET m_listener;
+    std::vector<Client> m_clients;
+};
+
+inline bool MetricsServer::IsListening() const
+{
+    return m_listener != INVALID_SOCKET;
+}
+
+#endif  // __NYX_METRICSSERVER_H__
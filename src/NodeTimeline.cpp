@@ -0,0 +1,80 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Prefix.h"
+#include "Histogram.h"
+#include "NodeTimeline.h"
+#include "Profiler.h"
+
+NodeTimeline::NodeTimeline()
+: m_histograms(nullptr),
+  m_depth(0)
+{
+    m_ticks.fill(0);
+}
+
+void NodeTimeline::Start(const Histograms* histograms, size_t depth)
+{
+    m_histograms = histograms;
+    m_depth = depth;
+    m_ticks.fill(0);
+    m_ticks[Event_Created] = Profiler::GetTicks();
+}
+
+void NodeTimeline::Mark(Event event)
+{
+    assert(event > Event_Created && event < Event_Count);
+    if (m_ticks[event] || !m_ticks[Event_Created])
+    {
+        return;
+    }
+    uint64_t ticks = Profiler::GetTicks();
+    m_ticks[event] = ticks;
+    if (!m_histograms)
+    {
+        return;
+    }
+
+    if (m_ticks[event - 1])
+    {
+        Record(m_histograms->events[event], ticks - m_ticks[event - 1]);
+    }
+
+    uint64_t lifetime = ticks - m_ticks[Event_Created];
+    if (event == Event_FirstDrawn && m_depth < m_histograms->visible.size())
+    {
+        Record(m_histograms->visible[m_depth], lifetime);
+    }
+    else if (event == Event_Destroyed && !m_ticks[Event_FirstDrawn] && m_depth < m_histograms->abandoned.size())
+    {
+        Record(m_histograms->abandoned[m_depth], lifetime);
+    }
+}
+
+const char* NodeTimeline::GetEventName(Event event)
+{
+    static const char* names[Event_Count] =
+    {
+        "created",
+        "queued",
+        "dispatched",
+        "density_done",
+        "mesh_done",
+        "uploaded",
+        "first_drawn",
+        "destroyed"
+    };
+    assert(event < Event_Count);
+    return names[event];
+}
+
+void NodeTimeline::Record(Histogram* histogram, uint64_t ticks)
+{
+    static const uint64_t ticksPerSecond = Profiler::GetTicksPerSecond();
+    if (histogram)
+    {
+        histogram->Record((ticks * 1000000) / ticksPerSecond);
+    }
+}
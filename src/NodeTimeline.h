@@ -0,0 +1,127 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef __NYX_NODETIMELINE_H__
+#define __NYX_NODETIMELINE_H__
+
+//
+//  Forward declarations.
+//
+class Histogram;
+
+//
+//  Times at which a node reached each stage of its life, from creation to
+//  destruction.
+//
+//  Each event is stamped once, the first time it is marked. If the timeline
+//  has been given histograms, the time taken to reach an event from the one
+//  before it is recorded as the event is marked, in microseconds. Nodes which
+//  skip an event, such as those whose mesh turns out to be empty, record
+//  nothing for the event after it, so they don't skew its distribution.
+//
+class NodeTimeline
+{
+public:
+    //
+    //  Events in the life of a node, in the order they happen.
+    //
+    //  The density is done once the density field has been read back and its
+    //  cells listed, and the mesh once the stream output queries of the mesh
+    //  passes have returned. The mesh is uploaded once it has been copied
+    //  into the mesh heap.
+    //
+    enum Event
+    {
+        Event_Created,
+        Event_Queued,
+        Event_Dispatched,
+        Event_DensityDone,
+        Event_MeshDone,
+        Event_Uploaded,
+        Event_FirstDrawn,
+        Event_Destroyed,
+        Event_Count
+    };
+
+    //
+    //  Histograms the latencies are recorded into. Any of them may be null.
+    //
+    struct Histograms
+    {
+        //  Time taken to reach each event from the one before it; the entry
+        //  for Event_Created is unused
+        std::array<Histogram*, Event_Count> events;
+
+        //  Time from creation to first draw, by depth
+        std::vector<Histogram*> visible;
+
+        //  Time from creation to destruction of nodes which were never
+        //  drawn, by depth
+        std::vector<Histogram*> abandoned;
+    };
+
+    //
+    //  Constructor. No event is marked until Start() is called.
+    //
+    NodeTimeline();
+
+    //
+    //  Marks the node's creation.
+    //
+    //  Parameters:
+    //      [in] histograms
+    //          Histograms to record latencies into, or null. They must
+    //          outlive the timeline.
+    //      [in] depth
+    //          Depth of the node in the tree.
+    //
+    void Start(const Histograms* histograms, size_t depth);
+
+    //
+    //  Marks an event, unless it has been marked already.
+    //
+    void Mark(Event event);
+
+    //
+    //  Checks if an event has been marked.
+    //
+    bool IsMarked(Event event) const;
+
+    //
+    //  Returns the time an event was marked, in Profiler::GetTicks() ticks,
+    //  or zero if it has not been.
+    //
+    uint64_t GetTicks(Event event) const;
+
+    //
+    //  Returns the name of an event, such as "dispatched".
+    //
+    static const char* GetEventName(Event event);
+
+private:
+    //
+    //  Records a latency, if there is a histogram to record it into.
+    //
+    static void Record(Histogram* histogram, uint64_t ticks);
+
+    //
+    //  Properties.
+    //
+    const Histograms* m_histograms;
+    size_t m_depth;
+    std::array<uint64_t, Event_Count> m_ticks;
+};
+
+inline bool NodeTimeline::IsMarked(Event event) const
+{
+    return m_ticks[event] != 0;
+}
+
+inline uint64_t NodeTimeline::GetTicks(Event event) const
+{
+    return m_ticks[event];
+}
+
+#endif  // __NYX_NODETIMELINE_H__
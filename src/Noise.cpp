@@ -5,6 +5,7 @@
 
 #include "Prefix.h"
 #include "Noise.h"
+#include "Random.h"
 
 const XMFLOAT3 Noise::GradiantVectors[] = 
 {
@@ -32,12 +33,26 @@ const int Noise::Permutations[] =
 
 Noise::Noise()
 {
-    srand(time(0));
+    Shuffle(static_cast<uint32_t>(time(0)));
+}
+
+Noise::Noise(uint32_t seed)
+{
+    Shuffle(seed);
+}
+
+Noise::~Noise()
+{
+}
+
+void Noise::Shuffle(uint32_t seed)
+{
+    uint32_t state = seed;
     int shuffledPerms[256];
     memcpy(shuffledPerms, Permutations, sizeof(Permutations));
     for (size_t i = 255; i > 0; --i)
     {
-        size_t j = rand() % (i + 1);
+        size_t j = NextRandom(state) % (i + 1);
         std::swap(shuffledPerms[j], shuffledPerms[i]);
     }
     for (uint i = 0; i < 512; i++) {
@@ -45,10 +60,6 @@ Noise::Noise()
     }
 }
 
-Noise::~Noise()
-{
-}
-
 float Noise::SampleRange(float x, float y, float z, float a, float b)
 {
     float n = (1.0f + Sample(x, y, z)) * 0.5f;
@@ -14,10 +14,20 @@
 class Noise : public boost::noncopyable {
 public:
     //
-    //  Constructor.
+    //  Constructor. The permutation table is shuffled from the current time.
     //
     Noise();
 
+    //
+    //  Constructor. The permutation table is shuffled from a seed, so that
+    //  the same seed gives the same noise on every platform.
+    //
+    //  Parameters:
+    //      [in] seed
+    //          Seed for the shuffle.
+    //
+    explicit Noise(uint32_t seed);
+
     //
     //  Destructor.
     //
@@ -47,6 +57,11 @@ public:
     void Fill(float* ptr, size_t x, size_t y, size_t z, float xf, float yf, float zf);
 
 private:
+    //
+    //  Fills the permutation table with a shuffle of Permutations.
+    //
+    void Shuffle(uint32_t seed);
+
     //
     //  Properties.
     //
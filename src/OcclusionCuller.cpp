@@ -0,0 +1,294 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Prefix.h"
+#include "Camera.h"
+#include "OcclusionCuller.h"
+
+//
+//  Corners of each face of a box, indexed by face and then by vertex. Bit 0 of
+//  a corner index selects the maximum x, bit 1 y and bit 2 z. Faces are in the
+//  order -x, +x, -y, +y, -z, +z.
+//
+static const uint8_t FaceCorners[6][4] =
+{
+    {0, 2, 6, 4},
+    {1, 5, 7, 3},
+    {0, 4, 5, 1},
+    {2, 3, 7, 6},
+    {0, 1, 3, 2},
+    {4, 6, 7, 5}
+};
+
+OcclusionCuller::OcclusionCuller()
+: m_depth(Width * Height, 1.0f),
+  m_tiles(TilesX * TilesY, 1.0f),
+  m_occluderCount(0)
+{
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+}
+
+void OcclusionCuller::Begin(const Camera& camera)
+{
+    m_viewProjectionMatrix = camera.GetCombinedMatrix();
+    m_eyePosition = camera.GetPosition();
+    m_occluderCount = 0;
+    std::fill(m_depth.begin(), m_depth.end(), 1.0f);
+}
+
+void OcclusionCuller::RenderOccluder(const box3f& box)
+{
+    //  Only faces with the camera on their outer side are drawn, so an
+    //  occluder containing the camera draws nothing.
+    const float3& eye = m_eyePosition;
+    bool facing[6] =
+    {
+        eye.x < box.first.x,
+        eye.x > box.second.x,
+        eye.y < box.first.y,
+        eye.y > box.second.y,
+        eye.z < box.first.z,
+        eye.z > box.second.z
+    };
+    if (!(facing[0] || facing[1] || facing[2] || facing[3] || facing[4] || facing[5]))
+    {
+        return;
+    }
+
+    float4 corners[8];
+    for (size_t i = 0; i < 8; ++i)
+    {
+        corners[i] = Transform(float3((i & 1) ? box.second.x : box.first.x,
+                                      (i & 2) ? box.second.y : box.first.y,
+                                      (i & 4) ? box.second.z : box.first.z));
+    }
+
+    for (size_t face = 0; face < 6; ++face)
+    {
+        if (facing[face])
+        {
+            float4 vertices[4] =
+            {
+                corners[FaceCorners[face][0]],
+                corners[FaceCorners[face][1]],
+                corners[FaceCorners[face][2]],
+                corners[FaceCorners[face][3]]
+            };
+            RasterizePolygon(vertices, 4);
+        }
+    }
+    m_occluderCount++;
+}
+
+void OcclusionCuller::End()
+{
+    for (size_t ty = 0; ty < TilesY; ++ty)
+    {
+        for (size_t tx = 0; tx < TilesX; ++tx)
+        {
+            __m128 maxDepth = _mm_setzero_ps();
+            for (size_t y = 0; y < TileSize; ++y)
+            {
+                const float* row = &m_depth[((ty * TileSize) + y) * Width + (tx * TileSize)];
+                for (size_t x = 0; x < TileSize; x += 4)
+                {
+                    maxDepth = _mm_max_ps(maxDepth, _mm_loadu_ps(row + x));
+                }
+            }
+            maxDepth = _mm_max_ps(maxDepth, _mm_shuffle_ps(maxDepth, maxDepth, _MM_SHUFFLE(1, 0, 3, 2)));
+            maxDepth = _mm_max_ps(maxDepth, _mm_shuffle_ps(maxDepth, maxDepth, _MM_SHUFFLE(2, 3, 0, 1)));
+            _mm_store_ss(&m_tiles[(ty * TilesX) + tx], maxDepth);
+        }
+    }
+}
+
+bool OcclusionCuller::IsVisible(const box3f& box) const
+{
+    //
+    //  Find the box's screen rectangle and nearest depth.
+    //
+    float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX, minZ = FLT_MAX;
+    for (size_t i = 0; i < 8; ++i)
+    {
+        float4 v = Transform(float3((i & 1) ? box.second.x : box.first.x,
+                                    (i & 2) ? box.second.y : box.first.y,
+                                    (i & 4) ? box.second.z : box.first.z));
+        if (v.z < 0.0f || v.w <= 0.0f)
+        {
+            return true;
+        }
+        float x = ((v.x / v.w) * 0.5f + 0.5f) * Width,
+              y = (0.5f - (v.y / v.w) * 0.5f) * Height;
+        minX = min(minX, x);
+        maxX = max(maxX, x);
+        minY = min(minY, y);
+        maxY = max(maxY, y);
+        minZ = min(minZ, v.z / v.w);
+    }
+
+    int x0 = max(0, static_cast<int>(floor(minX))),
+        y0 = max(0, static_cast<int>(floor(minY))),
+        x1 = min(static_cast<int>(Width) - 1, static_cast<int>(ceil(maxX)) - 1),
+        y1 = min(static_cast<int>(Height) - 1, static_cast<int>(ceil(maxY)) - 1);
+    if (x0 > x1 || y0 > y1)
+    {
+        return true;
+    }
+
+    //
+    //  Tiles whose farthest occluder is in front of the box hide it; the
+    //  pixels of the rest are checked individually.
+    //
+    for (int ty = y0 / TileSize; ty <= y1 / TileSize; ++ty)
+    {
+        for (int tx = x0 / TileSize; tx <= x1 / TileSize; ++tx)
+        {
+            if (m_tiles[(ty * TilesX) + tx] < minZ)
+            {
+                continue;
+            }
+
+            int px0 = max(x0, tx * TileSize), px1 = min(x1, (tx * TileSize) + TileSize - 1),
+                py0 = max(y0, ty * TileSize), py1 = min(y1, (ty * TileSize) + TileSize - 1);
+            for (int y = py0; y <= py1; ++y)
+            {
+                const float* row = &m_depth[y * Width];
+                for (int x = px0; x <= px1; ++x)
+                {
+                    if (row[x] >= minZ)
+                    {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
+
+float4 OcclusionCuller::Transform(const float3& p) const
+{
+    const float4x4& m = m_viewProjectionMatrix;
+    return float4((p.x * m[0][0]) + (p.y * m[1][0]) + (p.z * m[2][0]) + m[3][0],
+                  (p.x * m[0][1]) + (p.y * m[1][1]) + (p.z * m[2][1]) + m[3][1],
+                  (p.x * m[0][2]) + (p.y * m[1][2]) + (p.z * m[2][2]) + m[3][2],
+                  (p.x * m[0][3]) + (p.y * m[1][3]) + (p.z * m[2][3]) + m[3][3]);
+}
+
+void OcclusionCuller::RasterizePolygon(const float4* vertices, size_t vertexCount)
+{
+    //
+    //  Clip against the near plane (z >= 0). Every other plane is handled by
+    //  the viewport bounds during rasterization.
+    //
+    float3 clipped[8];
+    size_t clippedCount = 0;
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        const float4& a = vertices[i];
+        const float4& b = vertices[(i + 1) % vertexCount];
+        if (a.z >= 0.0f)
+        {
+            clipped[clippedCount++] = float3(a.x / a.w, a.y / a.w, a.z / a.w);
+        }
+        if ((a.z >= 0.0f) != (b.z >= 0.0f))
+        {
+            float t = a.z / (a.z - b.z);
+            float4 v = a + ((b - a) * t);
+            clipped[clippedCount++] = float3(v.x / v.w, v.y / v.w, 0.0f);
+        }
+    }
+    if (clippedCount < 3)
+    {
+        return;
+    }
+
+    //  Convert to screen space and draw as a fan
+    for (size_t i = 0; i < clippedCount; ++i)
+    {
+        clipped[i].x = (clipped[i].x * 0.5f + 0.5f) * Width;
+        clipped[i].y = (0.5f - clipped[i].y * 0.5f) * Height;
+    }
+    for (size_t i = 2; i < clippedCount; ++i)
+    {
+        RasterizeTriangle(clipped[0], clipped[i - 1], clipped[i]);
+    }
+}
+
+void OcclusionCuller::RasterizeTriangle(float3 v0, float3 v1, float3 v2)
+{
+    float area = ((v1.x - v0.x) * (v2.y - v0.y)) - ((v1.y - v0.y) * (v2.x - v0.x));
+    if (area == 0.0f)
+    {
+        return;
+    }
+    if (area < 0.0f)
+    {
+        std::swap(v1, v2);
+        area = -area;
+    }
+
+    //  Pixels whose centers lie within the triangle's bounds
+    int x0 = max(0, static_cast<int>(ceil(min(v0.x, min(v1.x, v2.x)) - 0.5f))),
+        y0 = max(0, static_cast<int>(ceil(min(v0.y, min(v1.y, v2.y)) - 0.5f))),
+        x1 = min(static_cast<int>(Width) - 1, static_cast<int>(floor(max(v0.x, max(v1.x, v2.x)) - 0.5f))),
+        y1 = min(static_cast<int>(Height) - 1, static_cast<int>(floor(max(v0.y, max(v1.y, v2.y)) - 0.5f)));
+    if (x0 > x1 || y0 > y1)
+    {
+        return;
+    }
+
+    //
+    //  Edge functions are positive inside the triangle. They are offset by
+    //  half a pixel so that only pixels entirely covered by the triangle are
+    //  written, which keeps the occluder from hiding anything seen past its
+    //  edges. Depth is linear in screen space after the perspective divide,
+    //  and is likewise offset to the farthest depth within each pixel.
+    //
+    const float3* v[3] = {&v0, &v1, &v2};
+    __m128 edgeA[3], edgeB[3], edgeC[3];
+    for (size_t i = 0; i < 3; ++i)
+    {
+        const float3& a = *v[i];
+        const float3& b = *v[(i + 1) % 3];
+        float ea = a.y - b.y, eb = b.x - a.x;
+        edgeA[i] = _mm_set1_ps(ea);
+        edgeB[i] = _mm_set1_ps(eb);
+        edgeC[i] = _mm_set1_ps(((b.y - a.y) * a.x) - ((b.x - a.x) * a.y) - ((fabs(ea) + fabs(eb)) * 0.5f));
+    }
+    float dzdx = (((v1.z - v0.z) * (v2.y - v0.y)) - ((v2.z - v0.z) * (v1.y - v0.y))) / area,
+          dzdy = (((v2.z - v0.z) * (v1.x - v0.x)) - ((v1.z - v0.z) * (v2.x - v0.x))) / area;
+    __m128 depthA = _mm_set1_ps(dzdx),
+           depthB = _mm_set1_ps(dzdy),
+           depthC = _mm_set1_ps(v0.z - (dzdx * v0.x) - (dzdy * v0.y) + ((fabs(dzdx) + fabs(dzdy)) * 0.5f));
+
+    //  Rows are walked four pixels at a time from a multiple of four, which
+    //  stays within the buffer since the width is a multiple of four.
+    const __m128 zero = _mm_setzero_ps();
+    for (int y = y0; y <= y1; ++y)
+    {
+        __m128 py = _mm_set1_ps(y + 0.5f);
+        float* row = &m_depth[y * Width];
+        for (int x = x0 & ~3; x <= x1; x += 4)
+        {
+            __m128 px = _mm_add_ps(_mm_set1_ps(x + 0.5f), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+            __m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(edgeA[0], px), _mm_mul_ps(edgeB[0], py)), edgeC[0]), zero);
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(edgeA[1], px), _mm_mul_ps(edgeB[1], py)), edgeC[1]), zero));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(edgeA[2], px), _mm_mul_ps(edgeB[2], py)), edgeC[2]), zero));
+            if (!_mm_movemask_ps(inside))
+            {
+                continue;
+            }
+
+            __m128 depth = _mm_add_ps(_mm_add_ps(_mm_mul_ps(depthA, px), _mm_mul_ps(depthB, py)), depthC);
+            __m128 old = _mm_loadu_ps(row + x);
+            depth = _mm_min_ps(old, depth);
+            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, depth), _mm_andnot_ps(inside, old)));
+        }
+    }
+}
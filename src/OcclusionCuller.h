@@ -0,0 +1,116 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef __NYX_OCCLUSIONCULLER_H__
+#define __NYX_OCCLUSIONCULLER_H__
+
+//
+//  Forward declarations.
+//
+class Camera;
+
+//
+//  Software occlusion culler.
+//
+//  Occluders are rasterized on the CPU into a small depth buffer, which is
+//  then reduced to a hierarchical-Z buffer of per-tile maximum depths. Boxes
+//  are tested against the tiles first and against individual pixels only
+//  where a tile is inconclusive.
+//
+//  Occluders must lie entirely inside solid geometry so that nothing is
+//  culled which would have been visible.
+//
+class OcclusionCuller : public boost::noncopyable
+{
+public:
+    //
+    //  Dimensions of the depth buffer.
+    //
+    enum
+    {
+        Width = 256,
+        Height = 128,
+        TileSize = 8,
+        TilesX = Width / TileSize,
+        TilesY = Height / TileSize
+    };
+
+    //
+    //  Constructor.
+    //
+    OcclusionCuller();
+
+    //
+    //  Destructor.
+    //
+    ~OcclusionCuller();
+
+    //
+    //  Clears the depth buffer and begins rendering occluders.
+    //
+    //  Parameters:
+    //      [in] camera
+    //          Camera to render from.
+    //
+    void Begin(const Camera& camera);
+
+    //
+    //  Renders an occluder box.
+    //
+    //  Only the faces of the box facing the camera are rasterized, clipped
+    //  against the near plane.
+    //
+    void RenderOccluder(const box3f& box);
+
+    //
+    //  Finishes rendering occluders and builds the hierarchical-Z buffer.
+    //
+    void End();
+
+    //
+    //  Tests whether any part of a box may be visible past the occluders.
+    //
+    //  Boxes which cross the near plane or lie off screen are reported as
+    //  visible; the frustum test is left to decide those.
+    //
+    bool IsVisible(const box3f& box) const;
+
+    //
+    //  Returns the number of occluders rendered since Begin().
+    //
+    size_t GetOccluderCount() const;
+
+private:
+    //
+    //  Transforms a point to clip space.
+    //
+    float4 Transform(const float3& p) const;
+
+    //
+    //  Rasterizes a convex polygon given in clip space.
+    //
+    void RasterizePolygon(const float4* vertices, size_t vertexCount);
+
+    //
+    //  Rasterizes a triangle given in screen space, with depth in z.
+    //
+    void RasterizeTriangle(float3 v0, float3 v1, float3 v2);
+
+    //
+    //  Properties.
+    //
+    float4x4 m_viewProjectionMatrix;
+    float3 m_eyePosition;
+    std::vector<float> m_depth;
+    std::vector<float> m_tiles;
+    size_t m_occluderCount;
+};
+
+inline size_t OcclusionCuller::GetOccluderCount() const
+{
+    return m_occluderCount;
+}
+
+#endif  // __NYX_OCCLUSIONCULLER_H__
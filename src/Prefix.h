@@ -9,6 +9,7 @@
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
 #include <tchar.h>
+#include <winsock2.h>
 
 #include <d3d11.h>
 #include <D3DX11.h>
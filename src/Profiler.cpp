@@ -4,49 +4,382 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "Prefix.h"
+#include "Atomic.h"
+#include "Histogram.h"
 #include "Profiler.h"
 
+#ifndef _WIN32
+#include <time.h>
+#endif
+
+//
+//  Number of sequences each thread keeps, which must be a power of two.
+//
+static const size_t RingCapacity = 1 << 16;
+
+//
+//  Deepest nesting of sequences on a thread.
+//
+static const size_t MaxDepth = 64;
+
+//
+//  A completed sequence.
+//
+struct ProfileEvent
+{
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+    uint32_t depth;
+};
+
+//
+//  The sequences of one thread.
+//
+//  Only the owning thread writes to the ring. It fills in the event at the
+//  head and then publishes it by advancing the head, so a reader which
+//  samples the head before and after copying the events knows which of them
+//  may have been overwritten in the meantime.
+//
+struct ThreadRing
+{
+    ProfileEvent events[RingCapacity];
+    volatile uint64_t head;
+    const Profiler* profilers[MaxDepth];
+    uint64_t starts[MaxDepth];
+    size_t depth;
+    uint32_t threadId;
+    const char* volatile name;
+    ThreadRing* next;
+};
+
+//
+//  Rings of every thread which has profiled. Rings are only ever pushed onto
+//  the list, and live until the process exits.
+//
+static ThreadRing* volatile s_rings = nullptr;
+static volatile int64_t s_threadCount = 0;
+static THREAD_LOCAL ThreadRing* t_ring = nullptr;
+
+//
+//  Every profiler constructed so far, in the same push-only fashion.
+//
+static Profiler* volatile s_profilers = nullptr;
+
+//
+//  Time at which the trace starts.
+//
+static const uint64_t s_baseTicks = Profiler::GetTicks();
+
+//
+//  Scale from clock ticks to the nanoseconds held by the histograms.
+//
+static const double s_nanosecondsPerTick = 1.0e9 / Profiler::GetTicksPerSecond();
+
+//
+//  Percentiles written by WriteStatistics().
+//
+static const double ReportedPercentiles[] = {50.0, 90.0, 99.0, 99.9};
+static const char* ReportedPercentileNames[] = {"p50", "p90", "p99", "p99.9"};
+static const size_t ReportedPercentileCount = sizeof(ReportedPercentiles) / sizeof(ReportedPercentiles[0]);
+
+//
+//  Returns the calling thread's ring, creating it on first use.
+//
+static ThreadRing& GetThreadRing()
+{
+    ThreadRing* ring = t_ring;
+    if (!ring)
+    {
+        ring = new ThreadRing();
+        ring->threadId = static_cast<uint32_t>(AtomicAdd(&s_threadCount, 1));
+        ThreadRing* head;
+        do
+        {
+            head = s_rings;
+            ring->next = head;
+        }
+        while (AtomicCompareExchangePointer(reinterpret_cast<void* volatile*>(&s_rings), ring, head) != head);
+        t_ring = ring;
+    }
+    return *ring;
+}
+
+//
+//  Writes a string to a JSON file, quoted and escaped.
+//
+static void WriteJsonString(FILE* file, const char* str)
+{
+    fputc('"', file);
+    for (; *str; ++str)
+    {
+        unsigned char c = static_cast<unsigned char>(*str);
+        if (c == '"' || c == '\\')
+        {
+            fputc('\\', file);
+            fputc(c, file);
+        }
+        else if (c == '\n')
+        {
+            fputs("\\n", file);
+        }
+        else if (c < 0x20)
+        {
+            fprintf(file, "\\u%04x", c);
+        }
+        else
+        {
+            fputc(c, file);
+        }
+    }
+    fputc('"', file);
+}
+
 Profiler::Profiler(const char* name)
 : m_name(name),
-  m_totalTime(0),
   m_sequenceCount(0),
-  m_shortestTime(std::numeric_limits<double>::infinity()),
-  m_longestTime(-std::numeric_limits<double>::infinity())
+  m_totalTicks(0),
+  m_shortestTicks(INT64_MAX),
+  m_longestTicks(0),
+  m_histogram(new Histogram())
 {
+    Profiler* head;
+    do
+    {
+        head = s_profilers;
+        m_next = head;
+    }
+    while (AtomicCompareExchangePointer(reinterpret_cast<void* volatile*>(&s_profilers), this, head) != head);
 }
 
 Profiler::~Profiler()
 {
+    if (!m_sequenceCount)
+    {
+        return;
+    }
+
+    double frequency = static_cast<double>(GetTicksPerSecond());
+    double meanTime = (m_totalTicks / frequency) / static_cast<double>(m_sequenceCount),
+           shortestTime = m_shortestTicks / frequency,
+           longestTime = m_longestTicks / frequency;
+
     char buf[512];
     sprintf_s(buf, "Event: %s\nMean time: %.08f\t\t\t(%.04f)\nShortest time: %.08f\t\t\t(%.04f)\nLongest time: %.08f\t\t\t(%.04f)\n",
-                   m_name.c_str(),
-                   m_totalTime / static_cast<double>(m_sequenceCount), (m_totalTime / static_cast<double>(m_sequenceCount)) / (1 / 60.0),
-                   m_shortestTime, m_shortestTime / (1 / 60.0),
-                   m_longestTime, m_longestTime / (1 / 60.0));
+                   m_name,
+                   meanTime, meanTime / (1 / 60.0),
+                   shortestTime, shortestTime / (1 / 60.0),
+                   longestTime, longestTime / (1 / 60.0));
     OutputDebugStringA("===================== PROFILER RESULTS =====================\n");
     OutputDebugStringA(buf);
+    sprintf_s(buf, "p50: %.08f\tp90: %.08f\tp99: %.08f\tp99.9: %.08f\n",
+                   GetPercentile(50.0) / 1.0e9,
+                   GetPercentile(90.0) / 1.0e9,
+                   GetPercentile(99.0) / 1.0e9,
+                   GetPercentile(99.9) / 1.0e9);
+    OutputDebugStringA(buf);
 }
 
 void Profiler::Begin()
 {
-    QueryPerformanceCounter(reinterpret_cast<LARGE_INTEGER*>(&m_startTime));
+    ThreadRing& ring = GetThreadRing();
+    assert(ring.depth < MaxDepth);
+    ring.profilers[ring.depth] = this;
+    ring.starts[ring.depth] = GetTicks();
+    ring.depth++;
 }
 
 void Profiler::End()
 {
-    uint64_t endTime;
-    QueryPerformanceCounter(reinterpret_cast<LARGE_INTEGER*>(&endTime));
+    uint64_t end = GetTicks();
+    ThreadRing& ring = GetThreadRing();
+    assert(ring.depth > 0 && ring.profilers[ring.depth - 1] == this);
+    ring.depth--;
 
-    uint64_t pcFreq;
-    QueryPerformanceFrequency(reinterpret_cast<LARGE_INTEGER*>(&pcFreq));
+    //  Record the sequence, then publish it
+    uint64_t head = ring.head;
+    ProfileEvent& event = ring.events[head & (RingCapacity - 1)];
+    event.name = m_name;
+    event.start = ring.starts[ring.depth];
+    event.end = end;
+    event.depth = static_cast<uint32_t>(ring.depth);
+    FullBarrier();
+    ring.head = head + 1;
 
-    double elapsedTime = static_cast<double>(endTime - m_startTime) /
-                         static_cast<double>(pcFreq);
+    //  The same profiler may be timing other threads at once
+    int64_t ticks = static_cast<int64_t>(end - event.start);
+    AtomicAdd(&m_sequenceCount, 1);
+    AtomicAdd(&m_totalTicks, ticks);
+    AtomicMin(&m_shortestTicks, ticks);
+    AtomicMax(&m_longestTicks, ticks);
+    m_histogram->Record(static_cast<uint64_t>(ticks * s_nanosecondsPerTick));
+}
 
-    m_sequenceCount++;
-    m_totalTime += elapsedTime;
-    m_shortestTime = min(m_shortestTime, elapsedTime);
-    m_longestTime = max(m_longestTime, elapsedTime);
+uint64_t Profiler::GetPercentile(double percentile) const
+{
+    return m_histogram->GetPercentile(percentile);
 }
 
+const Histogram& Profiler::GetHistogram() const
+{
+    return *m_histogram;
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+    GetThreadRing().name = name;
+}
+
+void Profiler::WriteTrace(const char* path)
+{
+    FILE* file = nullptr;
+    CHECK(SystemError, fopen_s(&file, path, "w") == 0 && file);
+
+    double ticksPerMicrosecond = GetTicksPerSecond() / 1.0e6;
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+    bool first = true;
+    std::vector<ProfileEvent> events;
+    for (ThreadRing* ring = s_rings; ring; ring = ring->next)
+    {
+        //  Copy the ring, then drop whatever the thread may have overwritten
+        //  while it was being copied
+        uint64_t head = ring->head;
+        FullBarrier();
+        uint64_t begin = head > RingCapacity ? head - RingCapacity : 0;
+        events.clear();
+        for (uint64_t i = begin; i < head; ++i)
+        {
+            events.push_back(ring->events[i & (RingCapacity - 1)]);
+        }
+        FullBarrier();
+        uint64_t overwritten = ring->head;
+        overwritten = overwritten > RingCapacity ? overwritten - RingCapacity : 0;
+        size_t skip = static_cast<size_t>(overwritten > begin ? min(overwritten - begin, head - begin) : 0);
+
+        fprintf(file,
+                "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+                first ? "" : ",\n",
+                ring->threadId);
+        const char* name = ring->name;
+        if (name)
+        {
+            WriteJsonString(file, name);
+        }
+        else
+        {
+            fprintf(file, "\"Thread %u\"", ring->threadId);
+        }
+        fputs("}}", file);
+        first = false;
+
+        for (size_t i = skip; i < events.size(); ++i)
+        {
+            const ProfileEvent& event = events[i];
+            fputs(",\n{\"name\":", file);
+            WriteJsonString(file, event.name);
+            fprintf(file,
+                    ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"depth\":%u}}",
+                    static_cast<int64_t>(event.start - s_baseTicks) / ticksPerMicrosecond,
+                    (event.end - event.start) / ticksPerMicrosecond,
+                    ring->threadId,
+                    event.depth);
+        }
+    }
+    fputs("\n]}\n", file);
+    fclose(file);
+}
 
+void Profiler::WriteStatistics(const char* path, StatisticsFormat format)
+{
+    FILE* file = nullptr;
+    CHECK(SystemError, fopen_s(&file, path, "w") == 0 && file);
+
+    if (format == StatisticsFormat_Csv)
+    {
+        fputs("name,count,mean_ms,min_ms", file);
+        for (size_t i = 0; i < ReportedPercentileCount; ++i)
+        {
+            fprintf(file, ",%s_ms", ReportedPercentileNames[i]);
+        }
+        fputs(",max_ms\n", file);
+    }
+    else
+    {
+        fputs("{\"profilers\":[", file);
+    }
+
+    double millisecondsPerTick = 1.0e3 / GetTicksPerSecond();
+    for (const Profiler* profiler = s_profilers; profiler; profiler = profiler->m_next)
+    {
+        int64_t count = profiler->m_sequenceCount;
+        double mean = count ? profiler->m_totalTicks * millisecondsPerTick / count : 0.0,
+               shortest = count ? profiler->m_shortestTicks * millisecondsPerTick : 0.0,
+               longest = profiler->m_longestTicks * millisecondsPerTick;
+        if (format == StatisticsFormat_Csv)
+        {
+            //  Quote the name, doubling any quotes within it
+            fputc('"', file);
+            for (const char* c = profiler->m_name; *c; ++c)
+            {
+                if (*c == '"')
+                {
+                    fputc('"', file);
+                }
+                if (*c != '\n')
+                {
+                    fputc(*c, file);
+                }
+            }
+            fprintf(file, "\",%lld,%.6f,%.6f", count, mean, shortest);
+            for (size_t i = 0; i < ReportedPercentileCount; ++i)
+            {
+                fprintf(file, ",%.6f", profiler->GetPercentile(ReportedPercentiles[i]) / 1.0e6);
+            }
+            fprintf(file, ",%.6f\n", longest);
+        }
+        else
+        {
+            fputs(profiler == s_profilers ? "\n{\"name\":" : ",\n{\"name\":", file);
+            WriteJsonString(file, profiler->m_name);
+            fprintf(file, ",\"count\":%lld,\"mean_ms\":%.6f,\"min_ms\":%.6f", count, mean, shortest);
+            for (size_t i = 0; i < ReportedPercentileCount; ++i)
+            {
+                fprintf(file, ",\"%s_ms\":%.6f", ReportedPercentileNames[i], profiler->GetPercentile(ReportedPercentiles[i]) / 1.0e6);
+            }
+            fprintf(file, ",\"max_ms\":%.6f}", longest);
+        }
+    }
+
+    if (format == StatisticsFormat_Json)
+    {
+        fputs("\n]}\n", file);
+    }
+    fclose(file);
+}
+
+uint64_t Profiler::GetTicks()
+{
+#ifdef _WIN32
+    uint64_t ticks;
+    QueryPerformanceCounter(reinterpret_cast<LARGE_INTEGER*>(&ticks));
+    return ticks;
+#else
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return static_cast<uint64_t>(time.tv_sec) * 1000000000ull + time.tv_nsec;
+#endif
+}
+
+uint64_t Profiler::GetTicksPerSecond()
+{
+#ifdef _WIN32
+    static uint64_t frequency = 0;
+    if (!frequency)
+    {
+        QueryPerformanceFrequency(reinterpret_cast<LARGE_INTEGER*>(&frequency));
+    }
+    return frequency;
+#else
+    return 1000000000ull;
+#endif
+}
@@ -6,15 +6,46 @@
 #ifndef __NYX_PROFILER_H__
 #define __NYX_PROFILER_H__
 
-class Profiler
+//
+//  Forward declarations.
+//
+class Histogram;
+
+//
+//  Times a named event.
+//
+//  Profilers are usually function-static, and may be used from any thread.
+//  Sequences nest: each thread keeps a stack of the sequences it has begun,
+//  and every completed sequence is recorded into a ring buffer owned by the
+//  thread, which only that thread writes to. The rings of all threads can be
+//  exported as a Chrome trace (chrome://tracing) at any time.
+//
+//  Each profiler also keeps a histogram of its sequence times, from which
+//  percentiles can be read while it runs. The statistics of every profiler
+//  can be written out as CSV or JSON, and are reported at exit.
+//
+class Profiler : public boost::noncopyable
 {
 public:
+    //
+    //  File formats for WriteStatistics().
+    //
+    enum StatisticsFormat
+    {
+        StatisticsFormat_Csv,
+        StatisticsFormat_Json
+    };
+
     //
     //  Constructor.
     //
+    //  Profilers are expected to be static: once constructed, a profiler is
+    //  listed for WriteStatistics() until the process exits.
+    //
     //  Parameters:
     //      [in] name
-    //          Name of the event to be profiled.
+    //          Name of the event to be profiled. The string is referenced by
+    //          the trace, so it must outlive the profiler.
     //
     Profiler(const char* name);
 
@@ -24,25 +55,122 @@ public:
     ~Profiler();
 
     //
-    //  Begins a sequence.
+    //  Begins a sequence on the calling thread.
     //
     void Begin();
 
     //
-    //  Ends a sequence.
+    //  Ends the sequence most recently begun on the calling thread, which
+    //  must belong to this profiler.
     //
     void End();
 
+    //
+    //  Returns a percentile of the sequence times, in nanoseconds.
+    //
+    //  Parameters:
+    //      [in] percentile
+    //          Percentile to return, from 0 to 100.
+    //
+    uint64_t GetPercentile(double percentile) const;
+
+    //
+    //  Returns the histogram of the sequence times, in nanoseconds.
+    //
+    const Histogram& GetHistogram() const;
+
+    //
+    //  Names the calling thread in the trace.
+    //
+    //  Parameters:
+    //      [in] name
+    //          Name of the thread. The string must outlive the thread's ring.
+    //
+    static void SetThreadName(const char* name);
+
+    //
+    //  Writes the sequences recorded by every thread to a Chrome trace file.
+    //
+    //  Threads may keep profiling while the trace is written; sequences they
+    //  overwrite during the copy are left out.
+    //
+    //  Parameters:
+    //      [in] path
+    //          Path of the JSON file to write.
+    //
+    static void WriteTrace(const char* path);
+
+    //
+    //  Writes the count, mean, shortest, longest and percentile times of
+    //  every profiler to a file.
+    //
+    //  Parameters:
+    //      [in] path
+    //          Path of the file to write.
+    //      [in] format
+    //          Format of the file.
+    //
+    static void WriteStatistics(const char* path, StatisticsFormat format);
+
+    //
+    //  Returns the current time of a monotonic clock, in ticks.
+    //
+    static uint64_t GetTicks();
+
+    //
+    //  Returns the frequency of the clock behind GetTicks().
+    //
+    static uint64_t GetTicksPerSecond();
+
+private:
+    //
+    //  Properties.
+    //
+    const char* m_name;
+    volatile int64_t m_sequenceCount;
+    volatile int64_t m_totalTicks;
+    volatile int64_t m_shortestTicks;
+    volatile int64_t m_longestTicks;
+    std::unique_ptr<Histogram> m_histogram;
+    Profiler* m_next;
+};
+
+//
+//  Profiles the lifetime of a scope.
+//
+class ProfileScope : public boost::noncopyable
+{
+public:
+    //
+    //  Constructor. Begins a sequence.
+    //
+    //  Parameters:
+    //      [in] profiler
+    //          Profiler of the scope.
+    //
+    ProfileScope(Profiler& profiler);
+
+    //
+    //  Destructor. Ends the sequence.
+    //
+    ~ProfileScope();
+
 private:
     //
     //  Properties.
     //
-    std::string m_name;
-    uint64_t m_startTime;
-    size_t m_sequenceCount;
-    double m_totalTime;
-    double m_shortestTime;
-    double m_longestTime;
+    Profiler& m_profiler;
 };
 
+inline ProfileScope::ProfileScope(Profiler& profiler)
+: m_profiler(profiler)
+{
+    m_profiler.Begin();
+}
+
+inline ProfileScope::~ProfileScope()
+{
+    m_profiler.End();
+}
+
 #endif  // __NYX_PROFILER_H__
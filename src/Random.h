@@ -0,0 +1,29 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef __NYX_RANDOM_H__
+#define __NYX_RANDOM_H__
+
+//
+//  Advances a seeded random number generator.
+//
+//  Unlike rand(), the sequence is the same under every C runtime, so a seed
+//  always gives the same noise and the same benchmark inputs. This is
+//  Numerical Recipes' LCG, taking the high 24 bits of the state.
+//
+//  Parameters:
+//      [in,out] state
+//          State of the generator, initially the seed.
+//
+//  Returns:
+//      The next value, from 0 to 2^24 - 1.
+//
+inline uint32_t NextRandom(uint32_t& state)
+{
+    state = (state * 1664525u) + 1013904223u;
+    return state >> 8;
+}
+
+#endif  // __NYX_RANDOM_H__
@@ -7,10 +7,37 @@
 #include "GraphicsDevice.h"
 #include "RenderContext.h"
 
+//
+//  Viewports are shadowed by value.
+//
+static bool operator==(const D3D11_VIEWPORT& a, const D3D11_VIEWPORT& b)
+{
+    return memcmp(&a, &b, sizeof(D3D11_VIEWPORT)) == 0;
+}
+
+//
+//  Updates a shadowed binding.
+//
+//  Returns:
+//      True if the value differs from what is bound, and must be issued.
+//
+template <typename B, typename T>
+static bool Rebind(B& binding, const T& value)
+{
+    if (binding.valid && binding.value == value)
+    {
+        return false;
+    }
+    binding.value = value;
+    binding.valid = true;
+    return true;
+}
+
 RenderContext::RenderContext(GraphicsDevice& graphicsDevice,  
                              boost::intrusive_ptr<ID3D11DeviceContext> context)
 : m_graphicsDevice(graphicsDevice),
-  m_d3dContext(context)
+  m_d3dContext(context),
+  m_frameCount(0)
 {
     ID3D11Device& device = m_graphicsDevice.GetD3DDevice();
 
@@ -87,121 +114,441 @@ RenderContext::RenderContext(GraphicsDevice& graphicsDevice,
 
 RenderContext::~RenderContext()
 {
+    if (m_frameCount)
+    {
+        char buffer[256];
+        OutputDebugStringA("======================== RENDER CONTEXT STATISTICS ========================\n");
+        sprintf_s(buffer, "Frames:                  %u\n", m_frameCount);
+        OutputDebugStringA(buffer);
+        sprintf_s(buffer, "Draws per frame:         %.1f\n", double(m_totalCallCounts.draws) / m_frameCount);
+        OutputDebugStringA(buffer);
+        sprintf_s(buffer, "Maps per frame:          %.1f\n", double(m_totalCallCounts.maps) / m_frameCount);
+        OutputDebugStringA(buffer);
+        sprintf_s(buffer, "Bindings per frame:      %.1f\n", double(m_totalCallCounts.bindings) / m_frameCount);
+        OutputDebugStringA(buffer);
+        sprintf_s(buffer, "State changes per frame: %.1f\n", double(m_totalCallCounts.states) / m_frameCount);
+        OutputDebugStringA(buffer);
+        sprintf_s(buffer, "Calls per frame:         %.1f\n", double(m_totalCallCounts.GetTotal()) / m_frameCount);
+        OutputDebugStringA(buffer);
+        size_t changes = m_totalCallCounts.bindings + m_totalCallCounts.states + m_totalCallCounts.elided;
+        sprintf_s(buffer, "Elided per frame:        %.1f\t(%.1f%% of bindings and state changes)\n",
+                  double(m_totalCallCounts.elided) / m_frameCount,
+                  changes ? 100.0 * m_totalCallCounts.elided / changes : 0.0);
+        OutputDebugStringA(buffer);
+    }
 }
 
 void RenderContext::PushRasterizerState(boost::intrusive_ptr<ID3D11RasterizerState> rs)
 {
     assert(rs);
-    m_d3dContext->RSSetState(rs.get());
     m_rasterizerStateStack.push(rs);
+    ApplyRasterizerState();
 }
 
 void RenderContext::PopRasterizerState()
 {
     assert(m_rasterizerStateStack.size() > 1);
     m_rasterizerStateStack.pop();
-    m_d3dContext->RSSetState(m_rasterizerStateStack.top().get());
+    ApplyRasterizerState();
 }
 
 void RenderContext::PushDepthStencilState(boost::intrusive_ptr<ID3D11DepthStencilState> ds)
 {
     assert(ds);
-    m_d3dContext->OMSetDepthStencilState(ds.get(), 0);
     m_depthStencilStateStack.push(ds);
+    ApplyDepthStencilState();
 }
 
 void RenderContext::PopDepthStencilState()
 {
     assert(m_depthStencilStateStack.size() > 1);
     m_depthStencilStateStack.pop();
-    m_d3dContext->OMSetDepthStencilState(m_depthStencilStateStack.top().get(), 0);
+    ApplyDepthStencilState();
 }
 
 void RenderContext::PushBlendState(boost::intrusive_ptr<ID3D11BlendState> bs)
 {
     assert(bs);
-    float factors[] = {1.0f, 1.0f, 1.0f, 1.0f};
-    m_d3dContext->OMSetBlendState(bs.get(), factors, 0xFFFFFFFF);
     m_blendStateStack.push(bs);
+    ApplyBlendState();
 }
 
 void RenderContext::PopBlendState()
 {
     assert(m_blendStateStack.size() > 1);
     m_blendStateStack.pop();
-    float factors[] = {1.0f, 1.0f, 1.0f, 1.0f};
-    m_d3dContext->OMSetBlendState(m_blendStateStack.top().get(), factors, 0xFFFFFFFF);
+    ApplyBlendState();
 }
 
 void RenderContext::PushRenderTarget(boost::intrusive_ptr<ID3D11RenderTargetView> rtv,
                                      boost::intrusive_ptr<ID3D11DepthStencilView> dsv)
 {
     assert(rtv);
-    ID3D11RenderTargetView* rtvs[] = 
-    {
-        rtv.get()
-    };
-    m_d3dContext->OMSetRenderTargets(1, rtvs, dsv.get());
     m_renderTargetStack.push(std::make_pair(rtv, dsv));
+    ApplyRenderTarget();
 }
 
 void RenderContext::PopRenderTarget()
 {
     assert(m_renderTargetStack.size() > 0);
     m_renderTargetStack.pop();
-    if (m_renderTargetStack.empty())
+    ApplyRenderTarget();
+}
+
+void RenderContext::PushViewport(D3D11_VIEWPORT vp)
+{
+    m_viewportStack.push(vp);
+    ApplyViewport();
+}
+
+void RenderContext::PopViewport()
+{
+    m_viewportStack.pop();
+    ApplyViewport();
+}
+
+void RenderContext::Apply()
+{
+    Invalidate();
+    ApplyRasterizerState();
+    ApplyDepthStencilState();
+    ApplyBlendState();
+    ApplyRenderTarget();
+    ApplyViewport();
+}
+
+void RenderContext::Invalidate()
+{
+    m_rasterizerState.valid = false;
+    m_depthStencilState.valid = false;
+    m_blendState.valid = false;
+    m_renderTarget.valid = false;
+    m_viewport.valid = false;
+    m_inputLayout.valid = false;
+    m_topology.valid = false;
+    for (size_t i = 0; i < VertexBufferSlots; ++i)
     {
-        ID3D11RenderTargetView* nullRtv = nullptr;
-        ID3D11DepthStencilView* nullDsv = nullptr;
-        m_d3dContext->OMSetRenderTargets(1, &nullRtv, nullDsv);
+        m_vertexBuffers[i].valid = false;
     }
-    else
+    m_indexBuffer.valid = false;
+    m_vertexShader.valid = false;
+    m_geometryShader.valid = false;
+    m_pixelShader.valid = false;
+    for (size_t stage = 0; stage < Stage_Count; ++stage)
     {
-        ID3D11RenderTargetView* rtvs[] =
+        for (size_t i = 0; i < ConstantBufferSlots; ++i)
         {
-            m_renderTargetStack.top().first.get()
-        };
-        m_d3dContext->OMSetRenderTargets(1, rtvs, m_renderTargetStack.top().second.get());
+            m_constantBuffers[stage][i].valid = false;
+        }
+        for (size_t i = 0; i < ShaderResourceSlots; ++i)
+        {
+            m_shaderResources[stage][i].valid = false;
+        }
+        for (size_t i = 0; i < SamplerSlots; ++i)
+        {
+            m_samplers[stage][i].valid = false;
+        }
     }
 }
 
-void RenderContext::PushViewport(D3D11_VIEWPORT vp)
+void RenderContext::SetInputLayout(ID3D11InputLayout* inputLayout,
+                                   D3D11_PRIMITIVE_TOPOLOGY topology)
 {
-    m_d3dContext->RSSetViewports(1, &vp);
-    m_viewportStack.push(vp);
+    if (Rebind(m_inputLayout, inputLayout))
+    {
+        m_d3dContext->IASetInputLayout(inputLayout);
+        m_callCounts.bindings++;
+    }
+    else
+    {
+        m_callCounts.elided++;
+    }
+    if (Rebind(m_topology, topology))
+    {
+        m_d3dContext->IASetPrimitiveTopology(topology);
+        m_callCounts.bindings++;
+    }
+    else
+    {
+        m_callCounts.elided++;
+    }
 }
 
-void RenderContext::PopViewport()
+void RenderContext::SetVertexBuffer(size_t slot, ID3D11Buffer* buffer, size_t stride, size_t offset)
 {
-    m_viewportStack.pop();
-    if (!m_viewportStack.empty())
+    assert(slot < VertexBufferSlots);
+    VertexBufferBinding binding = {buffer, stride, offset};
+    if (!Rebind(m_vertexBuffers[slot], binding))
     {
-        m_d3dContext->RSSetViewports(1, &m_viewportStack.top());
+        m_callCounts.elided++;
+        return;
     }
+    UINT strides[] = {stride},
+         offsets[] = {offset};
+    m_d3dContext->IASetVertexBuffers(slot, 1, &buffer, strides, offsets);
+    m_callCounts.bindings++;
 }
 
-void RenderContext::Apply()
+void RenderContext::SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format)
 {
-    m_d3dContext->RSSetState(m_rasterizerStateStack.top().get());
-    m_d3dContext->OMSetDepthStencilState(m_depthStencilStateStack.top().get(), 0);
-    float factors[] = {1.0f, 1.0f, 1.0f, 1.0f};
-    m_d3dContext->OMSetBlendState(m_blendStateStack.top().get(), factors, 0xFFFFFFFF);
-    if (m_renderTargetStack.empty())
+    if (!Rebind(m_indexBuffer, std::make_pair(buffer, format)))
+    {
+        m_callCounts.elided++;
+        return;
+    }
+    m_d3dContext->IASetIndexBuffer(buffer, format, 0);
+    m_callCounts.bindings++;
+}
+
+void RenderContext::SetShaders(ID3D11VertexShader* vertexShader,
+                               ID3D11GeometryShader* geometryShader,
+                               ID3D11PixelShader* pixelShader)
+{
+    if (Rebind(m_vertexShader, vertexShader))
+    {
+        m_d3dContext->VSSetShader(vertexShader, NULL, 0);
+        m_callCounts.bindings++;
+    }
+    else
+    {
+        m_callCounts.elided++;
+    }
+    if (Rebind(m_geometryShader, geometryShader))
     {
-        ID3D11RenderTargetView* nullRtv = nullptr;
-        ID3D11DepthStencilView* nullDsv = nullptr;
-        m_d3dContext->OMSetRenderTargets(1, &nullRtv, nullDsv);
+        m_d3dContext->GSSetShader(geometryShader, NULL, 0);
+        m_callCounts.bindings++;
     }
     else
     {
-        ID3D11RenderTargetView* rtvs[] =
+        m_callCounts.elided++;
+    }
+    if (Rebind(m_pixelShader, pixelShader))
+    {
+        m_d3dContext->PSSetShader(pixelShader, NULL, 0);
+        m_callCounts.bindings++;
+    }
+    else
+    {
+        m_callCounts.elided++;
+    }
+}
+
+void RenderContext::SetConstantBuffer(size_t slot, ID3D11Buffer* buffer)
+{
+    assert(slot < ConstantBufferSlots);
+    if (Rebind(m_constantBuffers[Stage_Vertex][slot], buffer))
+    {
+        m_d3dContext->VSSetConstantBuffers(slot, 1, &buffer);
+        m_callCounts.bindings++;
+    }
+    else
+    {
+        m_callCounts.elided++;
+    }
+    if (Rebind(m_constantBuffers[Stage_Pixel][slot], buffer))
+    {
+        m_d3dContext->PSSetConstantBuffers(slot, 1, &buffer);
+        m_callCounts.bindings++;
+    }
+    else
+    {
+        m_callCounts.elided++;
+    }
+}
+
+void RenderContext::SetShaderResources(size_t count, ID3D11ShaderResourceView* const* views)
+{
+    BindShaderResources(Stage_Pixel, count, views);
+}
+
+void RenderContext::SetVertexShaderResources(size_t count, ID3D11ShaderResourceView* const* views)
+{
+    BindShaderResources(Stage_Vertex, count, views);
+}
+
+void RenderContext::SetSampler(size_t slot, ID3D11SamplerState* sampler)
+{
+    BindSampler(Stage_Pixel, slot, sampler);
+}
+
+void RenderContext::SetVertexSampler(size_t slot, ID3D11SamplerState* sampler)
+{
+    BindSampler(Stage_Vertex, slot, sampler);
+}
+
+void* RenderContext::Map(ID3D11Buffer* buffer, D3D11_MAP mapType)
+{
+    D3D11_MAPPED_SUBRESOURCE map;
+    D3DCHECK(m_d3dContext->Map(buffer,                                      //  pResource
+                               0,                                           //  Subresource
+                               mapType,                                     //  MapType
+                               0,                                           //  MapFlags
+                               &map));                                      //  pMappedResource
+    m_callCounts.maps++;
+    return map.pData;
+}
+
+void RenderContext::Unmap(ID3D11Buffer* buffer)
+{
+    m_d3dContext->Unmap(buffer, 0);
+}
+
+void RenderContext::Draw(size_t vertexCount, size_t startVertex)
+{
+    m_d3dContext->Draw(vertexCount, startVertex);
+    m_callCounts.draws++;
+}
+
+void RenderContext::DrawIndexed(size_t indexCount, size_t startIndex, size_t baseVertex)
+{
+    m_d3dContext->DrawIndexed(indexCount, startIndex, baseVertex);
+    m_callCounts.draws++;
+}
+
+void RenderContext::DrawIndexedInstanced(size_t indexCount,
+                                         size_t instanceCount,
+                                         size_t startIndex,
+                                         size_t baseVertex,
+                                         size_t startInstance)
+{
+    m_d3dContext->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+    m_callCounts.draws++;
+}
+
+void RenderContext::EndFrame()
+{
+    m_frameCallCounts = m_callCounts;
+    m_totalCallCounts.draws += m_callCounts.draws;
+    m_totalCallCounts.maps += m_callCounts.maps;
+    m_totalCallCounts.bindings += m_callCounts.bindings;
+    m_totalCallCounts.states += m_callCounts.states;
+    m_totalCallCounts.elided += m_callCounts.elided;
+    m_callCounts = CallCounts();
+    m_frameCount++;
+}
+
+void RenderContext::ApplyRasterizerState()
+{
+    ID3D11RasterizerState* rs = m_rasterizerStateStack.top().get();
+    if (!Rebind(m_rasterizerState, rs))
+    {
+        m_callCounts.elided++;
+        return;
+    }
+    m_d3dContext->RSSetState(rs);
+    m_callCounts.states++;
+}
+
+void RenderContext::ApplyDepthStencilState()
+{
+    ID3D11DepthStencilState* ds = m_depthStencilStateStack.top().get();
+    if (!Rebind(m_depthStencilState, ds))
+    {
+        m_callCounts.elided++;
+        return;
+    }
+    m_d3dContext->OMSetDepthStencilState(ds, 0);
+    m_callCounts.states++;
+}
+
+void RenderContext::ApplyBlendState()
+{
+    ID3D11BlendState* bs = m_blendStateStack.top().get();
+    if (!Rebind(m_blendState, bs))
+    {
+        m_callCounts.elided++;
+        return;
+    }
+    float factors[] = {1.0f, 1.0f, 1.0f, 1.0f};
+    m_d3dContext->OMSetBlendState(bs, factors, 0xFFFFFFFF);
+    m_callCounts.states++;
+}
+
+void RenderContext::ApplyRenderTarget()
+{
+    ID3D11RenderTargetView* rtv = nullptr;
+    ID3D11DepthStencilView* dsv = nullptr;
+    if (!m_renderTargetStack.empty())
+    {
+        rtv = m_renderTargetStack.top().first.get();
+        dsv = m_renderTargetStack.top().second.get();
+    }
+    if (!Rebind(m_renderTarget, std::make_pair(rtv, dsv)))
+    {
+        m_callCounts.elided++;
+        return;
+    }
+    m_d3dContext->OMSetRenderTargets(1, &rtv, dsv);
+    m_callCounts.states++;
+
+    //  Direct3D unbinds any shader resource view of a resource bound for
+    //  output, so the shadowed views can no longer be trusted
+    for (size_t stage = 0; stage < Stage_Count; ++stage)
+    {
+        for (size_t i = 0; i < ShaderResourceSlots; ++i)
         {
-            m_renderTargetStack.top().first.get()
-        };
-        m_d3dContext->OMSetRenderTargets(1, rtvs, m_renderTargetStack.top().second.get());
+            m_shaderResources[stage][i].valid = false;
+        }
+    }
+}
+
+void RenderContext::ApplyViewport()
+{
+    if (m_viewportStack.empty())
+    {
+        return;
     }
-    if (!m_viewportStack.empty())
+    if (!Rebind(m_viewport, m_viewportStack.top()))
+    {
+        m_callCounts.elided++;
+        return;
+    }
+    m_d3dContext->RSSetViewports(1, &m_viewportStack.top());
+    m_callCounts.states++;
+}
+
+void RenderContext::BindShaderResources(Stage stage, size_t count, ID3D11ShaderResourceView* const* views)
+{
+    assert(count <= ShaderResourceSlots);
+
+    //  Views are issued as one call, which is skipped only if every slot
+    //  already matches
+    bool changed = false;
+    for (size_t i = 0; i < count; ++i)
+    {
+        changed |= Rebind(m_shaderResources[stage][i], views[i]);
+    }
+    if (!changed)
+    {
+        m_callCounts.elided++;
+        return;
+    }
+    if (stage == Stage_Vertex)
+    {
+        m_d3dContext->VSSetShaderResources(0, count, views);
+    }
+    else
+    {
+        m_d3dContext->PSSetShaderResources(0, count, views);
+    }
+    m_callCounts.bindings++;
+}
+
+void RenderContext::BindSampler(Stage stage, size_t slot, ID3D11SamplerState* sampler)
+{
+    assert(slot < SamplerSlots);
+    if (!Rebind(m_samplers[stage][slot], sampler))
+    {
+        m_callCounts.elided++;
+        return;
+    }
+    if (stage == Stage_Vertex)
+    {
+        m_d3dContext->VSSetSamplers(slot, 1, &sampler);
+    }
+    else
     {
-        m_d3dContext->RSSetViewports(1, &m_viewportStack.top());
+        m_d3dContext->PSSetSamplers(slot, 1, &sampler);
     }
+    m_callCounts.bindings++;
 }
@@ -12,9 +12,35 @@ class GraphicsDevice;
 //  Encapsulates a Direct3D rendering context, implementing push and pop
 //  behavior for setting rendering state.
 //
+//  Every call made through the context is counted, so that the cost of
+//  submitting a frame can be measured on any device, including the headless
+//  null driver.
+//
+//  The context also shadows the pipeline state it has bound, and skips any
+//  call which would bind what is already bound. The shadow holds plain
+//  pointers: an object can't be destroyed and its address reused while
+//  Direct3D still holds it bound, so a matching pointer always means the
+//  same object. Code which binds state directly on the Direct3D context must
+//  call Invalidate() (or Apply()) before using the context again.
+//
 class RenderContext : public boost::noncopyable
 {
 public:
+    //
+    //  Number of Direct3D calls made in a frame, by kind.
+    //
+    struct CallCounts
+    {
+        size_t draws;
+        size_t maps;
+        size_t bindings;
+        size_t states;
+        size_t elided;
+
+        CallCounts();
+        size_t GetTotal() const;
+    };
+
     //
     //  Constructor.
     //
@@ -41,9 +67,16 @@ public:
     //  Reapplies all of the objects at the top of the stack.
     //
     //  This lets RenderContext play nice with legacy code which isn't using it.
+    //  The shadowed state is invalidated first, so everything is rebound.
     //
     void Apply();
 
+    //
+    //  Forgets the shadowed state, so that the next call of each kind is
+    //  issued whatever it binds.
+    //
+    void Invalidate();
+
     //
     //  Pushes a rasterizer state and activates it.
     //
@@ -95,10 +128,160 @@ public:
     //
     void PopViewport();
 
+    //
+    //  Sets the input layout and primitive topology.
+    //
+    void SetInputLayout(ID3D11InputLayout* inputLayout,
+                        D3D11_PRIMITIVE_TOPOLOGY topology);
+
+    //
+    //  Sets a vertex buffer, optionally starting at an offset in bytes.
+    //
+    void SetVertexBuffer(size_t slot, ID3D11Buffer* buffer, size_t stride, size_t offset = 0);
+
+    //
+    //  Sets the index buffer.
+    //
+    void SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format);
+
+    //
+    //  Sets the vertex, geometry and pixel shaders.
+    //
+    void SetShaders(ID3D11VertexShader* vertexShader,
+                    ID3D11GeometryShader* geometryShader,
+                    ID3D11PixelShader* pixelShader);
+
+    //
+    //  Sets a constant buffer for both the vertex and pixel shaders.
+    //
+    void SetConstantBuffer(size_t slot, ID3D11Buffer* buffer);
+
+    //
+    //  Sets the pixel shader resources, starting at slot zero.
+    //
+    void SetShaderResources(size_t count, ID3D11ShaderResourceView* const* views);
+
+    //
+    //  Sets the vertex shader resources, starting at slot zero.
+    //
+    void SetVertexShaderResources(size_t count, ID3D11ShaderResourceView* const* views);
+
+    //
+    //  Sets a pixel shader sampler.
+    //
+    void SetSampler(size_t slot, ID3D11SamplerState* sampler);
+
+    //
+    //  Sets a vertex shader sampler.
+    //
+    void SetVertexSampler(size_t slot, ID3D11SamplerState* sampler);
+
+    //
+    //  Maps a dynamic buffer for writing.
+    //
+    //  Parameters:
+    //      [in] buffer
+    //          Buffer to map.
+    //      [in] mapType
+    //          Either D3D11_MAP_WRITE_DISCARD or D3D11_MAP_WRITE_NO_OVERWRITE.
+    //
+    void* Map(ID3D11Buffer* buffer, D3D11_MAP mapType);
+
+    //
+    //  Unmaps a buffer.
+    //
+    void Unmap(ID3D11Buffer* buffer);
+
+    //
+    //  Draws non-indexed geometry.
+    //
+    void Draw(size_t vertexCount, size_t startVertex);
+
+    //
+    //  Draws indexed geometry.
+    //
+    void DrawIndexed(size_t indexCount, size_t startIndex, size_t baseVertex);
+
+    //
+    //  Draws indexed, instanced geometry.
+    //
+    void DrawIndexedInstanced(size_t indexCount,
+                              size_t instanceCount,
+                              size_t startIndex,
+                              size_t baseVertex,
+                              size_t startInstance);
+
+    //
+    //  Ends the frame, publishing its call counts.
+    //
+    void EndFrame();
+
+    //
+    //  Returns the call counts of the last completed frame.
+    //
+    const CallCounts& GetFrameCallCounts() const;
+
 private:
+    //
+    //  A shadowed piece of pipeline state, which is unknown until bound.
+    //
+    template <typename T>
+    struct Binding
+    {
+        T value;
+        bool valid;
+
+        Binding();
+    };
+
+    //
+    //  A vertex buffer binding.
+    //
+    struct VertexBufferBinding
+    {
+        ID3D11Buffer* buffer;
+        size_t stride;
+        size_t offset;
+
+        bool operator==(const VertexBufferBinding& other) const;
+    };
+
+    //
+    //  Shader stages with shadowed resources.
+    //
+    enum Stage
+    {
+        Stage_Vertex,
+        Stage_Pixel,
+        Stage_Count
+    };
+
+    //
+    //  Binds the states at the top of the stacks, unless already bound.
+    //
+    void ApplyRasterizerState();
+    void ApplyDepthStencilState();
+    void ApplyBlendState();
+    void ApplyRenderTarget();
+    void ApplyViewport();
+
+    //
+    //  Binds shader resources to a stage.
+    //
+    void BindShaderResources(Stage stage, size_t count, ID3D11ShaderResourceView* const* views);
+
+    //
+    //  Binds a sampler to a stage.
+    //
+    void BindSampler(Stage stage, size_t slot, ID3D11SamplerState* sampler);
+
     //
     //  Properties.
     //
+    static const size_t VertexBufferSlots = 2;
+    static const size_t ConstantBufferSlots = 2;
+    static const size_t ShaderResourceSlots = 8;
+    static const size_t SamplerSlots = 2;
     GraphicsDevice& m_graphicsDevice;
     boost::intrusive_ptr<ID3D11DeviceContext> m_d3dContext;
     std::stack<boost::intrusive_ptr<ID3D11RasterizerState>> m_rasterizerStateStack;
@@ -107,12 +290,61 @@ private:
     std::stack<std::pair<boost::intrusive_ptr<ID3D11RenderTargetView>,
                          boost::intrusive_ptr<ID3D11DepthStencilView>>> m_renderTargetStack;
     std::stack<D3D11_VIEWPORT> m_viewportStack;
+    Binding<ID3D11RasterizerState*> m_rasterizerState;
+    Binding<ID3D11DepthStencilState*> m_depthStencilState;
+    Binding<ID3D11BlendState*> m_blendState;
+    Binding<std::pair<ID3D11RenderTargetView*, ID3D11DepthStencilView*>> m_renderTarget;
+    Binding<D3D11_VIEWPORT> m_viewport;
+    Binding<ID3D11InputLayout*> m_inputLayout;
+    Binding<D3D11_PRIMITIVE_TOPOLOGY> m_topology;
+    Binding<VertexBufferBinding> m_vertexBuffers[VertexBufferSlots];
+    Binding<std::pair<ID3D11Buffer*, DXGI_FORMAT>> m_indexBuffer;
+    Binding<ID3D11VertexShader*> m_vertexShader;
+    Binding<ID3D11GeometryShader*> m_geometryShader;
+    Binding<ID3D11PixelShader*> m_pixelShader;
+    Binding<ID3D11Buffer*> m_constantBuffers[Stage_Count][ConstantBufferSlots];
+    Binding<ID3D11ShaderResourceView*> m_shaderResources[Stage_Count][ShaderResourceSlots];
+    Binding<ID3D11SamplerState*> m_samplers[Stage_Count][SamplerSlots];
+    CallCounts m_callCounts;
+    CallCounts m_frameCallCounts;
+    CallCounts m_totalCallCounts;
+    size_t m_frameCount;
 };
 
+inline RenderContext::CallCounts::CallCounts()
+: draws(0),
+  maps(0),
+  bindings(0),
+  states(0),
+  elided(0)
+{
+}
+
+inline size_t RenderContext::CallCounts::GetTotal() const
+{
+    return draws + maps + bindings + states;
+}
+
+template <typename T>
+inline RenderContext::Binding<T>::Binding()
+: valid(false)
+{
+}
+
+inline bool RenderContext::VertexBufferBinding::operator==(const VertexBufferBinding& other) const
+{
+    return buffer == other.buffer && stride == other.stride && offset == other.offset;
+}
+
 inline ID3D11DeviceContext& RenderContext::GetD3DContext()
 {
     assert(m_d3dContext);
     return *m_d3dContext;
 }
 
+inline const RenderContext::CallCounts& RenderContext::GetFrameCallCounts() const
+{
+    return m_frameCallCounts;
+}
+
 #endif  //  __NYX_RENDERCONTEXT_H__
@@ -0,0 +1,165 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Prefix.h"
+#include "RenderQueue.h"
+
+//
+//  Layout of the sort keys. The distance keeps the top bits of the float,
+//  which leaves a relative precision of better than 0.01%, so the pass and
+//  distance take two radix passes. The radix sort is stable, so ops with
+//  equal distances stay in index order.
+//
+static const size_t DistanceBits = 22;
+static const size_t DistanceShift = 62 - DistanceBits;
+static const size_t RadixBits = 12;
+static const size_t RadixBuckets = 1 << RadixBits;
+
+//
+//  Number of element moves per op the coherent sort may make before giving up
+//  and radix sorting instead, and the number of sorts to wait after giving up
+//  before trying again.
+//
+static const size_t CoherentMoveBudget = 4;
+static const size_t CoherentRetryInterval = 16;
+
+RenderQueue::RenderQueue()
+: m_coherentSortCount(0),
+  m_radixSortCount(0),
+  m_coherentRetryCount(0)
+{
+}
+
+RenderQueue::~RenderQueue()
+{
+}
+
+void RenderQueue::Clear()
+{
+    m_keys.clear();
+}
+
+void RenderQueue::Add(Pass pass, float distance2)
+{
+    assert(m_keys.size() < MaxOps);
+    assert(distance2 >= 0);
+
+    //  The bits of a non-negative float sort in the same order as its value
+    uint32_t distanceBits;
+    memcpy(&distanceBits, &distance2, sizeof(distanceBits));
+    distanceBits >>= 31 - DistanceBits;
+    if (pass == Pass_Transparent)
+    {
+        distanceBits ^= (1 << DistanceBits) - 1;
+    }
+    m_keys.push_back((static_cast<uint64_t>(pass) << 62) |
+                     (static_cast<uint64_t>(distanceBits) << DistanceShift) |
+                     static_cast<uint64_t>(m_keys.size()));
+}
+
+void RenderQueue::Sort()
+{
+    if (m_coherentRetryCount)
+    {
+        --m_coherentRetryCount;
+        SortRadix();
+        ++m_radixSortCount;
+    }
+    else if (SortCoherent())
+    {
+        ++m_coherentSortCount;
+    }
+    else
+    {
+        m_coherentRetryCount = CoherentRetryInterval;
+        SortRadix();
+        ++m_radixSortCount;
+    }
+
+    m_lastOrder.resize(m_keys.size());
+    for (size_t i = 0; i < m_keys.size(); ++i)
+    {
+        m_lastOrder[i] = GetIndex(i);
+    }
+}
+
+bool RenderQueue::SortCoherent()
+{
+    //  Last frame's order only applies if the same ops were added, which is
+    //  assumed if there are as many of them.
+    size_t count = m_keys.size();
+    if (!count || (m_lastOrder.size() != count))
+    {
+        return false;
+    }
+
+    m_scratch.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        m_scratch[i] = m_keys[m_lastOrder[i]];
+    }
+
+    size_t moveCount = 0, maxMoveCount = count * CoherentMoveBudget;
+    for (size_t i = 1; i < count; ++i)
+    {
+        uint64_t key = m_scratch[i];
+        size_t j = i;
+        while (j > 0 && m_scratch[j - 1] > key)
+        {
+            m_scratch[j] = m_scratch[j - 1];
+            --j;
+        }
+        m_scratch[j] = key;
+
+        moveCount += i - j;
+        if (moveCount > maxMoveCount)
+        {
+            return false;
+        }
+    }
+
+    m_keys.swap(m_scratch);
+    return true;
+}
+
+void RenderQueue::SortRadix()
+{
+    size_t count = m_keys.size();
+    if (!count)
+    {
+        return;
+    }
+    m_scratch.resize(count);
+
+    uint32_t offsets[RadixBuckets];
+    for (size_t shift = DistanceShift; shift < 64; shift += RadixBits)
+    {
+        std::fill(offsets, offsets + RadixBuckets, 0);
+        for (size_t i = 0; i < count; ++i)
+        {
+            offsets[(m_keys[i] >> shift) & (RadixBuckets - 1)]++;
+        }
+
+        //  Skip digits which are the same for every key, such as the pass
+        //  when only one pass is queued.
+        if (offsets[(m_keys[0] >> shift) & (RadixBuckets - 1)] == count)
+        {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (size_t i = 0; i < RadixBuckets; ++i)
+        {
+            uint32_t bucketCount = offsets[i];
+            offsets[i] = offset;
+            offset += bucketCount;
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            m_scratch[offsets[(m_keys[i] >> shift) & (RadixBuckets - 1)]++] = m_keys[i];
+        }
+        m_keys.swap(m_scratch);
+    }
+}
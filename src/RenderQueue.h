@@ -0,0 +1,149 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef __NYX_RENDERQUEUE_H__
+#define __NYX_RENDERQUEUE_H__
+
+//
+//  Sorts render ops by pass and camera distance.
+//
+//  Each op is reduced to a 64-bit key: the pass in the top bits, then the
+//  squared distance, then the op's index in the low bits. Opaque ops sort
+//  front to back and transparent ops back to front, and ops with the same
+//  distance keep the order they were added in.
+//
+//  Keys are radix sorted. When the same number of ops is added as last frame,
+//  last frame's order is tried first and corrected with an insertion sort,
+//  which is much cheaper while the camera moves smoothly. If the order has
+//  changed too much, the attempt is abandoned and not repeated for a while.
+//
+class RenderQueue : public boost::noncopyable
+{
+public:
+    //
+    //  Passes, in draw order.
+    //
+    enum Pass
+    {
+        Pass_Opaque,
+        Pass_GapFiller,
+        Pass_Transparent,
+        Pass_Count
+    };
+
+    //
+    //  Maximum number of ops.
+    //
+    enum
+    {
+        MaxOps = 1 << 30
+    };
+
+    //
+    //  Constructor.
+    //
+    RenderQueue();
+
+    //
+    //  Destructor.
+    //
+    ~RenderQueue();
+
+    //
+    //  Removes all ops.
+    //
+    void Clear();
+
+    //
+    //  Adds an op. Ops are identified by the order they are added in,
+    //  starting from zero.
+    //
+    //  Parameters:
+    //      [in] pass
+    //          Pass the op is drawn in.
+    //      [in] distance2
+    //          Squared distance from the camera.
+    //
+    void Add(Pass pass, float distance2);
+
+    //
+    //  Sorts the ops.
+    //
+    void Sort();
+
+    //
+    //  Returns the number of ops.
+    //
+    size_t GetCount() const;
+
+    //
+    //  Returns the index of an op in sorted order.
+    //
+    uint32_t GetIndex(size_t i) const;
+
+    //
+    //  Returns the pass of an op in sorted order.
+    //
+    Pass GetPass(size_t i) const;
+
+    //
+    //  Returns the number of sorts which reused last frame's order.
+    //
+    size_t GetCoherentSortCount() const;
+
+    //
+    //  Returns the number of sorts which fell back to a radix sort.
+    //
+    size_t GetRadixSortCount() const;
+
+private:
+    //
+    //  Tries to sort the keys by reapplying last frame's order. Returns false
+    //  if the order has changed too much to be worth correcting.
+    //
+    bool SortCoherent();
+
+    //
+    //  Radix sorts the keys.
+    //
+    void SortRadix();
+
+    //
+    //  Properties.
+    //
+    std::vector<uint64_t> m_keys;
+    std::vector<uint64_t> m_scratch;
+    std::vector<uint32_t> m_lastOrder;
+    size_t m_coherentSortCount;
+    size_t m_radixSortCount;
+    size_t m_coherentRetryCount;
+};
+
+inline size_t RenderQueue::GetCount() const
+{
+    return m_keys.size();
+}
+
+inline uint32_t RenderQueue::GetIndex(size_t i) const
+{
+    return static_cast<uint32_t>(m_keys[i] & (MaxOps - 1));
+}
+
+inline RenderQueue::Pass RenderQueue::GetPass(size_t i) const
+{
+    return static_cast<Pass>(m_keys[i] >> 62);
+}
+
+inline size_t RenderQueue::GetCoherentSortCount() const
+{
+    return m_coherentSortCount;
+}
+
+inline size_t RenderQueue::GetRadixSortCount() const
+{
+    return m_radixSortCount;
+}
+
+#endif  // __NYX_RENDERQUEUE_H__
@@ -0,0 +1,104 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Prefix.h"
+#include "ResidencyManager.h"
+
+//
+//  Fractions of the budget at which loading stops and eviction starts, and
+//  down to which eviction frees memory.
+//
+static const double LowWatermarkRatio = 0.9;
+static const double EvictionTargetRatio = 0.8;
+
+ResidencyManager::ResidencyManager(size_t budget)
+: m_budget(budget),
+  m_frameIndex(0),
+  m_bytesUsed(0),
+  m_frameBytesUsed(0),
+  m_peakBytesUsed(0),
+  m_evictionCount(0),
+  m_evictedBytes(0),
+  m_evicting(false)
+{
+}
+
+ResidencyManager::~ResidencyManager()
+{
+    if (!m_frameIndex)
+    {
+        return;
+    }
+    char buf[512];
+    sprintf_s(buf, "Budget: %.02f MB\nPeak resident: %.02f MB\nMeshes evicted: %u\nEvicted: %.02f MB\n",
+                   static_cast<double>(m_budget) / (1024.0 * 1024.0),
+                   static_cast<double>(m_peakBytesUsed) / (1024.0 * 1024.0),
+                   static_cast<uint>(m_evictionCount),
+                   static_cast<double>(m_evictedBytes) / (1024.0 * 1024.0));
+    OutputDebugStringA("=================== RESIDENCY STATISTICS ===================\n");
+    OutputDebugStringA(buf);
+}
+
+void ResidencyManager::SetBudget(size_t budget)
+{
+    m_budget = budget;
+}
+
+void ResidencyManager::BeginFrame()
+{
+    if (m_frameIndex)
+    {
+        m_bytesUsed = m_frameBytesUsed;
+        m_peakBytesUsed = max(m_peakBytesUsed, m_bytesUsed);
+        if (m_bytesUsed > GetLowWatermark())
+        {
+            m_evicting = true;
+        }
+        else if (m_bytesUsed <= GetEvictionTarget())
+        {
+            m_evicting = false;
+        }
+    }
+    m_frameBytesUsed = 0;
+    ++m_frameIndex;
+}
+
+void ResidencyManager::RecordEviction(size_t bytes)
+{
+    ++m_evictionCount;
+    m_evictedBytes += bytes;
+    m_bytesUsed -= min(m_bytesUsed, bytes);
+    if (m_bytesUsed <= GetEvictionTarget())
+    {
+        m_evicting = false;
+    }
+}
+
+bool ResidencyManager::CanLoad() const
+{
+    return !m_evicting && m_bytesUsed < GetLowWatermark();
+}
+
+size_t ResidencyManager::GetExcessBytes() const
+{
+    //  Once started, eviction carries on below the low watermark, so that
+    //  the nodes it merges are not split again as soon as it stops
+    size_t target = GetEvictionTarget();
+    if (!m_evicting || m_bytesUsed <= target)
+    {
+        return 0;
+    }
+    return m_bytesUsed - target;
+}
+
+size_t ResidencyManager::GetLowWatermark() const
+{
+    return static_cast<size_t>(m_budget * LowWatermarkRatio);
+}
+
+size_t ResidencyManager::GetEvictionTarget() const
+{
+    return static_cast<size_t>(m_budget * EvictionTargetRatio);
+}
@@ -0,0 +1,158 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef __NYX_RESIDENCYMANAGER_H__
+#define __NYX_RESIDENCYMANAGER_H__
+
+//
+//  Keeps track of the memory used by resident meshes against a budget.
+//
+//  The owner tallies the size of every resident mesh each frame, and asks
+//  the manager whether more detail may be loaded and how much must be
+//  evicted. Loading stops at a low watermark below the budget. Past it,
+//  eviction starts and frees memory down to a lower target before loading
+//  resumes, so that usage never settles where nothing can be loaded and
+//  nothing is evicted either, and a scene near the watermark doesn't
+//  alternate between loading and evicting the same meshes every few frames.
+//
+class ResidencyManager : public boost::noncopyable
+{
+public:
+    //
+    //  Constructor.
+    //
+    //  Parameters:
+    //      [in] budget
+    //          Budget for resident meshes, in bytes.
+    //
+    explicit ResidencyManager(size_t budget);
+
+    //
+    //  Destructor.
+    //
+    ~ResidencyManager();
+
+    //
+    //  Sets the budget for resident meshes, in bytes.
+    //
+    void SetBudget(size_t budget);
+
+    //
+    //  Returns the budget for resident meshes, in bytes.
+    //
+    size_t GetBudget() const;
+
+    //
+    //  Starts a new frame, clearing the tally of resident memory.
+    //
+    void BeginFrame();
+
+    //
+    //  Adds a resident mesh to the current frame's tally.
+    //
+    void AddResident(size_t bytes);
+
+    //
+    //  Records that a mesh was evicted.
+    //
+    void RecordEviction(size_t bytes);
+
+    //
+    //  Returns the index of the current frame.
+    //
+    uint32_t GetFrameIndex() const;
+
+    //
+    //  Returns the memory used by resident meshes, in bytes.
+    //
+    size_t GetBytesUsed() const;
+
+    //
+    //  Returns the highest memory used by resident meshes in any frame.
+    //
+    size_t GetPeakBytesUsed() const;
+
+    //
+    //  Returns true if more meshes may be loaded.
+    //
+    bool CanLoad() const;
+
+    //
+    //  Returns the number of bytes which should be evicted to bring the
+    //  resident meshes down to the eviction target, or zero if no eviction
+    //  is under way.
+    //
+    size_t GetExcessBytes() const;
+
+    //
+    //  Returns the number of meshes evicted.
+    //
+    size_t GetEvictionCount() const;
+
+    //
+    //  Returns the total size of the meshes evicted, in bytes.
+    //
+    uint64_t GetEvictedBytes() const;
+
+private:
+    //
+    //  Returns the low watermark.
+    //
+    size_t GetLowWatermark() const;
+
+    //
+    //  Returns the level down to which eviction frees memory.
+    //
+    size_t GetEvictionTarget() const;
+
+    //
+    //  Properties.
+    //
+    size_t m_budget;
+    uint32_t m_frameIndex;
+    size_t m_bytesUsed;
+    size_t m_frameBytesUsed;
+    size_t m_peakBytesUsed;
+    size_t m_evictionCount;
+    uint64_t m_evictedBytes;
+    bool m_evicting;
+};
+
+inline size_t ResidencyManager::GetBudget() const
+{
+    return m_budget;
+}
+
+inline void ResidencyManager::AddResident(size_t bytes)
+{
+    m_frameBytesUsed += bytes;
+}
+
+inline uint32_t ResidencyManager::GetFrameIndex() const
+{
+    return m_frameIndex;
+}
+
+inline size_t ResidencyManager::GetBytesUsed() const
+{
+    return m_bytesUsed;
+}
+
+inline size_t ResidencyManager::GetPeakBytesUsed() const
+{
+    return m_peakBytesUsed;
+}
+
+inline size_t ResidencyManager::GetEvictionCount() const
+{
+    return m_evictionCount;
+}
+
+inline uint64_t ResidencyManager::GetEvictedBytes() const
+{
+    return m_evictedBytes;
+}
+
+#endif  // __NYX_RESIDENCYMANAGER_H__
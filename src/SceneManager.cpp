@@ -31,6 +31,10 @@ SceneManager::~SceneManager()
 void SceneManager::SetCamera(const Camera& camera)
 {
     m_camera = camera;
+
+    //  The voxel world is culled for the main and reflected views together
+    SceneConstants reflectionConstants = WaterManager::GetReflectionConstants(m_camera);
+    m_voxelManager->SetReflection(reflectionConstants.frustum, reflectionConstants.clipPlane);
     m_voxelManager->SetCamera(m_camera);
 }
 
@@ -39,6 +43,11 @@ void SceneManager::Update()
     m_voxelManager->Update();
 }
 
+void SceneManager::SetMetrics(MetricsRegistry& registry)
+{
+    m_voxelManager->SetMetrics(registry);
+}
+
 void SceneManager::Draw()
 {
     m_graphicsDevice.GetRenderContext().Apply();
@@ -53,7 +62,7 @@ void SceneManager::Draw()
     sceneConstants.cameraPos = m_camera.GetPosition();
     sceneConstants.clipPlane = float4(1.0f, 1.0f, 1.0f, FLT_MAX);   // clip nothing
     sceneConstants.frustum = m_camera.GetFrustum();
-    sceneConstants.lowDetail = false;
+    sceneConstants.view = SceneView_Main;
     m_graphicsDevice.Begin();
     DrawStage(m_graphicsDevice.GetRenderContext(), sceneConstants);
     m_graphicsDevice.End();
@@ -13,11 +13,21 @@
 //  Forward declarations.
 //
 class GraphicsDevice;
+class MetricsRegistry;
 class SkyRenderer;
 class RenderContext;
 class VoxelManager;
 class WaterManager;
 
+//
+//  Views from which the scene is drawn each frame.
+//
+enum SceneView
+{
+    SceneView_Main,
+    SceneView_Reflection
+};
+
 //
 //  Global rendering constants.
 //
@@ -29,7 +39,7 @@ public:
     Frustum frustum;
     float4 clipPlane;
     float3 cameraPos;
-    bool lowDetail;
+    SceneView view;
 };
 
 class SceneManager : public boost::noncopyable
@@ -64,6 +74,15 @@ public:
     //
     void Draw();
 
+    //
+    //  Publishes the state of the voxel world to a metrics registry.
+    //
+    //  Parameters:
+    //      [in] registry
+    //          Registry to publish to, which must outlive the scene.
+    //
+    void SetMetrics(MetricsRegistry& registry);
+
     //
     //  Draws the scene for an individual render stage.
     //
@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Prefix.h"
+#include "ScratchArena.h"
+
+ScratchArena::ScratchArena(size_t initialSize)
+: m_block(nullptr),
+  m_cursor(nullptr),
+  m_end(nullptr),
+  m_capacity(0),
+  m_bytesUsed(0),
+  m_peakBytesUsed(0),
+  m_heapAllocationCount(0),
+  m_resetCount(0)
+{
+    AddBlock(initialSize);
+}
+
+ScratchArena::~ScratchArena()
+{
+    FreeBlocks();
+}
+
+void* ScratchArena::Allocate(size_t size)
+{
+    size = (size + Alignment - 1) & ~(Alignment - 1);
+    if (static_cast<size_t>(m_end - m_cursor) < size)
+    {
+        //  Grow geometrically so that a chunk which overflows the arena by a
+        //  lot does not chain on many small blocks.
+        AddBlock(max(size, m_capacity));
+    }
+
+    void* ptr = m_cursor;
+    m_cursor += size;
+    m_bytesUsed += size;
+    m_peakBytesUsed = max(m_peakBytesUsed, m_bytesUsed);
+    return ptr;
+}
+
+void ScratchArena::Reset()
+{
+    //  If the last chunk needed more than one block then replace them with a
+    //  single block large enough for all of it.
+    if (m_block && m_block->next)
+    {
+        size_t capacity = m_capacity;
+        FreeBlocks();
+        AddBlock(capacity);
+    }
+    else if (m_block)
+    {
+        m_cursor = reinterpret_cast<uint8_t*>(m_block) + Alignment;
+    }
+    m_bytesUsed = 0;
+    m_resetCount++;
+}
+
+void ScratchArena::AddBlock(size_t size)
+{
+    //  The block header is padded to the alignment so that the first
+    //  allocation in the block is aligned.
+    static_assert(sizeof(Block) <= Alignment, "Block header must fit in the alignment padding");
+    uint8_t* ptr = static_cast<uint8_t*>(_aligned_malloc(size + Alignment, Alignment));
+    CHECK(SystemError, ptr);
+
+    Block* block = reinterpret_cast<Block*>(ptr);
+    block->next = m_block;
+    block->size = size;
+    m_block = block;
+    m_cursor = ptr + Alignment;
+    m_end = m_cursor + size;
+    m_capacity += size;
+    m_heapAllocationCount++;
+}
+
+void ScratchArena::FreeBlocks()
+{
+    while (m_block)
+    {
+        Block* next = m_block->next;
+        _aligned_free(m_block);
+        m_block = next;
+    }
+    m_cursor = nullptr;
+    m_end = nullptr;
+    m_capacity = 0;
+}
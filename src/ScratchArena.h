@@ -0,0 +1,158 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef __NYX_SCRATCHARENA_H__
+#define __NYX_SCRATCHARENA_H__
+
+//
+//  Bump allocator for per-chunk scratch memory.
+//
+//  Allocations are carved sequentially out of a block of memory and are never
+//  freed individually; Reset() releases everything at once. When a block runs
+//  out a larger one is chained on, and on the next Reset() the chain is
+//  replaced with a single block big enough for all of it, so once the arena
+//  has seen its largest chunk it stops touching the heap entirely.
+//
+//  Objects allocated from the arena are never destroyed, so only types with
+//  trivial destructors should be placed in it.
+//
+class ScratchArena : public boost::noncopyable
+{
+public:
+    //
+    //  Alignment of every allocation; enough for SSE loads and stores.
+    //
+    static const size_t Alignment = 16;
+
+    //
+    //  Constructor.
+    //
+    //  Parameters:
+    //      [in] initialSize
+    //          Size in bytes of the first block.
+    //
+    explicit ScratchArena(size_t initialSize);
+
+    //
+    //  Destructor.
+    //
+    ~ScratchArena();
+
+    //
+    //  Allocates uninitialized memory.
+    //
+    //  Parameters:
+    //      [in] size
+    //          Number of bytes to allocate.
+    //
+    void* Allocate(size_t size);
+
+    //
+    //  Allocates an uninitialized array.
+    //
+    //  Parameters:
+    //      [template] T
+    //          Element type.
+    //      [in] count
+    //          Number of elements to allocate.
+    //
+    template <typename T>
+    T* Allocate(size_t count);
+
+    //
+    //  Releases every allocation.
+    //
+    void Reset();
+
+    //
+    //  Returns the number of bytes currently allocated.
+    //
+    size_t GetBytesUsed() const;
+
+    //
+    //  Returns the highest number of bytes allocated between resets.
+    //
+    size_t GetPeakBytesUsed() const;
+
+    //
+    //  Returns the total size of the blocks owned by the arena.
+    //
+    size_t GetCapacity() const;
+
+    //
+    //  Returns the number of times the arena has allocated from the heap.
+    //
+    size_t GetHeapAllocationCount() const;
+
+    //
+    //  Returns the number of times the arena has been reset.
+    //
+    size_t GetResetCount() const;
+
+private:
+    //
+    //  Header at the start of each block.
+    //
+    struct Block
+    {
+        Block* next;
+        size_t size;
+    };
+
+    //
+    //  Allocates a block from the heap and makes it the current block.
+    //
+    void AddBlock(size_t size);
+
+    //
+    //  Releases every block.
+    //
+    void FreeBlocks();
+
+    //
+    //  Properties.
+    //
+    Block* m_block;
+    uint8_t* m_cursor;
+    uint8_t* m_end;
+    size_t m_capacity;
+    size_t m_bytesUsed;
+    size_t m_peakBytesUsed;
+    size_t m_heapAllocationCount;
+    size_t m_resetCount;
+};
+
+template <typename T>
+inline T* ScratchArena::Allocate(size_t count)
+{
+    return static_cast<T*>(Allocate(count * sizeof(T)));
+}
+
+inline size_t ScratchArena::GetBytesUsed() const
+{
+    return m_bytesUsed;
+}
+
+inline size_t ScratchArena::GetPeakBytesUsed() const
+{
+    return m_peakBytesUsed;
+}
+
+inline size_t ScratchArena::GetCapacity() const
+{
+    return m_capacity;
+}
+
+inline size_t ScratchArena::GetHeapAllocationCount() const
+{
+    return m_heapAllocationCount;
+}
+
+inline size_t ScratchArena::GetResetCount() const
+{
+    return m_resetCount;
+}
+
+#endif  // __NYX_SCRATCHARENA_H__
@@ -0,0 +1,207 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Prefix.h"
+#include "GraphicsDevice.h"
+#include "RenderContext.h"
+#include "UploadRing.h"
+
+//
+//  Upload totals over every frame, reported at exit.
+//
+static struct UploadStatistics
+{
+    uint64_t frameCount;
+    uint64_t uploadCount;
+    uint64_t bytesUploaded;
+    uint64_t paddingBytes;
+    uint64_t copyTicks;
+    size_t wrapCount;
+    size_t growCount;
+    size_t peakCapacity;
+    uint64_t peakBytesInFlight;
+    size_t peakFramesInFlight;
+
+    UploadStatistics()
+    : frameCount(0),
+      uploadCount(0),
+      bytesUploaded(0),
+      paddingBytes(0),
+      copyTicks(0),
+      wrapCount(0),
+      growCount(0),
+      peakCapacity(0),
+      peakBytesInFlight(0),
+      peakFramesInFlight(0)
+    {
+    }
+
+    ~UploadStatistics()
+    {
+        if (frameCount)
+        {
+            uint64_t frequency;
+            QueryPerformanceFrequency(reinterpret_cast<LARGE_INTEGER*>(&frequency));
+            double copySeconds = static_cast<double>(copyTicks) / frequency;
+            double megabytes = bytesUploaded / (1024.0 * 1024.0);
+
+            char buf[512];
+            OutputDebugStringA("========================= UPLOAD RING STATISTICS =========================\n");
+            sprintf_s(buf, "Frames: %llu\nUploads: %llu\t\t\t(%.01f per frame)\nUploaded: %.02f MB\t\t(%.01f KB per frame)\n",
+                      frameCount,
+                      uploadCount,
+                      static_cast<double>(uploadCount) / frameCount,
+                      megabytes,
+                      bytesUploaded / (1024.0 * frameCount));
+            OutputDebugStringA(buf);
+            sprintf_s(buf, "Map and copy throughput: %.01f MB/s\nAlignment and wrap padding: %.02f%%\n",
+                      copySeconds > 0 ? megabytes / copySeconds : 0.0,
+                      bytesUploaded ? 100.0 * paddingBytes / (bytesUploaded + paddingBytes) : 0.0);
+            OutputDebugStringA(buf);
+            sprintf_s(buf, "Wraps: %u\nGrows: %u\nPeak capacity: %.02f MB\nPeak in flight: %.02f MB over %u frames\n",
+                      wrapCount,
+                      growCount,
+                      peakCapacity / (1024.0 * 1024.0),
+                      peakBytesInFlight / (1024.0 * 1024.0),
+                      peakFramesInFlight);
+            OutputDebugStringA(buf);
+        }
+    }
+} s_uploadStatistics;
+
+UploadRing::UploadRing(GraphicsDevice& graphicsDevice, size_t capacity)
+: m_graphicsDevice(graphicsDevice),
+  m_capacity(0),
+  m_head(0),
+  m_bytesWritten(0),
+  m_bytesRetired(0)
+{
+    CreateBuffer(capacity);
+}
+
+UploadRing::~UploadRing()
+{
+}
+
+size_t UploadRing::Upload(RenderContext& renderContext,
+                          const void* data,
+                          size_t size,
+                          size_t alignment)
+{
+    assert(alignment && !(alignment & (alignment - 1)));
+    uint64_t t0;
+    QueryPerformanceCounter(reinterpret_cast<LARGE_INTEGER*>(&t0));
+
+    //  Append behind the last upload if there's room. Nothing the GPU may be
+    //  reading lies ahead of the head, since the ring was discarded when it
+    //  last wrapped.
+    D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+    size_t offset = (m_head + alignment - 1) & ~(alignment - 1);
+    if (offset + size > m_capacity)
+    {
+        //  Wrapping to the start throws away the rest of the buffer. If the
+        //  data in flight would then overlap the upload, the GPU is too far
+        //  behind for the ring's size, so grow it instead. The skipped tail is
+        //  that of the buffer being left, whichever happens.
+        RetireFences();
+        size_t skippedBytes = m_capacity - m_head;
+        uint64_t bytesInFlight = m_bytesWritten + skippedBytes - m_bytesRetired;
+        if ((bytesInFlight + size > m_capacity && m_capacity < MaxCapacity) || size > m_capacity)
+        {
+            size_t capacity = m_capacity * 2;
+            while (capacity < size)
+            {
+                capacity *= 2;
+            }
+            CreateBuffer(capacity);
+            s_uploadStatistics.growCount++;
+        }
+        else
+        {
+            s_uploadStatistics.wrapCount++;
+        }
+        m_bytesWritten += skippedBytes;
+        s_uploadStatistics.paddingBytes += skippedBytes;
+        m_head = 0;
+        offset = 0;
+        mapType = D3D11_MAP_WRITE_DISCARD;
+    }
+
+    uint8_t* dest = static_cast<uint8_t*>(renderContext.Map(m_buffer.get(), mapType));
+    memcpy(dest + offset, data, size);
+    renderContext.Unmap(m_buffer.get());
+
+    m_bytesWritten += offset + size - m_head;
+    s_uploadStatistics.paddingBytes += offset - m_head;
+    m_head = offset + size;
+
+    uint64_t t1;
+    QueryPerformanceCounter(reinterpret_cast<LARGE_INTEGER*>(&t1));
+    s_uploadStatistics.copyTicks += t1 - t0;
+    s_uploadStatistics.uploadCount++;
+    s_uploadStatistics.bytesUploaded += size;
+    return offset;
+}
+
+void UploadRing::EndFrame()
+{
+    Fence fence;
+    if (m_freeQueries.empty())
+    {
+        D3D11_QUERY_DESC queryDesc =
+        {
+            D3D11_QUERY_EVENT,                                              //  Query
+            0                                                               //  MiscFlags
+        };
+        D3DCHECK(m_graphicsDevice.GetD3DDevice().CreateQuery(
+                                            &queryDesc,
+                                            AttachPtr(fence.query)));
+    }
+    else
+    {
+        fence.query = m_freeQueries.back();
+        m_freeQueries.pop_back();
+    }
+    fence.bytesWritten = m_bytesWritten;
+    m_graphicsDevice.GetD3DContext().End(fence.query.get());
+    m_fences.push_back(fence);
+
+    RetireFences();
+    s_uploadStatistics.frameCount++;
+    s_uploadStatistics.peakFramesInFlight = max(s_uploadStatistics.peakFramesInFlight, m_fences.size());
+    s_uploadStatistics.peakBytesInFlight = max(s_uploadStatistics.peakBytesInFlight, m_bytesWritten - m_bytesRetired);
+}
+
+void UploadRing::CreateBuffer(size_t capacity)
+{
+    D3D11_BUFFER_DESC bufferDesc =
+    {
+        capacity,                                                           //  ByteWidth
+        D3D11_USAGE_DYNAMIC,                                                //  Usage
+        D3D11_BIND_VERTEX_BUFFER,                                           //  BindFlags
+        D3D11_CPU_ACCESS_WRITE,                                             //  CPUAccessFlags
+        0,                                                                  //  MiscFlags
+        0                                                                   //  StructureByteStride
+    };
+    D3DCHECK(m_graphicsDevice.GetD3DDevice().CreateBuffer(&bufferDesc,
+                                                          NULL,
+                                                          AttachPtr(m_buffer)));
+    m_capacity = capacity;
+    s_uploadStatistics.peakCapacity = max(s_uploadStatistics.peakCapacity, m_capacity);
+}
+
+void UploadRing::RetireFences()
+{
+    while (!m_fences.empty() &&
+           m_graphicsDevice.GetD3DContext().GetData(m_fences.front().query.get(),
+                                                    NULL,
+                                                    0,
+                                                    D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK)
+    {
+        m_bytesRetired = m_fences.front().bytesWritten;
+        m_freeQueries.push_back(m_fences.front().query);
+        m_fences.pop_front();
+    }
+}
@@ -0,0 +1,116 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef __NYX_UPLOADRING_H__
+#define __NYX_UPLOADRING_H__
+
+//
+//  Forward declarations.
+//
+class GraphicsDevice;
+class RenderContext;
+
+//
+//  Streams dynamic vertex data to the GPU through one persistent buffer.
+//
+//  Uploads are appended to the buffer with NO_OVERWRITE maps, which never
+//  wait on the GPU, and the buffer is only mapped with DISCARD when the
+//  writes wrap around to the start. An event query is issued at the end of
+//  each frame, so the ring knows how much of what it wrote the GPU may still
+//  be reading. If wrapping would overwrite data still in flight, the ring
+//  grows instead of making the driver rename the buffer behind its back.
+//
+class UploadRing : public boost::noncopyable
+{
+public:
+    //
+    //  Constructor.
+    //
+    //  Parameters:
+    //      [in] graphicsDevice
+    //          Parent GraphicsDevice instance.
+    //      [in] capacity
+    //          Initial size of the buffer, in bytes.
+    //
+    UploadRing(GraphicsDevice& graphicsDevice, size_t capacity);
+
+    //
+    //  Destructor.
+    //
+    ~UploadRing();
+
+    //
+    //  Copies data into the ring.
+    //
+    //  Parameters:
+    //      [in] renderContext
+    //          Render context.
+    //      [in] data
+    //          Data to copy.
+    //      [in] size
+    //          Size of the data, in bytes.
+    //      [in] alignment
+    //          Alignment of the data in the buffer, in bytes.
+    //
+    //  Returns:
+    //      The offset of the data in the buffer returned by GetBuffer(),
+    //      which is only valid until the next call to Upload().
+    //
+    size_t Upload(RenderContext& renderContext,
+                  const void* data,
+                  size_t size,
+                  size_t alignment);
+
+    //
+    //  Returns the buffer.
+    //
+    ID3D11Buffer* GetBuffer() const;
+
+    //
+    //  Ends the frame, issuing a fence behind its uploads and retiring the
+    //  fences of frames the GPU has finished.
+    //
+    void EndFrame();
+
+private:
+    //
+    //  Marks the end of a frame's uploads.
+    //
+    struct Fence
+    {
+        boost::intrusive_ptr<ID3D11Query> query;
+        uint64_t bytesWritten;
+    };
+
+    //
+    //  Creates the buffer.
+    //
+    void CreateBuffer(size_t capacity);
+
+    //
+    //  Retires the fences the GPU has passed.
+    //
+    void RetireFences();
+
+    //
+    //  Properties.
+    //
+    static const size_t MaxCapacity = 64 * 1024 * 1024;
+    GraphicsDevice& m_graphicsDevice;
+    boost::intrusive_ptr<ID3D11Buffer> m_buffer;
+    size_t m_capacity;
+    size_t m_head;
+    uint64_t m_bytesWritten;
+    uint64_t m_bytesRetired;
+    std::deque<Fence> m_fences;
+    std::vector<boost::intrusive_ptr<ID3D11Query>> m_freeQueries;
+};
+
+inline ID3D11Buffer* UploadRing::GetBuffer() const
+{
+    return m_buffer.get();
+}
+
+#endif  // __NYX_UPLOADRING_H__
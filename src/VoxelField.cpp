@@ -0,0 +1,616 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Prefix.h"
+#include "ScratchArena.h"
+#include "VoxelField.h"
+
+#include <intrin.h>
+
+//
+//  Counts the set bits in a 32-bit value.
+//
+static inline uint32_t PopCount(uint32_t v)
+{
+    v = v - ((v >> 1) & 0x55555555);
+    v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+    return (((v + (v >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+}
+
+//
+//  Totals over every field processed, reported at exit.
+//
+static struct BrickStatistics
+{
+    uint64_t cellCount;
+    uint64_t skippedCellCount;
+    size_t fieldCount;
+
+    BrickStatistics()
+    : cellCount(0),
+      skippedCellCount(0),
+      fieldCount(0)
+    {
+    }
+
+    ~BrickStatistics()
+    {
+        if (!fieldCount)
+        {
+            return;
+        }
+        char buf[512];
+        sprintf_s(buf, "Fields: %u\nCells: %llu\nCells skipped: %llu\t\t\t(%.02f%%)\n",
+                       static_cast<uint>(fieldCount),
+                       cellCount,
+                       skippedCellCount,
+                       (static_cast<double>(skippedCellCount) / static_cast<double>(cellCount)) * 100.0);
+        OutputDebugStringA("===================== BRICK STATISTICS =====================\n");
+        OutputDebugStringA(buf);
+    }
+} s_brickStatistics;
+
+template <size_t N>
+VoxelField<N>::VoxelField(ScratchArena& arena, float3 fieldSubSize, float3 fieldOffset)
+: m_texels(arena.Allocate<float>(N * N * N)),
+  m_scratchX(arena.Allocate<float>(N * N * CornerCount)),
+  m_scratchY(arena.Allocate<float>(N * CornerCount * CornerCount)),
+  m_corners(arena.Allocate<float>(CornerCount * CornerCount * CornerPitch)),
+  m_signMasks(arena.Allocate<uint32_t>(CornerCount * CornerCount * MaskWords)),
+  m_brickLevelCount(0),
+  m_candidateMasks(arena.Allocate<uint32_t>(BrickCount * BrickCount * CellWords)),
+  m_rowMasks(arena.Allocate<uint32_t>(N * N * CellWords)),
+  m_rowOffsets(arena.Allocate<uint32_t>((N * N) + 1)),
+  m_skippedCellCount(0)
+{
+    //  The row padding is never written by ResampleCorners, but is read when
+    //  the sign masks are built.
+    memset(m_corners, 0, CornerCount * CornerCount * CornerPitch * sizeof(float));
+
+    CalculateWeights(m_weights[0], fieldSubSize.x, fieldOffset.x);
+    CalculateWeights(m_weights[1], fieldSubSize.y, fieldOffset.y);
+    CalculateWeights(m_weights[2], fieldSubSize.z, fieldOffset.z);
+
+    //  The finest level of the pyramid has one brick per BrickSize^3 cells,
+    //  and each level above halves the brick count until a single brick
+    //  covers the whole field.
+    uint brickCount = BrickCount;
+    for (;;)
+    {
+        assert(m_brickLevelCount < MaxBrickLevels);
+        m_brickCounts[m_brickLevelCount] = brickCount;
+        m_bricks[m_brickLevelCount] = arena.Allocate<Brick>(brickCount * brickCount * brickCount);
+        m_brickLevelCount++;
+        if (brickCount == 1)
+        {
+            break;
+        }
+        brickCount = (brickCount + 1) / 2;
+    }
+}
+
+template <size_t N>
+VoxelField<N>::~VoxelField()
+{
+}
+
+template <size_t N>
+void VoxelField<N>::CalculateWeights(SampleWeight* weights,
+                                     float fieldSubSize,
+                                     float fieldOffset)
+{
+    //  Mirrors Density() in marching_cubes.h: corner c maps to the texture
+    //  coordinate ((c / (N - 1)) * subSize + offset) / N, which is then
+    //  linearly filtered with clamped addressing.
+    for (uint c = 0; c < CornerCount; ++c)
+    {
+        float t = (static_cast<float>(c) / static_cast<float>(N - 1)) * fieldSubSize +
+                  fieldOffset - 0.5f;
+        t = max(0.0f, t);
+        uint i = static_cast<uint>(t);
+
+        weights[c].i0 = min(i, static_cast<uint>(N - 1));
+        weights[c].i1 = min(i + 1, static_cast<uint>(N - 1));
+        weights[c].t = t - static_cast<float>(i);
+    }
+}
+
+template <size_t N>
+void VoxelField<N>::Load(const void* data, size_t rowPitch, size_t depthPitch)
+{
+    const uint8_t* src = static_cast<const uint8_t*>(data);
+    float* dst = m_texels;
+    for (uint z = 0; z < N; ++z)
+    {
+        for (uint y = 0; y < N; ++y)
+        {
+            memcpy(dst, src + (z * depthPitch) + (y * rowPitch), N * sizeof(float));
+            dst += N;
+        }
+    }
+
+    ResampleCorners();
+    BuildSignMasks();
+    BuildBricks();
+}
+
+template <size_t N>
+void VoxelField<N>::ResampleCorners()
+{
+    //  Trilinear filtering is separable, so filter along X, then Y, then Z.
+    const SampleWeight* wx = m_weights[0];
+    const SampleWeight* wy = m_weights[1];
+    const SampleWeight* wz = m_weights[2];
+
+    for (uint row = 0; row < N * N; ++row)
+    {
+        const float* src = &m_texels[row * N];
+        float* dst = &m_scratchX[row * CornerCount];
+        for (uint x = 0; x < CornerCount; ++x)
+        {
+            dst[x] = Lerp(src[wx[x].i0], src[wx[x].i1], wx[x].t);
+        }
+    }
+
+    for (uint z = 0; z < N; ++z)
+    {
+        for (uint y = 0; y < CornerCount; ++y)
+        {
+            const float* src0 = &m_scratchX[((z * N) + wy[y].i0) * CornerCount];
+            const float* src1 = &m_scratchX[((z * N) + wy[y].i1) * CornerCount];
+            float* dst = &m_scratchY[((z * CornerCount) + y) * CornerCount];
+            for (uint x = 0; x < CornerCount; ++x)
+            {
+                dst[x] = Lerp(src0[x], src1[x], wy[y].t);
+            }
+        }
+    }
+
+    for (uint z = 0; z < CornerCount; ++z)
+    {
+        for (uint y = 0; y < CornerCount; ++y)
+        {
+            const float* src0 = &m_scratchY[((wz[z].i0 * CornerCount) + y) * CornerCount];
+            const float* src1 = &m_scratchY[((wz[z].i1 * CornerCount) + y) * CornerCount];
+            float* dst = &m_corners[((z * CornerCount) + y) * CornerPitch];
+            for (uint x = 0; x < CornerCount; ++x)
+            {
+                dst[x] = Lerp(src0[x], src1[x], wz[z].t);
+            }
+        }
+    }
+}
+
+template <size_t N>
+void VoxelField<N>::BuildSignMasks()
+{
+    //  Compare four corners at a time against the isolevel and pack the
+    //  results into one bit per corner; bit n of a row is set when corner n
+    //  has a positive density.
+    const __m128 zero = _mm_setzero_ps();
+    for (uint row = 0; row < CornerCount * CornerCount; ++row)
+    {
+        const float* src = &m_corners[row * CornerPitch];
+        uint32_t* dst = &m_signMasks[row * MaskWords];
+        memset(dst, 0, MaskWords * sizeof(uint32_t));
+        for (uint x = 0; x < CornerPitch; x += 4)
+        {
+            uint32_t bits = static_cast<uint32_t>(_mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(src + x), zero)));
+            dst[x / 32] |= bits << (x % 32);
+        }
+    }
+}
+
+template <size_t N>
+void VoxelField<N>::BuildBricks()
+{
+    //
+    //  The finest level is built directly from the corners. A brick includes
+    //  the corners on its far faces, since they are shared with the cells in
+    //  the brick.
+    //
+    Brick* base = m_bricks[0];
+    for (uint bz = 0; bz < BrickCount; ++bz)
+    {
+        uint z0 = bz * BrickSize, z1 = min(z0 + BrickSize, static_cast<uint>(N));
+        for (uint by = 0; by < BrickCount; ++by)
+        {
+            uint y0 = by * BrickSize, y1 = min(y0 + BrickSize, static_cast<uint>(N));
+            for (uint bx = 0; bx < BrickCount; ++bx)
+            {
+                uint x0 = bx * BrickSize, x1 = min(x0 + BrickSize, static_cast<uint>(N));
+                float minDensity = std::numeric_limits<float>::infinity(),
+                      maxDensity = -std::numeric_limits<float>::infinity();
+                for (uint z = z0; z <= z1; ++z)
+                {
+                    for (uint y = y0; y <= y1; ++y)
+                    {
+                        const float* src = &m_corners[((z * CornerCount) + y) * CornerPitch];
+                        for (uint x = x0; x <= x1; ++x)
+                        {
+                            minDensity = min(minDensity, src[x]);
+                            maxDensity = max(maxDensity, src[x]);
+                        }
+                    }
+                }
+                Brick& brick = base[(((bz * BrickCount) + by) * BrickCount) + bx];
+                brick.minDensity = minDensity;
+                brick.maxDensity = maxDensity;
+            }
+        }
+    }
+
+    //
+    //  Each coarser level merges up to 2x2x2 bricks from the level below.
+    //
+    for (uint level = 1; level < m_brickLevelCount; ++level)
+    {
+        const Brick* src = m_bricks[level - 1];
+        Brick* dst = m_bricks[level];
+        const uint srcCount = m_brickCounts[level - 1];
+        const uint dstCount = m_brickCounts[level];
+        for (uint bz = 0; bz < dstCount; ++bz)
+        {
+            uint z1 = min((bz * 2) + 1, srcCount - 1);
+            for (uint by = 0; by < dstCount; ++by)
+            {
+                uint y1 = min((by * 2) + 1, srcCount - 1);
+                for (uint bx = 0; bx < dstCount; ++bx)
+                {
+                    uint x1 = min((bx * 2) + 1, srcCount - 1);
+                    float minDensity = std::numeric_limits<float>::infinity(),
+                          maxDensity = -std::numeric_limits<float>::infinity();
+                    for (uint z = bz * 2; z <= z1; ++z)
+                    {
+                        for (uint y = by * 2; y <= y1; ++y)
+                        {
+                            for (uint x = bx * 2; x <= x1; ++x)
+                            {
+                                const Brick& child = src[(((z * srcCount) + y) * srcCount) + x];
+                                minDensity = min(minDensity, child.minDensity);
+                                maxDensity = max(maxDensity, child.maxDensity);
+                            }
+                        }
+                    }
+                    Brick& brick = dst[(((bz * dstCount) + by) * dstCount) + bx];
+                    brick.minDensity = minDensity;
+                    brick.maxDensity = maxDensity;
+                }
+            }
+        }
+    }
+}
+
+template <size_t N>
+void VoxelField<N>::MarkCandidates(uint level, uint3 brick) const
+{
+    const uint brickCount = m_brickCounts[level];
+    const Brick& b = m_bricks[level][(((brick.z * brickCount) + brick.y) * brickCount) + brick.x];
+
+    //  A brick whose corners all have the same sign contains no active cells.
+    if (b.minDensity > 0.0f || b.maxDensity <= 0.0f)
+    {
+        uint size = BrickSize << level;
+        uint3 cellMin = brick * size;
+        uint3 cellMax(min(cellMin.x + size, static_cast<uint>(N)),
+                      min(cellMin.y + size, static_cast<uint>(N)),
+                      min(cellMin.z + size, static_cast<uint>(N)));
+        m_skippedCellCount += (cellMax.x - cellMin.x) *
+                              (cellMax.y - cellMin.y) *
+                              (cellMax.z - cellMin.z);
+        return;
+    }
+
+    if (level == 0)
+    {
+        //  BrickSize divides 32, so a brick never straddles two mask words.
+        const uint x = brick.x * BrickSize;
+        m_candidateMasks[(((brick.z * BrickCount) + brick.y) * CellWords) + (x / 32)] |=
+            ((1u << BrickSize) - 1) << (x % 32);
+        return;
+    }
+
+    const uint childCount = m_brickCounts[level - 1];
+    for (uint z = brick.z * 2; z < min((brick.z * 2) + 2, childCount); ++z)
+    {
+        for (uint y = brick.y * 2; y < min((brick.y * 2) + 2, childCount); ++y)
+        {
+            for (uint x = brick.x * 2; x < min((brick.x * 2) + 2, childCount); ++x)
+            {
+                MarkCandidates(level - 1, uint3(x, y, z));
+            }
+        }
+    }
+}
+
+template <size_t N>
+size_t VoxelField<N>::ListSolidBoxes(ScratchArena& arena, box3f*& boxes) const
+{
+    const Brick* base = m_bricks[0];
+    boxes = arena.Allocate<box3f>(BrickCount * BrickCount);
+    size_t boxCount = 0;
+
+    //  Index plus one of the box started at each column of the previous row,
+    //  so that identical strips in consecutive rows can be merged.
+    uint openBoxes[BrickCount] = {0};
+    for (uint bz = 0; bz < BrickCount; ++bz)
+    {
+        //
+        //  Find the longest run of solid bricks in each column.
+        //
+        uint runStart[BrickCount], runEnd[BrickCount];
+        for (uint bx = 0; bx < BrickCount; ++bx)
+        {
+            runStart[bx] = runEnd[bx] = 0;
+            uint start = 0;
+            for (uint by = 0; by < BrickCount; ++by)
+            {
+                const Brick& brick = base[(((bz * BrickCount) + by) * BrickCount) + bx];
+                if (brick.minDensity <= 0)
+                {
+                    start = by + 1;
+                }
+                else if (by + 1 - start > runEnd[bx] - runStart[bx])
+                {
+                    runStart[bx] = start;
+                    runEnd[bx] = by + 1;
+                }
+            }
+        }
+
+        //
+        //  Merge identical runs along x into strips, and strips into the
+        //  boxes of the previous row where they match.
+        //
+        uint rowBoxes[BrickCount] = {0};
+        for (uint bx = 0; bx < BrickCount; ++bx)
+        {
+            if (runStart[bx] == runEnd[bx])
+            {
+                continue;
+            }
+
+            uint x0 = bx;
+            while (bx + 1 < BrickCount && runStart[bx + 1] == runStart[x0] && runEnd[bx + 1] == runEnd[x0])
+            {
+                bx++;
+            }
+
+            float3 first(static_cast<float>(x0 * BrickSize),
+                         static_cast<float>(runStart[x0] * BrickSize),
+                         static_cast<float>(bz * BrickSize));
+            float3 second(static_cast<float>(min((bx + 1) * BrickSize, static_cast<uint>(N))),
+                          static_cast<float>(min(runEnd[x0] * BrickSize, static_cast<uint>(N))),
+                          static_cast<float>(min((bz + 1) * BrickSize, static_cast<uint>(N))));
+
+            uint open = openBoxes[x0];
+            if (open &&
+                boxes[open - 1].first.y == first.y &&
+                boxes[open - 1].second.x == second.x &&
+                boxes[open - 1].second.y == second.y)
+            {
+                boxes[open - 1].second.z = second.z;
+                rowBoxes[x0] = open;
+            }
+            else
+            {
+                boxes[boxCount++] = box3f(first, second);
+                rowBoxes[x0] = static_cast<uint>(boxCount);
+            }
+        }
+        memcpy(openBoxes, rowBoxes, sizeof(openBoxes));
+    }
+    return boxCount;
+}
+
+template <size_t N>
+float VoxelField<N>::GetResampleError(float band) const
+{
+    float maxError = 0.0f;
+    for (uint z = 0; z < CornerCount; ++z)
+    {
+        uint z0 = z & ~1u, z1 = z0 + (z & 1) * 2;
+        if (z1 >= CornerCount)
+        {
+            continue;
+        }
+        for (uint y = 0; y < CornerCount; ++y)
+        {
+            uint y0 = y & ~1u, y1 = y0 + (y & 1) * 2;
+            if (y1 >= CornerCount)
+            {
+                continue;
+            }
+            for (uint x = 0; x < CornerCount; ++x)
+            {
+                uint x0 = x & ~1u, x1 = x0 + (x & 1) * 2;
+                if (!((x | y | z) & 1) || x1 >= CornerCount)
+                {
+                    continue;
+                }
+
+                //  Averaging all eight combinations gives the trilinear
+                //  midpoint whichever of the coordinates are odd.
+                float coarse = (GetCornerDensity(x0, y0, z0) + GetCornerDensity(x1, y0, z0) +
+                                GetCornerDensity(x0, y1, z0) + GetCornerDensity(x1, y1, z0) +
+                                GetCornerDensity(x0, y0, z1) + GetCornerDensity(x1, y0, z1) +
+                                GetCornerDensity(x0, y1, z1) + GetCornerDensity(x1, y1, z1)) * 0.125f;
+                float fine = GetCornerDensity(x, y, z);
+                if (std::fabs(fine) <= band || std::fabs(coarse) <= band)
+                {
+                    maxError = max(maxError, std::fabs(fine - coarse));
+                }
+            }
+        }
+    }
+    return maxError;
+}
+
+template <size_t N>
+void VoxelField<N>::GetDensityRange(uint3 cellMin,
+                                    uint3 cellMax,
+                                    float& minDensity,
+                                    float& maxDensity) const
+{
+    assert(cellMin.x <= cellMax.x && cellMin.y <= cellMax.y && cellMin.z <= cellMax.z);
+    assert(cellMax.x < N && cellMax.y < N && cellMax.z < N);
+
+    //  Use the coarsest level whose bricks are no wider than the range. The
+    //  range is then narrower than two bricks, so even when it is unaligned
+    //  it touches at most three bricks along each axis, and at most 27 are
+    //  read.
+    uint3 extent = cellMax - cellMin + 1u;
+    uint span = max(extent.x, max(extent.y, extent.z));
+    uint level = 0;
+    while (level + 1 < m_brickLevelCount && (static_cast<uint>(BrickSize) << (level + 1)) <= span)
+    {
+        level++;
+    }
+
+    const Brick* bricks = m_bricks[level];
+    const uint brickCount = m_brickCounts[level];
+    uint3 brickMin = cellMin / (static_cast<uint>(BrickSize) << level);
+    uint3 brickMax = cellMax / (static_cast<uint>(BrickSize) << level);
+
+    minDensity = std::numeric_limits<float>::infinity();
+    maxDensity = -std::numeric_limits<float>::infinity();
+    for (uint z = brickMin.z; z <= brickMax.z; ++z)
+    {
+        for (uint y = brickMin.y; y <= brickMax.y; ++y)
+        {
+            for (uint x = brickMin.x; x <= brickMax.x; ++x)
+            {
+                const Brick& brick = bricks[(((z * brickCount) + y) * brickCount) + x];
+                minDensity = min(minDensity, brick.minDensity);
+                maxDensity = max(maxDensity, brick.maxDensity);
+            }
+        }
+    }
+}
+
+template <size_t N>
+size_t VoxelField<N>::ListCells(ScratchArena& arena, uint32_t*& cells) const
+{
+    const size_t SliceStride = CornerCount * MaskWords;
+    const uint32_t LastWordMask = (N % 32) ? ((1u << (N % 32)) - 1) : 0xFFFFFFFF;
+
+    //
+    //  Pass 0 - walk the brick pyramid from the top, skipping uniform bricks,
+    //  to find the cells which may be active. The result is a cell mask for
+    //  each row of the finest bricks.
+    //
+    memset(m_candidateMasks, 0, BrickCount * BrickCount * CellWords * sizeof(uint32_t));
+    m_skippedCellCount = 0;
+    MarkCandidates(m_brickLevelCount - 1, uint3(0, 0, 0));
+
+    s_brickStatistics.cellCount += N * N * N;
+    s_brickStatistics.skippedCellCount += m_skippedCellCount;
+    s_brickStatistics.fieldCount++;
+
+    //
+    //  Pass 1 - classify 32 cells at a time. The eight corners of the cells in
+    //  a row come from four corner rows, each contributing the corners at x
+    //  ("lo") and at x + 1 ("hi"). A cell is active unless all eight of its
+    //  corners have the same sign. The number of active cells in each row is
+    //  accumulated into an exclusive prefix sum giving each row's output offset.
+    //
+    uint32_t total = 0;
+    for (uint z = 0; z < N; ++z)
+    {
+        for (uint y = 0; y < N; ++y)
+        {
+            const size_t row = (z * N) + y;
+            const uint32_t* a = &m_signMasks[((z * CornerCount) + y) * MaskWords];
+            const uint32_t* e = a + MaskWords;
+            const uint32_t* d = a + SliceStride;
+            const uint32_t* h = d + MaskWords;
+            const uint32_t* candidates = &m_candidateMasks[(((z / BrickSize) * BrickCount) + (y / BrickSize)) * CellWords];
+
+            m_rowOffsets[row] = total;
+            for (uint w = 0; w < CellWords; ++w)
+            {
+                if (!candidates[w])
+                {
+                    m_rowMasks[(row * CellWords) + w] = 0;
+                    continue;
+                }
+
+                uint32_t aLo = a[w], aHi = (a[w] >> 1) | (a[w + 1] << 31),
+                         dLo = d[w], dHi = (d[w] >> 1) | (d[w + 1] << 31),
+                         eLo = e[w], eHi = (e[w] >> 1) | (e[w + 1] << 31),
+                         hLo = h[w], hHi = (h[w] >> 1) | (h[w + 1] << 31);
+                uint32_t any = aLo | aHi | dLo | dHi | eLo | eHi | hLo | hHi,
+                         all = aLo & aHi & dLo & dHi & eLo & eHi & hLo & hHi,
+                         active = any & ~all & candidates[w];
+                if (w == CellWords - 1)
+                {
+                    active &= LastWordMask;
+                }
+                m_rowMasks[(row * CellWords) + w] = active;
+                total += PopCount(active);
+            }
+        }
+    }
+    m_rowOffsets[N * N] = total;
+
+    //
+    //  Pass 2 - compact the active cells into the output, building the corner
+    //  mask in the order expected by list_vertices and gen_indices.
+    //
+    cells = arena.Allocate<uint32_t>(total);
+    for (uint z = 0; z < N; ++z)
+    {
+        for (uint y = 0; y < N; ++y)
+        {
+            const size_t row = (z * N) + y;
+            if (m_rowOffsets[row] == m_rowOffsets[row + 1])
+            {
+                continue;
+            }
+
+            const uint32_t* a = &m_signMasks[((z * CornerCount) + y) * MaskWords];
+            const uint32_t* e = a + MaskWords;
+            const uint32_t* d = a + SliceStride;
+            const uint32_t* h = d + MaskWords;
+            uint32_t* dst = &cells[m_rowOffsets[row]];
+            const uint32_t packedRow = (y << 16) | (z << 8);
+
+            for (uint w = 0; w < CellWords; ++w)
+            {
+                uint32_t active = m_rowMasks[(row * CellWords) + w];
+                uint32_t aLo = a[w], aHi = (a[w] >> 1) | (a[w + 1] << 31),
+                         dLo = d[w], dHi = (d[w] >> 1) | (d[w + 1] << 31),
+                         eLo = e[w], eHi = (e[w] >> 1) | (e[w + 1] << 31),
+                         hLo = h[w], hHi = (h[w] >> 1) | (h[w + 1] << 31);
+                while (active)
+                {
+                    unsigned long b;
+                    _BitScanForward(&b, active);
+                    active &= active - 1;
+
+                    uint32_t mask = ((aLo >> b) & 1) |
+                                    (((aHi >> b) & 1) << 1) |
+                                    (((dHi >> b) & 1) << 2) |
+                                    (((dLo >> b) & 1) << 3) |
+                                    (((eLo >> b) & 1) << 4) |
+                                    (((eHi >> b) & 1) << 5) |
+                                    (((hHi >> b) & 1) << 6) |
+                                    (((hLo >> b) & 1) << 7);
+                    uint32_t x = (w * 32) + b;
+                    *dst++ = (x << 24) | packedRow | mask;
+                }
+            }
+        }
+    }
+
+    return total;
+}
+
+//
+//  Explicit instantiations for the supported chunk sizes.
+//
+template class VoxelField<16>;
+template class VoxelField<32>;
+template class VoxelField<64>;
@@ -0,0 +1,260 @@
+///////////////////////////////////////////////////////////////////////////////
+//	Copyright (C) 2011 Robert Engeln (engeln@gmail.com) All rights reserved.
+//	See accompanying LICENSE file for full license information.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef __NYX_VOXELFIELD_H__
+#define __NYX_VOXELFIELD_H__
+
+//
+//  Forward declarations.
+//
+class ScratchArena;
+
+//
+//  CPU-side copy of a chunk's density field.
+//
+//  The field is read back from the gen_voxels render target and resampled to
+//  the corners of the marching cubes cells, exactly as the Density() function
+//  in marching_cubes.h does on the GPU, so that cells classified here agree
+//  with the later GPU passes.
+//
+//  All of the field's buffers are allocated from a ScratchArena; a field is
+//  built for one chunk and discarded when the arena is reset.
+//
+//  Parameters:
+//      [template] N
+//          Number of cells along each axis of the chunk. The density texture
+//          has the same dimensions. Instantiated for 16, 32 and 64.
+//
+template <size_t N>
+class VoxelField : public boost::noncopyable
+{
+    static_assert(N >= 4 && N <= 256, "N must be between 4 and 256");
+
+public:
+    //
+    //  Compile-time dimensions.
+    //
+    enum
+    {
+        //  Number of cells along each axis.
+        CellCount = N,
+
+        //  Number of cell corners along each axis.
+        CornerCount = N + 1,
+
+        //  Distance in floats between rows of corners. Rows are padded to a
+        //  multiple of four so they can be processed four at a time; the
+        //  padding is left at zero and never classified.
+        CornerPitch = (N + 4) & ~3,
+
+        //  Number of 32-bit words in a row of cell masks.
+        CellWords = (N + 31) / 32,
+
+        //  Number of 32-bit words in a row of corner sign masks. There is one
+        //  extra word so that the corners on the far side of the last cell in
+        //  a word can always be read from the next word.
+        MaskWords = ((CornerPitch + 31) / 32) + 1,
+
+        //  Number of cells along each axis of the finest bricks.
+        BrickSize = 4,
+
+        //  Number of finest bricks along each axis.
+        BrickCount = (N + BrickSize - 1) / BrickSize,
+
+        //  Upper bound on the number of levels in the brick pyramid.
+        MaxBrickLevels = 8
+    };
+
+    //
+    //  Constructor.
+    //
+    //  Parameters:
+    //      [in] arena
+    //          Arena to allocate the field's buffers from.
+    //      [in] fieldSubSize
+    //          Dimensions of the region of the density texture spanned by the cells.
+    //      [in] fieldOffset
+    //          Offset of that region within the density texture.
+    //
+    VoxelField(ScratchArena& arena, float3 fieldSubSize, float3 fieldOffset);
+
+    //
+    //  Destructor.
+    //
+    ~VoxelField();
+
+    //
+    //  Loads the density field from a mapped texture.
+    //
+    //  Parameters:
+    //      [in] data
+    //          Pointer to the first texel.
+    //      [in] rowPitch
+    //          Distance in bytes between rows.
+    //      [in] depthPitch
+    //          Distance in bytes between slices.
+    //
+    void Load(const void* data, size_t rowPitch, size_t depthPitch);
+
+    //
+    //  Lists the cells which intersect the isosurface.
+    //
+    //  Each cell is written as a packed marker in the format consumed by the
+    //  list_vertices and gen_indices passes:
+    //
+    //      x : 8, y : 8, z : 8, cornerMask : 8
+    //
+    //  Parameters:
+    //      [in] arena
+    //          Arena to allocate the cell list from.
+    //      [out] cells
+    //          Receives a pointer to the packed cell markers.
+    //
+    //  Returns the number of cells written.
+    //
+    size_t ListCells(ScratchArena& arena, uint32_t*& cells) const;
+
+    //
+    //  Lists boxes which lie entirely inside the isosurface, for use as
+    //  occluders.
+    //
+    //  The boxes are built from the finest bricks whose minimum density is
+    //  above zero: the longest solid run in each column of bricks, merged with
+    //  identical runs in neighbouring columns. They are given in corner
+    //  coordinates.
+    //
+    //  Parameters:
+    //      [in] arena
+    //          Arena to allocate the box list from.
+    //      [out] boxes
+    //          Receives a pointer to the boxes.
+    //
+    //  Returns the number of boxes written.
+    //
+    size_t ListSolidBoxes(ScratchArena& arena, box3f*& boxes) const;
+
+    //
+    //  Returns the largest change in density near the isosurface which would
+    //  result from sampling the field at half the resolution.
+    //
+    //  Each corner with an odd coordinate is compared against the trilinear
+    //  reconstruction from the even corners around it. Since density is close
+    //  to a distance in world units, this estimates how far the surface moves
+    //  between this level of detail and the next coarser one.
+    //
+    //  Parameters:
+    //      [in] band
+    //          Only corners with a density within this distance of zero, in
+    //          either field, are considered.
+    //
+    float GetResampleError(float band) const;
+
+    //
+    //  Returns the density at a cell corner.
+    //
+    float GetCornerDensity(uint x, uint y, uint z) const;
+
+    //
+    //  Returns conservative bounds on the density within a range of cells.
+    //
+    //  The bounds come from the min/max brick pyramid, so they may be wider
+    //  than the true range but never narrower. If the range has a minimum
+    //  above zero or a maximum at or below zero then it does not intersect
+    //  the isosurface.
+    //
+    //  Parameters:
+    //      [in] cellMin
+    //          First cell in the range.
+    //      [in] cellMax
+    //          Last cell in the range (inclusive).
+    //      [out] minDensity
+    //          Receives the lower bound on the density.
+    //      [out] maxDensity
+    //          Receives the upper bound on the density.
+    //
+    void GetDensityRange(uint3 cellMin,
+                         uint3 cellMax,
+                         float& minDensity,
+                         float& maxDensity) const;
+
+private:
+    //
+    //  Texel indices and blend factor for sampling along one axis.
+    //
+    struct SampleWeight
+    {
+        uint i0;
+        uint i1;
+        float t;
+    };
+
+    //
+    //  Density bounds of a brick of cells.
+    //
+    struct Brick
+    {
+        float minDensity;
+        float maxDensity;
+    };
+
+    //
+    //  Calculates the sample weights for one axis.
+    //
+    static void CalculateWeights(SampleWeight* weights,
+                                 float fieldSubSize,
+                                 float fieldOffset);
+
+    //
+    //  Resamples the density texels to the cell corners.
+    //
+    void ResampleCorners();
+
+    //
+    //  Builds the per-row sign bitmasks of the corner densities.
+    //
+    void BuildSignMasks();
+
+    //
+    //  Builds the min/max brick pyramid from the corner densities.
+    //
+    void BuildBricks();
+
+    //
+    //  Marks the cells of non-uniform bricks as candidates for ListCells.
+    //
+    //  Parameters:
+    //      [in] level
+    //          Pyramid level of the brick.
+    //      [in] brick
+    //          Position of the brick within its level.
+    //
+    void MarkCandidates(uint level, uint3 brick) const;
+
+    //
+    //  Properties.
+    //
+    SampleWeight m_weights[3][CornerCount];
+    float* m_texels;
+    float* m_scratchX;
+    float* m_scratchY;
+    float* m_corners;
+    uint32_t* m_signMasks;
+    uint m_brickLevelCount;
+    uint m_brickCounts[MaxBrickLevels];
+    Brick* m_bricks[MaxBrickLevels];
+    uint32_t* m_candidateMasks;
+    uint32_t* m_rowMasks;
+    uint32_t* m_rowOffsets;
+    mutable size_t m_skippedCellCount;
+};
+
+template <size_t N>
+inline float VoxelField<N>::GetCornerDensity(uint x, uint y, uint z) const
+{
+    assert(x < CornerCount && y < CornerCount && z < CornerCount);
+    return m_corners[(((z * CornerCount) + y) * CornerPitch) + x];
+}
+
+#endif  // __NYX_VOXELFIELD_H__
@@ -7,33 +7,209 @@
 #include "Camera.h"
 #include "GraphicsDevice.h"
 #include "LineRenderer.h"
+#include "MeshHeap.h"
+#include "Metrics.h"
+#include "NodeTimeline.h"
+#include "OcclusionCuller.h"
 #include "Profiler.h"
+#include "ResidencyManager.h"
 #include "SceneManager.h"
 #include "VoxelMesh.h"
 #include "VoxelManager.h"
 #include "VoxelProcessor.h"
 #include "VoxelRenderer.h"
 
+//
+//  Occlusion culling totals over every frame, reported at exit.
+//
+static struct OcclusionStatistics
+{
+    uint64_t occluderCount;
+    uint64_t testedCount;
+    uint64_t culledCount;
+    size_t frameCount;
+
+    OcclusionStatistics()
+    : occluderCount(0),
+      testedCount(0),
+      culledCount(0),
+      frameCount(0)
+    {
+    }
+
+    ~OcclusionStatistics()
+    {
+        if (!frameCount || !testedCount)
+        {
+            return;
+        }
+        char buf[512];
+        sprintf_s(buf, "Frames: %u\nOccluders per frame: %.01f\nNodes tested: %llu\nNodes culled: %llu\t\t\t(%.02f%%)\n",
+                       static_cast<uint>(frameCount),
+                       static_cast<double>(occluderCount) / static_cast<double>(frameCount),
+                       testedCount,
+                       culledCount,
+                       (static_cast<double>(culledCount) / static_cast<double>(testedCount)) * 100.0);
+        OutputDebugStringA("=================== OCCLUSION STATISTICS ===================\n");
+        OutputDebugStringA(buf);
+    }
+} s_occlusionStatistics;
+
+//
+//  Node scheduling totals over every frame, reported at exit.
+//
+static struct SchedulingStatistics
+{
+    size_t queuedCount;
+    size_t droppedCount;
+    size_t processedCount;
+    size_t sortCount;
+    size_t splitCount;
+    size_t prefetchCount;
+    size_t prefetchUsedCount;
+
+    SchedulingStatistics()
+    : queuedCount(0),
+      droppedCount(0),
+      processedCount(0),
+      sortCount(0),
+      splitCount(0),
+      prefetchCount(0),
+      prefetchUsedCount(0)
+    {
+    }
+
+    ~SchedulingStatistics()
+    {
+        if (!queuedCount)
+        {
+            return;
+        }
+        char buf[512];
+        sprintf_s(buf, "Nodes queued: %u\nDropped before processing: %u\t(%.02f%%)\nNodes processed: %u\nQueue sorts: %u\nNodes prefetched: %u\nPrefetched nodes used: %u\t(%.02f%% of splits)\n",
+                       static_cast<uint>(queuedCount),
+                       static_cast<uint>(droppedCount),
+                       (static_cast<double>(droppedCount) / static_cast<double>(queuedCount)) * 100.0,
+                       static_cast<uint>(processedCount),
+                       static_cast<uint>(sortCount),
+                       static_cast<uint>(prefetchCount),
+                       static_cast<uint>(prefetchUsedCount),
+                       splitCount ? (static_cast<double>(prefetchUsedCount) / static_cast<double>(splitCount)) * 100.0 : 0.0);
+        OutputDebugStringA("=================== SCHEDULING STATISTICS ==================\n");
+        OutputDebugStringA(buf);
+    }
+} s_schedulingStatistics;
+
+//
+//  Metrics published each frame. The totals mirror the statistics reported
+//  at exit.
+//
+struct VoxelManager::MetricSet
+{
+    Gauge* pendingNodes;
+    Gauge* inflightJobs;
+    std::array<Gauge*, MaxTreeDepth> residentNodes;
+    std::array<Gauge*, MeshHeap::Pool_Count> heapBytes;
+    std::array<Gauge*, MeshHeap::Pool_Count> heapCapacity;
+    Gauge* residentBytes;
+    Gauge* budgetBytes;
+    Counter* evictions;
+    Counter* evictedBytes;
+    Counter* queuedNodes;
+    Counter* droppedNodes;
+    Counter* processedNodes;
+    Counter* splits;
+    Counter* prefetchedNodes;
+    Counter* prefetchHits;
+    Gauge* prefetchHitRatio;
+    NodeTimeline::Histograms nodeLatencies;
+};
+
+//
+//  Distances at which a split node is unsplit and fades out, relative to the
+//  distance at which it is split.
+//
+static const float UnsplitDistanceRatio = 3.25f / 3.0f;
+static const float FadeOutStartDistanceRatio = 2.9f / 3.0f;
+static const float FadeOutEndDistanceRatio = 2.8f / 3.0f;
+
+//
+//  Upper bound on a node's geometric error, in cells. A few very rough nodes
+//  would otherwise be split out to the edge of the visual radius.
+//
+static const float MaxGeometricErrorCells = 2.0f;
+
+//
+//  Geometric error, projected to the screen in pixels, beyond which a node is
+//  split. Larger values trade quality for fewer nodes.
+//
+static const float PixelError = 8.0f;
+
+//
+//  Camera movement, as a fraction of the finest node size, and rotation, as
+//  the cosine of the angle turned, after which queued nodes are sorted again.
+//
+static const float ResortDistanceRatio = 0.25f;
+static const float ResortAngleCosine = 0.97f;
+
+//
+//  Default prediction horizon for prefetching, in seconds, and the weight
+//  given to each new velocity sample.
+//
+static const float DefaultPrefetchHorizon = 1.0f;
+static const float VelocitySmoothing = 0.25f;
+
+//
+//  Distance the camera may move between two calls to SetCamera, as a fraction
+//  of the root node size, beyond which it is taken to have teleported.
+//
+static const float TeleportDistanceRatio = 0.25f;
+
+//
+//  Default budget for resident meshes, in bytes.
+//
+static const size_t DefaultMeshBudget = 256 * 1024 * 1024;
+
+//
+//  Returns true if any part of a box lies in front of a plane.
+//
+static bool IsInFrontOfPlane(const box3f& box, const float4& plane)
+{
+    float3 pv(plane.x >= 0 ? box.second.x : box.first.x,
+              plane.y >= 0 ? box.second.y : box.first.y,
+              plane.z >= 0 ? box.second.z : box.first.z);
+    return (plane.x * pv.x) + (plane.y * pv.y) + (plane.z * pv.z) + plane.w > 0.0f;
+}
+
 VoxelManager::VoxelManager(GraphicsDevice& graphicsDevice,
                            size_t treeDepth,
                            float3 nodeDimensions,
                            float radius)
 : m_graphicsDevice(graphicsDevice),
   m_treeDepth(treeDepth),
-  m_radius(radius)
+  m_radius(radius),
+  m_lodScale(0.0f),
+  m_prefetchHorizon(DefaultPrefetchHorizon),
+  m_cameraVelocity(0.0f, 0.0f, 0.0f),
+  m_lastCameraPosition(0.0f, 0.0f, 0.0f),
+  m_predictedPosition(0.0f, 0.0f, 0.0f),
+  m_lastCameraTime(0),
+  m_hasReflection(false)
 {
     assert(m_treeDepth <= MaxTreeDepth);
 
     m_oldCamera.SetPosition(float3::Replicate(FLT_MAX));
+    m_sortPosition = float3::Replicate(FLT_MAX);
+    m_sortForward = float3(0.0f, 0.0f, 0.0f);
 
+    m_meshHeap.reset(new MeshHeap(m_graphicsDevice, sizeof(VoxelMesh::Vertex)));
     m_voxelRenderer.reset(new VoxelRenderer(m_graphicsDevice));
+    m_lowDetailRenderer.reset(new VoxelRenderer(m_graphicsDevice));
     m_lineRenderer.reset(new LineRenderer(m_graphicsDevice));
+    m_occlusionCuller.reset(new OcclusionCuller());
+    m_residencyManager.reset(new ResidencyManager(DefaultMeshBudget));
 
     std::fill(m_nodeDimensions.begin(), m_nodeDimensions.end(), float3::Replicate(-1.0f));
-    std::fill(m_splitDistances.begin(), m_splitDistances.end(), -1.0f);
-    std::fill(m_unsplitDistances.begin(), m_unsplitDistances.end(), -1.0f);
-    std::fill(m_fadeOutStartDistances.begin(), m_fadeOutStartDistances.end(), -1.0f);
-    std::fill(m_fadeOutEndDistances.begin(), m_fadeOutEndDistances.end(), -1.0f);
 
     m_nodeDimensions[0] = nodeDimensions;
     for (size_t i = 1; i < m_treeDepth; ++i)
@@ -44,15 +220,9 @@ VoxelManager::VoxelManager(GraphicsDevice& graphicsDevice,
     }
 
 
-    for (size_t i = 0; i < m_treeDepth; ++i)
-    {
-        //  Split and fade distances are factors of the node size
-        //  Just use the x dimension.
-        m_splitDistances[i] = m_nodeDimensions[i].x * 3.0f;
-        m_unsplitDistances[i] = m_nodeDimensions[i].x * 3.25f;
-        m_fadeOutStartDistances[i] = m_nodeDimensions[i].x * 2.9f;
-        m_fadeOutEndDistances[i] = m_nodeDimensions[i].x * 2.8f;
-    }
+    //  The geometric error is measured in the cells the voxel processor
+    //  meshes each node with
+    m_cellsPerNode = VoxelProcessor::GetMeshCellCount();
 
     m_mustSortNodes = false;
     for (size_t i = 0; i < 4; i++)
@@ -63,6 +233,21 @@ VoxelManager::VoxelManager(GraphicsDevice& graphicsDevice,
 
 VoxelManager::~VoxelManager()
 {
+    //  The registry holding the latency histograms may already be gone, so
+    //  the nodes destroyed here must not record into them
+    if (m_metrics)
+    {
+        NodeTimeline::Histograms& latencies = m_metrics->nodeLatencies;
+        latencies.events.fill(nullptr);
+        latencies.visible.clear();
+        latencies.abandoned.clear();
+    }
+    m_visibleNodes.clear();
+    m_reflectedNodes.clear();
+    m_occluderNodes.clear();
+    m_evictionCandidates.clear();
+    m_pendingNodes.clear();
+    m_nodeMap.clear();
 }
 
 void VoxelManager::SetCamera(const Camera& camera)
@@ -70,6 +255,8 @@ void VoxelManager::SetCamera(const Camera& camera)
     static Profiler profiler("VoxelManager::SetCamera()");
     profiler.Begin();
 
+    UpdateCameraVelocity(camera);
+
     //  If the camera's position has not changed significantly since the last
     //  call to SetCamera, don't bother searching for new nodes to add. (Still
     //  run update on all existing nodes.)
@@ -117,38 +304,222 @@ void VoxelManager::SetCamera(const Camera& camera)
         }
     }
 
+    //  Projected size of one world unit at unit distance, in pixels of the
+    //  render target
+    float viewportHeight = static_cast<float>(m_graphicsDevice.GetHeight());
+    m_lodScale = (viewportHeight * 0.5f) * camera.GetProjectionMatrix()[1][1];
+
+    //  Evict before walking the tree, so that the visible node list never
+    //  refers to evicted nodes. The meshes are tallied again during the walk.
+    m_residencyManager->BeginFrame();
+    EvictMeshes();
+    UpdateLodLevels(camera.GetPosition());
+
+    //  Walk the tree once, updating each node and building the list of
+    //  visible nodes to draw. Root nodes which have moved out of range are
+    //  removed before their subtrees are visited. The reflection only draws
+    //  root nodes, so it is culled as the roots are visited rather than
+    //  walking the tree again when it is drawn.
+    m_visibleNodes.clear();
+    m_reflectedNodes.clear();
+    float3 cpos = camera.GetPosition();
     for (auto i = m_nodeMap.begin(); i != m_nodeMap.end();)
     {
         auto j = i++;
-        UpdateNode(*j->second, camera);
-        if (j->second->distance > (m_radius * 1.25f))
+        Node& root = *j->second;
+        float3 center = root.position + (root.size * 0.5f);
+        float dx = cpos.x - center.x, dz = cpos.z - center.z;
+        if (sqrt((dx * dx) + (dz * dz)) > (m_radius * 1.25f))
         {
             m_nodeMap.erase(j);
+            continue;
         }
+        box3f boundingBox(root.position, root.position + root.size);
+        uint32_t planeMask = Frustum::AllPlanes;
+        bool visible = camera.GetFrustum().Classify(boundingBox,
+                                                    planeMask,
+                                                    root.lastFailedPlane) != FrustumTest_Outside;
+        UpdateNode(root, camera, visible, planeMask, true);
+
+        if (m_hasReflection &&
+            root.geometry->IsReady() &&
+            IsInFrontOfPlane(boundingBox, m_reflectionClipPlane) &&
+            m_reflectionFrustum.Intersects(boundingBox))
+        {
+            m_reflectedNodes.push_back(&root);
+        }
+    }
+    CullOccludedNodes(camera);
+
+    //  Queued nodes are prioritized by visibility and distance, both of which
+    //  change as the camera moves.
+    if (!m_pendingNodes.empty())
+    {
+        float3 offset = camera.GetPosition() - m_sortPosition;
+        float resortDistance = m_nodeDimensions[m_treeDepth - 1].x * ResortDistanceRatio;
+        if (Dot(offset, offset) > (resortDistance * resortDistance) ||
+            Dot(camera.GetForwardVector(), m_sortForward) < ResortAngleCosine)
+        {
+            m_mustSortNodes = true;
+        }
+    }
+    if (m_mustSortNodes)
+    {
+        m_sortPosition = camera.GetPosition();
+        m_sortForward = camera.GetForwardVector();
+    }
+
+    uint32_t frameIndex = m_residencyManager->GetFrameIndex();
+    for (size_t i = 0; i < m_visibleNodes.size(); ++i)
+    {
+        m_visibleNodes[i].node->lastVisibleFrame = frameIndex;
     }
 
     profiler.End();
 }
 
+void VoxelManager::SetReflection(const Frustum& frustum, const float4& clipPlane)
+{
+    m_reflectionFrustum = frustum;
+    m_reflectionClipPlane = clipPlane;
+    m_hasReflection = true;
+}
+
 void VoxelManager::Update()
 {
     static Profiler profiler("VoxelManager::Update()");
     profiler.Begin();
     ProcessNodes();
+    m_meshHeap->Compact();
+    if (m_metrics)
+    {
+        UpdateMetrics();
+    }
     profiler.End();
 }
 
+void VoxelManager::SetPrefetchHorizon(float seconds)
+{
+    assert(seconds >= 0);
+    m_prefetchHorizon = seconds;
+}
+
+void VoxelManager::SetMeshBudget(size_t bytes)
+{
+    m_residencyManager->SetBudget(bytes);
+}
+
+void VoxelManager::SetMetrics(MetricsRegistry& registry)
+{
+    static const char* poolLabels[MeshHeap::Pool_Count] = {"pool=\"vertex\"", "pool=\"index\""};
+
+    //  Node timelines keep a pointer to the latency histograms
+    assert(!m_metrics);
+    m_metrics.reset(new MetricSet());
+    MetricSet& metrics = *m_metrics;
+    metrics.pendingNodes = &registry.GetGauge("nyx_pending_nodes", "Nodes queued for processing.");
+    metrics.inflightJobs = &registry.GetGauge("nyx_inflight_jobs", "Voxel processors busy with a node.");
+    for (size_t i = 0; i < MaxTreeDepth; ++i)
+    {
+        char labels[32];
+        sprintf_s(labels, "depth=\"%u\"", static_cast<uint>(i));
+        metrics.residentNodes[i] = &registry.GetGauge("nyx_resident_nodes", "Nodes in the tree whose mesh is ready, by depth.", labels);
+    }
+    for (size_t i = 0; i < MeshHeap::Pool_Count; ++i)
+    {
+        metrics.heapBytes[i] = &registry.GetGauge("nyx_mesh_heap_bytes", "Bytes allocated from the mesh heap, by pool.", poolLabels[i]);
+        metrics.heapCapacity[i] = &registry.GetGauge("nyx_mesh_heap_capacity_bytes", "Bytes reserved by the mesh heap, by pool.", poolLabels[i]);
+    }
+    metrics.residentBytes = &registry.GetGauge("nyx_resident_mesh_bytes", "Bytes used by resident meshes.");
+    metrics.budgetBytes = &registry.GetGauge("nyx_mesh_budget_bytes", "Budget for resident meshes.");
+    metrics.evictions = &registry.GetCounter("nyx_mesh_evictions_total", "Meshes evicted to stay within the budget.");
+    metrics.evictedBytes = &registry.GetCounter("nyx_mesh_evicted_bytes_total", "Bytes freed by evicting meshes.");
+    metrics.queuedNodes = &registry.GetCounter("nyx_nodes_queued_total", "Nodes queued for processing.");
+    metrics.droppedNodes = &registry.GetCounter("nyx_nodes_dropped_total", "Queued nodes dropped before they were processed.");
+    metrics.processedNodes = &registry.GetCounter("nyx_nodes_processed_total", "Nodes handed to a voxel processor.");
+    metrics.splits = &registry.GetCounter("nyx_node_splits_total", "Nodes split into children.");
+    metrics.prefetchedNodes = &registry.GetCounter("nyx_prefetched_nodes_total", "Nodes whose children were generated speculatively.");
+    metrics.prefetchHits = &registry.GetCounter("nyx_prefetch_hits_total", "Splits which found their children prefetched.");
+    metrics.prefetchHitRatio = &registry.GetGauge("nyx_prefetch_hit_ratio", "Fraction of splits which found their children prefetched.");
+
+    //  Nodes record their own latencies as they reach each event, so only
+    //  nodes created from here on are traced
+    NodeTimeline::Histograms& latencies = metrics.nodeLatencies;
+    latencies.events[NodeTimeline::Event_Created] = nullptr;
+    for (size_t i = NodeTimeline::Event_Created + 1; i < NodeTimeline::Event_Count; ++i)
+    {
+        char labels[32];
+        sprintf_s(labels, "event=\"%s\"", NodeTimeline::GetEventName(static_cast<NodeTimeline::Event>(i)));
+        latencies.events[i] = &registry.GetHistogram("nyx_node_event_microseconds", "Time for a node to reach each event from the one before it.", labels);
+    }
+    latencies.visible.resize(MaxTreeDepth);
+    latencies.abandoned.resize(MaxTreeDepth);
+    for (size_t i = 0; i < MaxTreeDepth; ++i)
+    {
+        char labels[32];
+        sprintf_s(labels, "depth=\"%u\"", static_cast<uint>(i));
+        latencies.visible[i] = &registry.GetHistogram("nyx_node_visible_microseconds", "Time from a node's creation to its first draw, by depth.", labels);
+        latencies.abandoned[i] = &registry.GetHistogram("nyx_node_abandoned_microseconds", "Lifetime of nodes destroyed before they were drawn, by depth.", labels);
+    }
+}
+
+const ResidencyManager& VoxelManager::GetResidencyManager() const
+{
+    return *m_residencyManager;
+}
+
+const MeshHeap& VoxelManager::GetMeshHeap() const
+{
+    return *m_meshHeap;
+}
+
 void VoxelManager::Draw(RenderContext& renderContext,
                         const SceneConstants& sceneConstants)
 {
     static Profiler profiler("VoxelManager::Draw()");
     profiler.Begin();
-    for (auto i = m_nodeMap.begin(); i != m_nodeMap.end(); i++)
+    if (sceneConstants.view == SceneView_Reflection)
     {
-        CalculateNodeVisibility(*i->second, sceneConstants.frustum);
-        DrawNode(*i->second, !sceneConstants.lowDetail);
+        //  The reflection draws the root nodes culled for it by SetCamera().
+        //  It has its own renderer so that each pass's render queue can
+        //  reuse its own order from the previous frame.
+        for (size_t i = 0; i < m_reflectedNodes.size(); ++i)
+        {
+            const Node& node = *m_reflectedNodes[i];
+            m_lowDetailRenderer->Draw(*node.geometry,
+                                      node.position);
+        }
+        m_lowDetailRenderer->Flush(renderContext, sceneConstants);
+    }
+    else
+    {
+        for (size_t i = 0; i < m_visibleNodes.size(); ++i)
+        {
+            const VisibleNode& visibleNode = m_visibleNodes[i];
+            Node& node = *visibleNode.node;
+            if (visibleNode.drawFlags)
+            {
+                node.geometry->GetTimeline().Mark(NodeTimeline::Event_FirstDrawn);
+            }
+            if (visibleNode.drawFlags & DrawFlag_Opaque)
+            {
+                m_voxelRenderer->Draw(*node.geometry,
+                                      node.position);
+            }
+            else if (visibleNode.drawFlags & DrawFlag_Transparent)
+            {
+                m_voxelRenderer->DrawTransparent(*node.geometry,
+                                                 node.position,
+                                                 node.alpha);
+            }
+            if (visibleNode.drawFlags & DrawFlag_GapFiller)
+            {
+                m_voxelRenderer->DrawGapFiller(*node.geometry,
+                                               node.position);
+            }
+        }
+        m_voxelRenderer->Flush(renderContext, sceneConstants);
     }
-    m_voxelRenderer->Flush(renderContext, sceneConstants);
     profiler.End();
 }
 
@@ -157,10 +528,30 @@ void VoxelManager::DrawBoundingBoxes(RenderContext& renderContext,
 {
     static Profiler profiler("VoxelManager::DrawBoundingBoxes()");
     profiler.Begin();
-    for (auto i = m_nodeMap.begin(); i != m_nodeMap.end(); i++)
+    for (size_t i = 0; i < m_visibleNodes.size(); ++i)
     {
-        CalculateNodeVisibility(*i->second, sceneConstants.frustum);
-        DrawNodeBoundingBox(*i->second);
+        const Node& node = *m_visibleNodes[i].node;
+        if (node.children[0])
+        {
+            continue;
+        }
+
+        float4 color = float4(1.0f, 0.0f, 0.0f, 1.0f);
+        if (node.depth == 1)
+        {
+            color = float4(0.0f, 1.0f, 0.0f, 1.0f);
+        }
+        else if (node.depth == 2)
+        {
+            color = float4(0.0f, 0.0f, 1.0f, 1.0f);
+        }
+        else if (node.depth == 3)
+        {
+            color = float4(1.0f, 1.0f, 0.0f, 1.0f);
+        }
+
+        box3f box(node.position, node.position + node.size);
+        m_lineRenderer->DrawBox(box, color);
     }
     m_lineRenderer->Flush(renderContext, sceneConstants);
     profiler.End();
@@ -171,20 +562,26 @@ void VoxelManager::ProcessNodes()
     static Profiler profiler("VoxelManager::ProcessNodes()");
     profiler.Begin();
 
-    if (m_pendingNodes.size())
-    {
-        char buf[64];
-        sprintf_s(buf, "%d pending nodes\n", m_pendingNodes.size());
-        OutputDebugStringA(buf);
-    }
     if (m_mustSortNodes)
     {
+        //  Nodes which were dropped while queued don't need to be sorted
+        auto end = std::remove_if(m_pendingNodes.begin(),
+                                  m_pendingNodes.end(),
+                                  [] (const std::shared_ptr<Node>& node)
+                                  {
+                                      return node.unique();
+                                  });
+        s_schedulingStatistics.droppedCount += m_pendingNodes.end() - end;
+        m_pendingNodes.erase(end, m_pendingNodes.end());
+
         std::sort(m_pendingNodes.begin(), 
                   m_pendingNodes.end(),
                   [] (std::shared_ptr<Node>& lhs, std::shared_ptr<Node>& rhs)
                   {
                       return CompareNodePriority(*lhs, *rhs);
                   });
+        s_schedulingStatistics.sortCount++;
+        m_mustSortNodes = false;
     }
     
     for (size_t i = 0; i < 4; i++)
@@ -199,27 +596,37 @@ void VoxelManager::ProcessNodes()
         {
             // If this is the only pointer, the node was deleted before it was processed
             m_pendingNodes.erase(m_pendingNodes.begin());
+            s_schedulingStatistics.droppedCount++;
             continue;
         }
-        size_t processor = 0;
-        while (processor < 4)
+        size_t processor = 4, readyCount = 0;
+        for (size_t i = 0; i < 4; i++)
         {
-            if (m_voxelProcessorArray[processor]->IsReady())
+            if (m_voxelProcessorArray[i]->IsReady())
             {
-                break;
+                processor = min(processor, i);
+                readyCount++;
             }
-            processor++;
         }
-        if (processor == 4)
+        if (!readyCount)
+        {
+            break;
+        }
+
+        //  Speculative nodes are sorted last, and always leave a processor
+        //  free for visible work arriving next frame.
+        if (node->speculative && readyCount < 2)
         {
             break;
         }
 
+        node->geometry->GetTimeline().Mark(NodeTimeline::Event_Dispatched);
         m_voxelProcessorArray[processor]->Process(node->geometry,
                                                   node->position,
                                                   node->size,
                                                   node->depth);
         m_pendingNodes.erase(m_pendingNodes.begin());
+        s_schedulingStatistics.processedCount++;
     }
 
     profiler.End();
@@ -228,11 +635,24 @@ void VoxelManager::ProcessNodes()
 std::shared_ptr<VoxelManager::Node> VoxelManager::CreateNode(uint64_t id,
                                                              Node* parent)
 {
-    auto node = std::make_shared<Node>();
+    std::shared_ptr<Node> node(new Node(),
+                               [this] (Node* node)
+                               {
+                                   if (node->geometry)
+                                   {
+                                       node->geometry->GetTimeline().Mark(NodeTimeline::Event_Destroyed);
+                                   }
+                                   ReleaseLodSlot(*node);
+                                   delete node;
+                               });
 
     node->id = id;
     node->distance = FLT_MAX;
     node->visible = false;
+    node->speculative = false;
+    node->lastFailedPlane = 0;
+    node->lastFailedChildPlane = 0;
+    node->lastVisibleFrame = m_residencyManager->GetFrameIndex();
     node->alpha = 1.0f;
     node->parent = parent;
 
@@ -255,152 +675,501 @@ std::shared_ptr<VoxelManager::Node> VoxelManager::CreateNode(uint64_t id,
 
     node->size = scale;
 
-    node->geometry = std::make_shared<VoxelMesh>(m_graphicsDevice);
+    node->geometry = std::make_shared<VoxelMesh>(*m_meshHeap);
+    node->geometry->GetTimeline().Start(m_metrics ? &m_metrics->nodeLatencies : nullptr, node->depth);
+
+    AllocateLodSlot(*node);
 
     return node;
 }
 
-void VoxelManager::UpdateNode(Node& node,
-                              const Camera& camera)
+void VoxelManager::AllocateLodSlot(Node& node)
 {
-    float3 cpos = camera.GetPosition();
-    float3 center = node.position + (node.size * 0.5f);
+    LodLevel& level = m_lodLevels[node.depth];
+    if (level.count == level.nodes.size())
+    {
+        level.Resize(level.count + 4);
+    }
+
+    size_t slot = level.count++;
+    node.lodSlot = static_cast<uint32_t>(slot);
+    level.nodes[slot] = &node;
+    level.parentSlots[slot] = node.parent ? node.parent->lodSlot : 0;
+    level.centerX[slot] = node.position.x + (node.size.x * 0.5f);
+    level.centerZ[slot] = node.position.z + (node.size.z * 0.5f);
+    level.errors[slot] = node.size.x / m_cellsPerNode.x;
+    level.splitMasks[slot] = 0;
+
+    //  The distance is needed to prioritize the node before the next update
+    float dx = m_lastCameraPosition.x - level.centerX[slot],
+          dz = m_lastCameraPosition.z - level.centerZ[slot];
+    level.distances[slot] = sqrt((dx * dx) + (dz * dz));
+    node.distance = level.distances[slot];
+    level.splitDistances[slot] = 0.0f;
+    level.alphas[slot] = 1.0f;
+    level.lodFlags[slot] = 0;
+}
+
+void VoxelManager::ReleaseLodSlot(Node& node)
+{
+    LodLevel& level = m_lodLevels[node.depth];
+    size_t slot = node.lodSlot,
+           last = --level.count;
+    if (slot == last)
+    {
+        return;
+    }
+
+    level.Move(last, slot);
+    Node& moved = *level.nodes[slot];
+    moved.lodSlot = static_cast<uint32_t>(slot);
+
+    //  The moved node's children refer to it by slot
+    if (moved.children[0] || moved.prefetchedChildren[0])
+    {
+        LodLevel& childLevel = m_lodLevels[moved.depth + 1];
+        for (size_t i = 0; i < 8; ++i)
+        {
+            if (moved.children[i])
+            {
+                childLevel.parentSlots[moved.children[i]->lodSlot] = static_cast<uint32_t>(slot);
+            }
+            if (moved.prefetchedChildren[i])
+            {
+                childLevel.parentSlots[moved.prefetchedChildren[i]->lodSlot] = static_cast<uint32_t>(slot);
+            }
+        }
+    }
+}
+
+VoxelManager::LodLevel::LodLevel()
+: count(0)
+{
+}
+
+void VoxelManager::LodLevel::Resize(size_t size)
+{
+    assert((size % 4) == 0);
+    nodes.resize(size, nullptr);
+    parentSlots.resize(size, 0);
+    centerX.resize(size, 0.0f);
+    centerZ.resize(size, 0.0f);
+    errors.resize(size, 0.0f);
+    splitMasks.resize(size, 0);
+    distances.resize(size, FLT_MAX);
+    splitDistances.resize(size, 0.0f);
+    alphas.resize(size, 1.0f);
+    lodFlags.resize(size, 0);
+}
+
+void VoxelManager::LodLevel::Move(size_t from, size_t to)
+{
+    nodes[to] = nodes[from];
+    parentSlots[to] = parentSlots[from];
+    centerX[to] = centerX[from];
+    centerZ[to] = centerZ[from];
+    errors[to] = errors[from];
+    splitMasks[to] = splitMasks[from];
+    distances[to] = distances[from];
+    splitDistances[to] = splitDistances[from];
+    alphas[to] = alphas[from];
+    lodFlags[to] = lodFlags[from];
+}
+
+void VoxelManager::UpdateLodLevels(const float3& cameraPosition)
+{
+    static Profiler profiler("VoxelManager::UpdateLodLevels()");
+    profiler.Begin();
+
+    __m128 cameraX = _mm_set1_ps(cameraPosition.x),
+           cameraZ = _mm_set1_ps(cameraPosition.z),
+           errorScale = _mm_set1_ps(m_lodScale / PixelError),
+           unsplitRatio = _mm_set1_ps(UnsplitDistanceRatio),
+           fadeOutEndRatio = _mm_set1_ps(FadeOutEndDistanceRatio),
+           fadeOutRange = _mm_set1_ps(FadeOutStartDistanceRatio - FadeOutEndDistanceRatio),
+           fadeInRange = _mm_set1_ps(1.0f - FadeOutStartDistanceRatio),
+           zero = _mm_setzero_ps(),
+           one = _mm_set1_ps(1.0f);
+
+    //  Levels are updated from the root down, so that each node's parent is
+    //  already up to date. Padding slots are computed along with the rest and
+    //  ignored.
+    for (size_t depth = 0; depth < m_treeDepth; ++depth)
+    {
+        LodLevel& level = m_lodLevels[depth];
+        const LodLevel* parentLevel = depth ? &m_lodLevels[depth - 1] : nullptr;
+        for (size_t i = 0; i < level.count; i += 4)
+        {
+            __m128 dx = _mm_sub_ps(_mm_loadu_ps(&level.centerX[i]), cameraX),
+                   dz = _mm_sub_ps(_mm_loadu_ps(&level.centerZ[i]), cameraZ);
+            __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dz, dz)));
+            __m128 splitDistance = _mm_mul_ps(_mm_loadu_ps(&level.errors[i]), errorScale);
+
+            //  A split node fades out as the camera approaches its split
+            //  distance. NaNs from empty nodes clamp to one.
+            __m128 fadeOut = _mm_div_ps(_mm_sub_ps(distance, _mm_mul_ps(splitDistance, fadeOutEndRatio)),
+                                        _mm_mul_ps(splitDistance, fadeOutRange));
+            fadeOut = _mm_max_ps(_mm_min_ps(fadeOut, one), zero);
+
+            //  A leaf fades in over the same band of its parent's distance
+            __m128 fadeIn = one;
+            if (parentLevel)
+            {
+                float parentDistances[4], parentSplitDistances[4];
+                for (size_t j = 0; j < 4; ++j)
+                {
+                    uint32_t parentSlot = level.parentSlots[i + j];
+                    parentDistances[j] = parentLevel->distances[parentSlot];
+                    parentSplitDistances[j] = parentLevel->splitDistances[parentSlot];
+                }
+                __m128 parentDistance = _mm_loadu_ps(parentDistances),
+                       parentSplitDistance = _mm_loadu_ps(parentSplitDistances);
+                fadeIn = _mm_div_ps(_mm_sub_ps(parentSplitDistance, parentDistance),
+                                    _mm_mul_ps(parentSplitDistance, fadeInRange));
+                fadeIn = _mm_max_ps(_mm_min_ps(fadeIn, one), zero);
+            }
+
+            __m128 split = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&level.splitMasks[i])));
+            __m128 alpha = _mm_or_ps(_mm_and_ps(split, fadeOut), _mm_andnot_ps(split, fadeIn));
+
+            _mm_storeu_ps(&level.distances[i], distance);
+            _mm_storeu_ps(&level.splitDistances[i], splitDistance);
+            _mm_storeu_ps(&level.alphas[i], alpha);
+
+            int splitBits = _mm_movemask_ps(_mm_cmplt_ps(distance, splitDistance)),
+                unsplitBits = _mm_movemask_ps(_mm_cmpgt_ps(distance, _mm_mul_ps(splitDistance, unsplitRatio)));
+            for (size_t j = 0; j < 4; ++j)
+            {
+                level.lodFlags[i + j] = (((splitBits >> j) & 1) ? LodFlag_Split : 0) |
+                                        (((unsplitBits >> j) & 1) ? LodFlag_Unsplit : 0);
+            }
+        }
+    }
+
+    profiler.End();
+}
 
-#define SQUARE(x) ((x)*(x))
-    node.distance = sqrt(SQUARE(cpos.x - center.x) + SQUARE(cpos.z - center.z));
-    assert(node.distance >= 0);
+void VoxelManager::UpdateNode(Node& node,
+                              const Camera& camera,
+                              bool visible,
+                              uint32_t planeMask,
+                              bool drawable)
+{
+    //  The distance, blend factor and split decision were all computed by
+    //  UpdateLodLevels(). The blend factor reflects whether the node was split
+    //  last frame, which is only out of date while a newly split node's
+    //  children are loading and it is drawn opaque regardless.
+    LodLevel& level = m_lodLevels[node.depth];
+    size_t slot = node.lodSlot;
+    node.distance = level.distances[slot];
+    node.alpha = level.alphas[slot];
+    uint32_t lodFlags = level.lodFlags[slot];
+    float splitDistance = level.splitDistances[slot];
 
     if (!node.children[0] && node.depth < m_treeDepth - 1)
     {
-        if (node.distance < m_splitDistances[node.depth])
+        if ((lodFlags & LodFlag_Split) && m_residencyManager->CanLoad())
         {
             SplitNode(node);
         }
     }
     else
     {
-        if (node.distance > m_unsplitDistances[node.depth])
+        if (lodFlags & LodFlag_Unsplit)
         {
             UnsplitNode(node);
         }
     }
 
-    //  Blending distance is based on the center of the parent node in the tree
-    if (node.children[0])
+    //  The node is split once its geometric error would span more than the
+    //  target number of pixels. Until its mesh is ready the error is taken to
+    //  be one cell. The error takes effect from the next frame.
+    float cellSize = node.size.x / m_cellsPerNode.x;
+    float error = cellSize;
+    if (node.geometry->IsReady())
     {
-        //  If we are split then we may be fading out
-        float frac = node.distance - m_fadeOutEndDistances[node.depth];
-        node.alpha = min(1.0f, max(0.0f, frac / (m_fadeOutStartDistances[node.depth] - 
-                                                 m_fadeOutEndDistances[node.depth])));
+        error = min(node.geometry->GetGeometricError(), cellSize * MaxGeometricErrorCells);
+        m_residencyManager->AddResident(node.geometry->GetMemoryUsage());
     }
-    else if (node.depth > 0)
+    level.errors[slot] = error;
+    level.splitMasks[slot] = node.children[0] ? 0xFFFFFFFF : 0;
+
+    //  Generate the children the node will need once the camera reaches its
+    //  predicted position, and drop them again if it turns away.
+    if (!node.children[0] && node.depth < m_treeDepth - 1)
     {
-        //  If not split, we may be fading in
-        //  Use the parent node's distance for the blending factor
-        center = node.parent->position + (node.parent->size * 0.5f);
-        float dist = sqrt(SQUARE(cpos.x - center.x) + SQUARE(cpos.z - center.z));
-        float frac = m_splitDistances[node.depth - 1] - dist;
-        node.alpha = min(1.0f, max(0.0f, frac / (m_splitDistances[node.depth - 1] - 
-                                                 m_fadeOutStartDistances[node.depth - 1])));
+        float3 center = node.position + (node.size * 0.5f);
+        float dx = m_predictedPosition.x - center.x,
+              dz = m_predictedPosition.z - center.z;
+        float predictedDistance = sqrt((dx * dx) + (dz * dz));
+        if (!node.prefetchedChildren[0])
+        {
+            if (predictedDistance < splitDistance && m_residencyManager->CanLoad())
+            {
+                PrefetchNode(node);
+            }
+        }
+        else if (predictedDistance > splitDistance * UnsplitDistanceRatio)
+        {
+            for (size_t i = 0; i < 8; ++i)
+            {
+                node.prefetchedChildren[i].reset();
+            }
+        }
+        else
+        {
+            const LodLevel& childLevel = m_lodLevels[node.depth + 1];
+            for (size_t i = 0; i < 8; ++i)
+            {
+                Node& child = *node.prefetchedChildren[i];
+                child.distance = childLevel.distances[child.lodSlot];
+                if (child.geometry->IsReady())
+                {
+                    m_residencyManager->AddResident(child.geometry->GetMemoryUsage());
+                }
+            }
+        }
+    }
+
+    node.visible = visible;
+
+    bool childrenDrawable = false;
+    if (node.visible)
+    {
+        VisibleNode visibleNode = {&node, 0};
+        if (drawable && node.geometry->IsReady())
+        {
+            //  The node is drawn in place of its children until all of them
+            //  are ready.
+            bool mustDraw = false;
+            if (node.children[0])
+            {
+                for (size_t i = 0; i < 8; ++i)
+                {
+                    if (!node.children[i]->geometry->IsReady())
+                    {
+                        mustDraw = true;
+                        break;
+                    }
+                }
+            }
+
+            if (mustDraw || node.alpha == 1.0f)
+            {
+                visibleNode.drawFlags |= DrawFlag_Opaque;
+            }
+            else if (node.alpha > 0)
+            {
+                visibleNode.drawFlags |= DrawFlag_Transparent;
+            }
+
+            if (!mustDraw && node.children[0])
+            {
+                if (!node.children[0]->children[0] && node.alpha < 1.0f)
+                {
+                    visibleNode.drawFlags |= DrawFlag_GapFiller;
+                }
+                childrenDrawable = true;
+            }
+        }
+        m_visibleNodes.push_back(visibleNode);
     }
 
     if (node.children[0])
     {
+        //  Test all eight children against the frustum at once. Children of a
+        //  node outside the frustum are outside it too, and children of a node
+        //  entirely inside some of the planes are inside those planes too.
+        uint32_t childMask = 0;
+        uint32_t childPlaneMasks[8] = {0};
+        if (node.visible && planeMask)
+        {
+            BoxBatch batch;
+            for (size_t i = 0; i < 8; ++i)
+            {
+                const Node& child = *node.children[i];
+                batch.Set(i, box3f(child.position, child.position + child.size));
+            }
+            childMask = camera.GetFrustum().IntersectsBatch(batch,
+                                                            8,
+                                                            planeMask,
+                                                            childPlaneMasks,
+                                                            node.lastFailedChildPlane);
+        }
+        else if (node.visible)
+        {
+            childMask = 0xFF;
+        }
+
         for (size_t i = 0; i < 8; ++i)
         {
-            UpdateNode(*node.children[i], camera);
+            UpdateNode(*node.children[i],
+                       camera,
+                       (childMask & (1 << i)) != 0,
+                       childPlaneMasks[i],
+                       childrenDrawable);
         }
     }
 }
 
-void VoxelManager::CalculateNodeVisibility(Node& node, const Frustum& frustum, bool recursive)
+void VoxelManager::CullOccludedNodes(const Camera& camera)
 {
-    box3f boundingBox(node.position, node.position + node.size);
-    node.visible = frustum.Intersects(boundingBox);
-    if (recursive && node.visible && node.children[0])
+    static Profiler profiler("VoxelManager::CullOccludedNodes()");
+    profiler.Begin();
+
+    //
+    //  Only nodes which are drawn opaque are used as occluders, so that the
+    //  occluders always match what is on screen.
+    //
+    m_occluderNodes.clear();
+    for (size_t i = 0; i < m_visibleNodes.size(); ++i)
     {
-        for (size_t i = 0; i < 8; i++)
+        const VisibleNode& visibleNode = m_visibleNodes[i];
+        if ((visibleNode.drawFlags & DrawFlag_Opaque) &&
+            !visibleNode.node->geometry->GetOccluders().empty())
         {
-            CalculateNodeVisibility(*node.children[i], frustum);
+            m_occluderNodes.push_back(visibleNode.node);
         }
     }
-}
+    size_t occluderNodeCount = min(m_occluderNodes.size(), MaxOccluderNodes);
+    std::partial_sort(m_occluderNodes.begin(),
+                      m_occluderNodes.begin() + occluderNodeCount,
+                      m_occluderNodes.end(),
+                      [] (const Node* lhs, const Node* rhs)
+                      {
+                          return lhs->distance < rhs->distance;
+                      });
 
-void VoxelManager::DrawNode(Node& node, bool recursive)
-{
-    if (node.geometry->IsReady() && node.visible)
+    m_occlusionCuller->Begin(camera);
+    for (size_t i = 0; i < occluderNodeCount && m_occlusionCuller->GetOccluderCount() < MaxOccluders; ++i)
     {
-        bool mustDraw = !recursive;
-        if (!mustDraw && node.children[0])
+        const std::vector<box3f>& occluders = m_occluderNodes[i]->geometry->GetOccluders();
+        for (size_t j = 0; j < occluders.size() && m_occlusionCuller->GetOccluderCount() < MaxOccluders; ++j)
         {
-            for (size_t i = 0; i < 8; ++i)
-            {
-                if (!node.children[0]->geometry->IsReady())
-                {
-                    mustDraw = true;
-                    break;
-                }
-            }
+            m_occlusionCuller->RenderOccluder(occluders[j]);
         }
+    }
+    m_occlusionCuller->End();
 
-        if (mustDraw || node.alpha == 1.0f)
+    //
+    //  Drop hidden nodes from the list, keeping the rest in order.
+    //
+    size_t visibleCount = 0;
+    for (size_t i = 0; i < m_visibleNodes.size(); ++i)
+    {
+        Node& node = *m_visibleNodes[i].node;
+        box3f boundingBox(node.position, node.position + node.size);
+        if (m_occlusionCuller->IsVisible(boundingBox))
         {
-            m_voxelRenderer->Draw(*node.geometry,
-                                  node.position);
+            m_visibleNodes[visibleCount++] = m_visibleNodes[i];
         }
-        else if (node.alpha > 0)
+        else
         {
-            m_voxelRenderer->DrawTransparent(*node.geometry,
-                                             node.position,
-                                             node.alpha);
+            node.visible = false;
         }
-        
-        if (!mustDraw && node.children[0])
+    }
+
+    s_occlusionStatistics.occluderCount += m_occlusionCuller->GetOccluderCount();
+    s_occlusionStatistics.testedCount += m_visibleNodes.size();
+    s_occlusionStatistics.culledCount += m_visibleNodes.size() - visibleCount;
+    s_occlusionStatistics.frameCount++;
+    m_visibleNodes.resize(visibleCount);
+
+    profiler.End();
+}
+
+void VoxelManager::EvictMeshes()
+{
+    if (!m_residencyManager->GetExcessBytes())
+    {
+        return;
+    }
+
+    static Profiler profiler("VoxelManager::EvictMeshes()");
+    profiler.Begin();
+
+    //  A candidate is as recent as its most recently visible child
+    m_evictionCandidates.clear();
+    for (auto i = m_nodeMap.begin(); i != m_nodeMap.end(); ++i)
+    {
+        FindEvictionCandidates(*i->second);
+    }
+    std::sort(m_evictionCandidates.begin(),
+              m_evictionCandidates.end(),
+              [] (const std::pair<uint32_t, Node*>& lhs, const std::pair<uint32_t, Node*>& rhs)
+              {
+                  if (lhs.first != rhs.first)
+                  {
+                      return lhs.first < rhs.first;
+                  }
+                  return lhs.second->distance > rhs.second->distance;
+              });
+
+    for (size_t i = 0; i < m_evictionCandidates.size() && m_residencyManager->GetExcessBytes(); ++i)
+    {
+        Node& node = *m_evictionCandidates[i].second;
+        for (size_t j = 0; j < 8; ++j)
         {
-            if (!node.children[0]->children[0] && node.alpha < 1.0f)
+            const VoxelMesh& geometry = *node.children[j]->geometry;
+            if (geometry.IsReady())
             {
-                m_voxelRenderer->DrawGapFiller(*node.geometry,
-                                                node.position);
-            }
-            for (size_t i = 0; i < 8; ++i)
-            {
-                DrawNode(*node.children[i], recursive);
+                m_residencyManager->RecordEviction(geometry.GetMemoryUsage());
             }
         }
+        UnsplitNode(node);
     }
+
+    profiler.End();
 }
 
-void VoxelManager::DrawNodeBoundingBox(Node& node)
+void VoxelManager::FindEvictionCandidates(Node& node)
 {
-    if (node.visible)
+    if (!node.children[0])
     {
-        if (node.children[0])
+        return;
+    }
+
+    bool childrenAreLeaves = true;
+    uint32_t lastVisibleFrame = 0;
+    for (size_t i = 0; i < 8; ++i)
+    {
+        Node& child = *node.children[i];
+        if (child.children[0])
         {
-            for (size_t i = 0; i < 8; ++i)
-            {
-                DrawNodeBoundingBox(*node.children[i]);
-            }
+            childrenAreLeaves = false;
+            FindEvictionCandidates(child);
         }
-        else
-        {
-            float4 color = float4(1.0f, 0.0f, 0.0f, 1.0f);
-            if (node.depth == 1)
-            {
-                color = float4(0.0f, 1.0f, 0.0f, 1.0f);
-            }
-            else if (node.depth == 2)
-            {
-                color = float4(0.0f, 0.0f, 1.0f, 1.0f);
-            }
-            else if (node.depth == 3)
-            {
-                color = float4(1.0f, 1.0f, 0.0f, 1.0f);
-            }
+        lastVisibleFrame = max(lastVisibleFrame, child.lastVisibleFrame);
+    }
 
-            box3f box(node.position, node.position + node.size);
-            m_lineRenderer->DrawBox(box, color);
-        }
+    if (childrenAreLeaves)
+    {
+        m_evictionCandidates.push_back(std::make_pair(lastVisibleFrame, &node));
+    }
+}
+
+void VoxelManager::UpdateCameraVelocity(const Camera& camera)
+{
+    uint64_t time = Profiler::GetTicks();
+
+    //  The first call only establishes a starting point. A teleport says
+    //  nothing about where the camera is heading, so the estimate starts
+    //  again from rest rather than carrying the jump for many frames.
+    float3 offset = camera.GetPosition() - m_lastCameraPosition;
+    float teleportDistance = m_nodeDimensions[0].x * TeleportDistanceRatio;
+    if (Dot(offset, offset) > teleportDistance * teleportDistance)
+    {
+        m_cameraVelocity = float3(0.0f, 0.0f, 0.0f);
     }
+    else if (m_lastCameraTime && time > m_lastCameraTime)
+    {
+        float elapsed = static_cast<float>(time - m_lastCameraTime) / static_cast<float>(Profiler::GetTicksPerSecond());
+        float3 velocity = offset * (1.0f / elapsed);
+        m_cameraVelocity = (m_cameraVelocity * (1.0f - VelocitySmoothing)) + (velocity * VelocitySmoothing);
+    }
+    m_lastCameraTime = time;
+    m_lastCameraPosition = camera.GetPosition();
+    m_predictedPosition = camera.GetPosition() + (m_cameraVelocity * m_prefetchHorizon);
 }
 
 void VoxelManager::SplitNode(Node& node)
@@ -410,7 +1179,39 @@ void VoxelManager::SplitNode(Node& node)
     {
         return;
     }
+    s_schedulingStatistics.splitCount++;
+
+    if (node.prefetchedChildren[0])
+    {
+        //  The prefetched children may still be queued at low priority
+        for (size_t i = 0; i < 8; ++i)
+        {
+            node.children[i] = std::move(node.prefetchedChildren[i]);
+            node.children[i]->speculative = false;
+        }
+        m_mustSortNodes = true;
+        s_schedulingStatistics.prefetchUsedCount++;
+        return;
+    }
+
+    CreateChildren(node, node.children, false);
+}
 
+void VoxelManager::PrefetchNode(Node& node)
+{
+    if (!node.geometry->GetVertexCount())
+    {
+        return;
+    }
+
+    CreateChildren(node, node.prefetchedChildren, true);
+    s_schedulingStatistics.prefetchCount++;
+}
+
+void VoxelManager::CreateChildren(Node& node,
+                                  std::array<std::shared_ptr<Node>, 8>& children,
+                                  bool speculative)
+{
     int baseX = static_cast<int16_t>((node.id >> 48) & 0xFFFFFF);
     int baseZ = static_cast<int16_t>((node.id >> 32) & 0xFFFFFF);
     int baseY = static_cast<int16_t>((node.id >> 16) & 0xFFFFFF);
@@ -425,15 +1226,16 @@ void VoxelManager::SplitNode(Node& node)
         {
             for (size_t subZ = 0; subZ < 2; subZ++)
             {
-                node.children[index] = CreateNode(MakeNodeId(baseX, 
-                                                             baseZ,
-                                                             baseY,
-                                                             node.depth + 1,
-                                                             (sub_x * 2) + subX,
-                                                             (sub_y * 2) + subY,
-                                                             (sub_z * 2) + subZ),
-                                                  &node);
-                ProcessNode(node.children[index]);
+                children[index] = CreateNode(MakeNodeId(baseX, 
+                                                        baseZ,
+                                                        baseY,
+                                                        node.depth + 1,
+                                                        (sub_x * 2) + subX,
+                                                        (sub_y * 2) + subY,
+                                                        (sub_z * 2) + subZ),
+                                             &node);
+                children[index]->speculative = speculative;
+                ProcessNode(children[index]);
                 ++index;
             }
         }
@@ -448,8 +1250,65 @@ void VoxelManager::UnsplitNode(Node& node)
     }
 }
 
+void VoxelManager::UpdateMetrics()
+{
+    MetricSet& metrics = *m_metrics;
+    metrics.pendingNodes->Set(static_cast<double>(m_pendingNodes.size()));
+
+    size_t inflightCount = 0;
+    for (size_t i = 0; i < m_voxelProcessorArray.size(); ++i)
+    {
+        if (!m_voxelProcessorArray[i]->IsReady())
+        {
+            ++inflightCount;
+        }
+    }
+    metrics.inflightJobs->Set(static_cast<double>(inflightCount));
+
+    //  The level of detail slots already list every node by depth
+    for (size_t depth = 0; depth < MaxTreeDepth; ++depth)
+    {
+        const LodLevel& level = m_lodLevels[depth];
+        size_t residentCount = 0;
+        for (size_t i = 0; i < level.count; ++i)
+        {
+            if (level.nodes[i]->geometry->IsReady())
+            {
+                ++residentCount;
+            }
+        }
+        metrics.residentNodes[depth]->Set(static_cast<double>(residentCount));
+    }
+
+    for (size_t i = 0; i < MeshHeap::Pool_Count; ++i)
+    {
+        MeshHeap::Pool pool = static_cast<MeshHeap::Pool>(i);
+        metrics.heapBytes[i]->Set(static_cast<double>(m_meshHeap->GetBytesUsed(pool)));
+        metrics.heapCapacity[i]->Set(static_cast<double>(m_meshHeap->GetCapacity(pool)));
+    }
+
+    metrics.residentBytes->Set(static_cast<double>(m_residencyManager->GetBytesUsed()));
+    metrics.budgetBytes->Set(static_cast<double>(m_residencyManager->GetBudget()));
+    metrics.evictions->Set(m_residencyManager->GetEvictionCount());
+    metrics.evictedBytes->Set(m_residencyManager->GetEvictedBytes());
+
+    metrics.queuedNodes->Set(s_schedulingStatistics.queuedCount);
+    metrics.droppedNodes->Set(s_schedulingStatistics.droppedCount);
+    metrics.processedNodes->Set(s_schedulingStatistics.processedCount);
+    metrics.splits->Set(s_schedulingStatistics.splitCount);
+    metrics.prefetchedNodes->Set(s_schedulingStatistics.prefetchCount);
+    metrics.prefetchHits->Set(s_schedulingStatistics.prefetchUsedCount);
+    if (s_schedulingStatistics.splitCount)
+    {
+        metrics.prefetchHitRatio->Set(static_cast<double>(s_schedulingStatistics.prefetchUsedCount) /
+                                      static_cast<double>(s_schedulingStatistics.splitCount));
+    }
+}
+
 void VoxelManager::ProcessNode(std::shared_ptr<Node> node)
 {
+    node->geometry->GetTimeline().Mark(NodeTimeline::Event_Queued);
     m_pendingNodes.push_back(node);
     m_mustSortNodes = true;
+    s_schedulingStatistics.queuedCount++;
 }
@@ -12,8 +12,12 @@
 //  Forward declarations.
 //
 class LineRenderer;
+class OcclusionCuller;
 class GraphicsDevice;
+class MeshHeap;
+class MetricsRegistry;
 class RenderContext;
+class ResidencyManager;
 class SceneConstants;
 class VoxelProcessor;
 class VoxelRenderer;
@@ -48,13 +52,85 @@ public:
     //
     //  Updates the simulation.
     //
+    //  Pending nodes are processed and the mesh heap is compacted if its free
+    //  space has grown too scattered.
+    //
     void Update();
 
     //
     //  Updates the voxel world based on the camera position.
     //
+    //  The nodes visible from the camera and from the reflected view set by
+    //  SetReflection() are both found in the same traversal of the tree.
+    //
     void SetCamera(const Camera& camera);
 
+    //
+    //  Sets the reflected view to cull for at the next call to SetCamera().
+    //
+    //  Parameters:
+    //      [in] frustum
+    //          Frustum of the reflected view.
+    //      [in] clipPlane
+    //          Plane in front of which the reflection is drawn.
+    //
+    void SetReflection(const Frustum& frustum, const float4& clipPlane);
+
+    //
+    //  Sets the budget for resident meshes.
+    //
+    //  Nodes are split only while the meshes fit within 90% of the budget.
+    //  Above that, the least recently visible leaf nodes are merged back into
+    //  their parents until the meshes fit within 80% of it.
+    //
+    //  Parameters:
+    //      [in] bytes
+    //          Budget in bytes.
+    //
+    void SetMeshBudget(size_t bytes);
+
+    //
+    //  Sets how far ahead nodes are generated speculatively.
+    //
+    //  The camera's velocity is estimated across calls to SetCamera, and
+    //  nodes which would be split at the camera's predicted position are
+    //  generated ahead of time at low priority, using only processors which
+    //  no visible work needs.
+    //
+    //  Parameters:
+    //      [in] seconds
+    //          Prediction horizon in seconds, or zero to disable prefetching.
+    //
+    void SetPrefetchHorizon(float seconds);
+
+    //
+    //  Publishes the state of the tree to a metrics registry, sampled once a
+    //  frame by Update(): the pending node queue, the jobs in flight, the
+    //  resident nodes at each depth, the mesh heap and residency budget, and
+    //  the eviction and prefetch totals.
+    //
+    //  Nodes created from then on also record how long they take to pass
+    //  through each stage of the pipeline, from being queued to being drawn
+    //  (see NodeTimeline), and how long each depth takes to become visible.
+    //
+    //  Parameters:
+    //      [in] registry
+    //          Registry to publish to, which must outlive the manager. It may
+    //          only be set once.
+    //
+    void SetMetrics(MetricsRegistry& registry);
+
+    //
+    //  Returns the residency manager, which reports the memory used by
+    //  resident meshes and the number of meshes evicted.
+    //
+    const ResidencyManager& GetResidencyManager() const;
+
+    //
+    //  Returns the heap from which mesh vertices and indices are allocated.
+    //
+    const MeshHeap& GetMeshHeap() const;
+
     //
     //  Draws the voxel world.
     //
@@ -80,8 +156,23 @@ public:
     //
     //  Processes pending nodes.
     //
+    //  Nodes dropped while queued are discarded, and the queue is sorted by
+    //  priority whenever nodes have been added or the camera has moved.
+    //
     void ProcessNodes();
 
+    //
+    //  Packs a node ID from its base coordinates, depth and subdivision
+    //  index within the base node.
+    //
+    static uint64_t MakeNodeId(int16_t baseX,
+                               int16_t baseZ,
+                               int16_t baseY,
+                               size_t depth,
+                               size_t subX,
+                               size_t subY,
+                               size_t subZ);
+
 private:
     //
     //  An individual node in the tree.
@@ -89,6 +180,7 @@ private:
     struct Node
     {
         std::array<std::shared_ptr<Node>, 8> children;
+        std::array<std::shared_ptr<Node>, 8> prefetchedChildren;
         float3 position;
         float3 size;
         int depth;
@@ -98,50 +190,193 @@ private:
         float alpha;
         Node* parent;
         bool visible;
+        bool speculative;
+        uint32_t lastFailedPlane;
+        uint32_t lastFailedChildPlane;
+        uint32_t lastVisibleFrame;
+        uint32_t lodSlot;
     };
 
     //
-    //  Packs a node ID.
+    //  Metrics published by UpdateMetrics().
     //
-    static uint64_t MakeNodeId(int16_t baseX,
-                               int16_t baseZ,
-                               int16_t baseY,
-                               size_t depth,
-                               size_t subX,
-                               size_t subY,
-                               size_t subZ);
+    struct MetricSet;
 
     //
-    //  Updates an individual node.
+    //  Results of the level of detail update for a node.
     //
-    void UpdateNode(Node& node, const Camera& camera);
+    enum LodFlag
+    {
+        LodFlag_Split = 1 << 0,
+        LodFlag_Unsplit = 1 << 1
+    };
 
     //
-    //  Calculates a node's visibility.
+    //  Level of detail state for every node at one depth.
     //
-    void CalculateNodeVisibility(Node& node, const Frustum& frustum, bool recursive = true);
+    //  The state is kept in parallel arrays, indexed by each node's lodSlot,
+    //  so that a whole level can be updated four nodes at a time. Slots are
+    //  kept packed by moving the last node into a released slot, and the
+    //  arrays are padded to a multiple of four.
+    //
+    struct LodLevel
+    {
+        size_t count;
+        std::vector<Node*> nodes;
+        std::vector<uint32_t> parentSlots;
+        std::vector<float> centerX;
+        std::vector<float> centerZ;
+        std::vector<float> errors;
+        std::vector<uint32_t> splitMasks;
+        std::vector<float> distances;
+        std::vector<float> splitDistances;
+        std::vector<float> alphas;
+        std::vector<uint32_t> lodFlags;
+
+        LodLevel();
+        void Resize(size_t size);
+        void Move(size_t from, size_t to);
+    };
+
+    //
+    //  Flags describing how a visible node is drawn.
+    //
+    enum DrawFlag
+    {
+        DrawFlag_Opaque = 1 << 0,
+        DrawFlag_Transparent = 1 << 1,
+        DrawFlag_GapFiller = 1 << 2
+    };
+
+    //
+    //  An entry in the visible node list.
+    //
+    struct VisibleNode
+    {
+        Node* node;
+        uint32_t drawFlags;
+    };
+
+    //
+    //  Computes the distance, split distance, split decision and blend factor
+    //  of every node, one level at a time from the root down.
+    //
+    void UpdateLodLevels(const float3& cameraPosition);
+
+    //
+    //  Updates an individual node and its children.
+    //
+    //  This is the only traversal of the tree each frame: it applies the
+    //  split decision made by UpdateLodLevels(), tests the node against the
+    //  frustum and appends it to the visible node list. Each node's children
+    //  are tested against the frustum together.
+    //
+    //  Parameters:
+    //      [in] node
+    //          Node to update.
+    //      [in] camera
+    //          Camera to update against.
+    //      [in] visible
+    //          True if the node intersects the frustum.
+    //      [in] planeMask
+    //          Frustum planes which the node intersects; it is entirely inside
+    //          the others, and so are its children.
+    //      [in] drawable
+    //          True if the node may be drawn; false if the parent is drawn
+    //          in its place.
+    //
+    void UpdateNode(Node& node,
+                    const Camera& camera,
+                    bool visible,
+                    uint32_t planeMask,
+                    bool drawable);
+
+    //
+    //  Removes nodes hidden behind nearby terrain from the visible node list.
+    //
+    //  The solid boxes of the nearest opaque nodes are rendered into the
+    //  occlusion culler, then every visible node is tested against it. Nodes
+    //  found to be hidden are marked invisible, which also lowers their
+    //  processing priority.
+    //
+    void CullOccludedNodes(const Camera& camera);
+
+    //
+    //  Evicts meshes until the resident meshes fit within the budget.
+    //
+    //  Only nodes whose children are all leaves are unsplit, least recently
+    //  visible first, so that every evicted mesh leaves a coarser ancestor
+    //  in its place and no holes open up.
+    //
+    void EvictMeshes();
 
     //
-    //  Splits a node.
+    //  Adds the nodes below a node which can be unsplit to the eviction
+    //  candidates.
+    //
+    void FindEvictionCandidates(Node& node);
+
+    //
+    //  Updates the camera velocity estimate, which starts again from rest
+    //  whenever the camera teleports.
+    //
+    void UpdateCameraVelocity(const Camera& camera);
+
+    //
+    //  Splits a node, adopting its prefetched children if it has any.
     //
     void SplitNode(Node& node);
 
     //
-    //  Unsplits a node.
+    //  Generates a node's children speculatively, without adding them to the
+    //  tree.
     //
-    void UnsplitNode(Node& node);
+    void PrefetchNode(Node& node);
+
+    //
+    //  Creates and enqueues the eight children of a node.
+    //
+    //  Parameters:
+    //      [in] node
+    //          Parent node.
+    //      [out] children
+    //          Receives the new children.
+    //      [in] speculative
+    //          True if the children are being prefetched.
+    //
+    void CreateChildren(Node& node,
+                        std::array<std::shared_ptr<Node>, 8>& children,
+                        bool speculative);
 
     //
-    //  Draws a node.
+    //  Unsplits a node.
     //
-    void DrawNode(Node& node, bool recursive);
-    void DrawNodeBoundingBox(Node& node);
+    void UnsplitNode(Node& node);
 
     //
     //  Creates a new node.
     //
+    //  The node is given a level of detail slot, which is released when the
+    //  last reference to the node goes away.
+    //
     std::shared_ptr<Node> CreateNode(uint64_t id, Node* parent);
 
+    //
+    //  Gives a node a slot in its level's level of detail arrays.
+    //
+    void AllocateLodSlot(Node& node);
+
+    //
+    //  Releases a node's level of detail slot, moving the level's last node
+    //  into it.
+    //
+    void ReleaseLodSlot(Node& node);
+
+    //
+    //  Samples the published metrics.
+    //
+    void UpdateMetrics();
+
     //
     //  Enqueues a node for processing.
     //
@@ -156,21 +391,40 @@ private:
     //  Properties.
     //
     static const size_t MaxTreeDepth = 8;
+    static const size_t MaxOccluderNodes = 32;
+    static const size_t MaxOccluders = 512;
     GraphicsDevice& m_graphicsDevice;
+    std::unique_ptr<MeshHeap> m_meshHeap;
     std::unique_ptr<VoxelRenderer> m_voxelRenderer;
+    std::unique_ptr<VoxelRenderer> m_lowDetailRenderer;
     std::unique_ptr<LineRenderer> m_lineRenderer;
+    std::unique_ptr<OcclusionCuller> m_occlusionCuller;
+    std::unique_ptr<ResidencyManager> m_residencyManager;
+    std::unique_ptr<MetricSet> m_metrics;
     Camera m_oldCamera;
+    float3 m_sortPosition;
+    float3 m_sortForward;
     uint3 m_cellsPerNode;
     size_t m_treeDepth;
     float m_radius;
     std::array<float3, MaxTreeDepth> m_nodeDimensions;
-    std::array<float, MaxTreeDepth + 1> m_splitDistances;
-    std::array<float, MaxTreeDepth + 1> m_unsplitDistances;
-    std::array<float, MaxTreeDepth + 1> m_fadeOutStartDistances;
-    std::array<float, MaxTreeDepth + 1> m_fadeOutEndDistances;
+    float m_lodScale;
+    float m_prefetchHorizon;
+    float3 m_cameraVelocity;
+    float3 m_lastCameraPosition;
+    float3 m_predictedPosition;
+    uint64_t m_lastCameraTime;
     std::array<std::unique_ptr<VoxelProcessor>, 4> m_voxelProcessorArray;
+    std::array<LodLevel, MaxTreeDepth> m_lodLevels;
     std::map<uint64_t, std::shared_ptr<Node>> m_nodeMap;
     std::vector<std::shared_ptr<Node>> m_pendingNodes;
+    std::vector<VisibleNode> m_visibleNodes;
+    std::vector<Node*> m_reflectedNodes;
+    Frustum m_reflectionFrustum;
+    float4 m_reflectionClipPlane;
+    bool m_hasReflection;
+    std::vector<Node*> m_occluderNodes;
+    std::vector<std::pair<uint32_t, Node*>> m_evictionCandidates;
     bool m_mustSortNodes;
 };
 
@@ -196,6 +450,10 @@ inline uint64_t VoxelManager::MakeNodeId(int16_t baseX,
 
 inline bool VoxelManager::CompareNodePriority(const Node& lhs, const Node& rhs)
 {
+    if (lhs.speculative != rhs.speculative)
+    {
+        return lhs.speculative < rhs.speculative;
+    }
     if (lhs.visible != rhs.visible)
     {
         return lhs.visible > rhs.visible;
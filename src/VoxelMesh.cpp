@@ -4,73 +4,55 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "Prefix.h"
-#include "GraphicsDevice.h"
 #include "VoxelMesh.h"
 
-VoxelMesh::VoxelMesh(GraphicsDevice& graphicsDevice)
-: m_graphicsDevice(graphicsDevice),
+VoxelMesh::VoxelMesh(MeshHeap& meshHeap)
+: m_meshHeap(meshHeap),
+  m_vertexBlock(nullptr),
+  m_indexBlock(nullptr),
   m_vertexCount(0),
   m_indexCount(0),
-  m_ready(false)
+  m_ready(false),
+  m_geometricError(0.0f)
 {
 }
 
 VoxelMesh::~VoxelMesh()
 {
+    m_meshHeap.Free(m_vertexBlock);
+    m_meshHeap.Free(m_indexBlock);
 }
 
 void VoxelMesh::Resize(size_t vertexCount, size_t indexCount)
 {
-    m_vertexBuffer.reset();
-    m_indexBuffer.reset();
-    m_vertexCount = vertexCount;
-    m_indexCount = indexCount;
-
-    m_vertexBuffer.reset();
-    m_indexBuffer.reset();
+    m_meshHeap.Free(m_vertexBlock);
+    m_meshHeap.Free(m_indexBlock);
 
     m_vertexCount = vertexCount;
     m_indexCount = indexCount;
 
-    if (m_vertexCount)
+    m_vertexBlock = m_meshHeap.Allocate(MeshHeap::Pool_Vertex, m_vertexCount);
+    m_indexBlock = m_meshHeap.Allocate(MeshHeap::Pool_Index, m_indexCount);
+}
+
+void VoxelMesh::CopyFrom(ID3D11Buffer* vertexBuffer, ID3D11Buffer* indexBuffer)
+{
+    if (m_vertexBlock)
     {
-        //
-        //  Recreate the vertex buffer.
-        //
-        D3D11_BUFFER_DESC vertexBufferDesc =
-        {
-            m_vertexCount * sizeof(Vertex),                         //  ByteWidth
-            D3D11_USAGE_DEFAULT,                                    //  Usage
-            D3D11_BIND_VERTEX_BUFFER,                               //  BindFlags
-            0,                                                      //  CPUAccessFlags
-            0,                                                      //  MiscFlags
-            0                                                       //  StructureByteStride
-        };
-        D3DCHECK(m_graphicsDevice.GetD3DDevice().CreateBuffer(&vertexBufferDesc,
-                                                              NULL,
-                                                              AttachPtr(m_vertexBuffer)));
+        m_meshHeap.CopyFrom(*m_vertexBlock, vertexBuffer);
     }
-    if (m_indexCount)
+    if (m_indexBlock)
     {
-        //
-        //  Recreate the index buffer.
-        //
-        D3D11_BUFFER_DESC indexBufferDesc =
-        {
-            m_indexCount * sizeof(uint16_t),                        //  ByteWidth
-            D3D11_USAGE_DEFAULT,                                    //  Usage
-            D3D11_BIND_INDEX_BUFFER,                                //  BindFlags
-            0,                                                      //  CPUAccessFlags
-            0,                                                      //  MiscFlags
-            0                                                       //  StructureByteStride
-        };
-        D3DCHECK(m_graphicsDevice.GetD3DDevice().CreateBuffer(&indexBufferDesc,
-                                                              NULL,
-                                                              AttachPtr(m_indexBuffer)));
+        m_meshHeap.CopyFrom(*m_indexBlock, indexBuffer);
     }
 }
 
 void VoxelMesh::SetReady(bool ready)
 {
     m_ready = ready;
-}
\ No newline at end of file
+}
+
+void VoxelMesh::SetOccluders(const box3f* boxes, size_t boxCount)
+{
+    m_occluders.assign(boxes, boxes + boxCount);
+}
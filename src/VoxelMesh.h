@@ -6,10 +6,8 @@
 #ifndef __NYX_VOXELMESH_H__
 #define __NYX_VOXELMESH_H__
 
-//
-//  Forward declarations.
-//
-class GraphicsDevice;
+#include "MeshHeap.h"
+#include "NodeTimeline.h"
 
 class VoxelMesh : public boost::noncopyable
 {
@@ -28,10 +26,10 @@ public:
     //  Constructor.
     //
     //  Parameters:
-    //      [in] graphicsDevice
-    //          Parent GraphicsDevice instance.
+    //      [in] meshHeap
+    //          Heap from which the vertex and index ranges are allocated.
     //
-    VoxelMesh(GraphicsDevice& graphicsDevice);
+    VoxelMesh(MeshHeap& meshHeap);
 
     //
     //  Destructor.
@@ -39,7 +37,9 @@ public:
     ~VoxelMesh();
 
     //
-    //  Resizes the vertex and index buffers.
+    //  Resizes the vertex and index ranges.
+    //
+    //  The old ranges are freed and new ones allocated from the mesh heap.
     //
     //  Parameters:
     //      [in] vertexCount
@@ -59,16 +59,42 @@ public:
     //
     size_t GetIndexCount() const;
 
+    //
+    //  Returns the size of the vertex and index buffers, in bytes.
+    //
+    size_t GetMemoryUsage() const;
+
     //
     //  Returns a pointer to the vertex buffer, or null if there is no vertex data.
     //
+    //  The buffer is shared with other meshes; the mesh's vertices start at
+    //  GetBaseVertex().
+    //
     ID3D11Buffer* GetVertexBuffer() const;
 
     //
     //  Returns a pointer to the index buffer, or null if there is no index data.
     //
+    //  The buffer is shared with other meshes; the mesh's indices start at
+    //  GetStartIndex().
+    //
     ID3D11Buffer* GetIndexBuffer() const;
 
+    //
+    //  Returns the position of the first vertex in the vertex buffer.
+    //
+    size_t GetBaseVertex() const;
+
+    //
+    //  Returns the position of the first index in the index buffer.
+    //
+    size_t GetStartIndex() const;
+
+    //
+    //  Copies vertices and indices from the start of two buffers.
+    //
+    void CopyFrom(ID3D11Buffer* vertexBuffer, ID3D11Buffer* indexBuffer);
+
     //
     //  Checks if the geometry is ready.
     //
@@ -79,16 +105,53 @@ public:
     //
     void SetReady(bool ready);
 
+    //
+    //  Sets the boxes, in world space, which lie entirely inside the solid
+    //  part of the chunk and so can be used as occluders.
+    //
+    //  Parameters:
+    //      [in] boxes
+    //          Occluder boxes.
+    //      [in] boxCount
+    //          Number of boxes.
+    //
+    void SetOccluders(const box3f* boxes, size_t boxCount);
+
+    //
+    //  Returns the occluder boxes.
+    //
+    const std::vector<box3f>& GetOccluders() const;
+
+    //
+    //  Sets the estimated geometric error of the mesh, in world units.
+    //
+    void SetGeometricError(float error);
+
+    //
+    //  Returns the estimated geometric error of the mesh, in world units.
+    //
+    float GetGeometricError() const;
+
+    //
+    //  Returns the timeline of the node the mesh belongs to. It is kept with
+    //  the mesh because the mesh is what the node shares with the voxel
+    //  processor generating it.
+    //
+    NodeTimeline& GetTimeline();
+
 private:
     //
     //  Properties.
     //
-    GraphicsDevice& m_graphicsDevice;
-    boost::intrusive_ptr<ID3D11Buffer> m_vertexBuffer;
-    boost::intrusive_ptr<ID3D11Buffer> m_indexBuffer;
+    MeshHeap& m_meshHeap;
+    MeshHeap::Block* m_vertexBlock;
+    MeshHeap::Block* m_indexBlock;
     size_t m_vertexCount;
     size_t m_indexCount;
     bool m_ready;
+    std::vector<box3f> m_occluders;
+    float m_geometricError;
+    NodeTimeline m_timeline;
 };
 
 inline size_t VoxelMesh::GetVertexCount() const
@@ -101,14 +164,29 @@ inline size_t VoxelMesh::GetIndexCount() const
     return m_indexCount;
 }
 
+inline size_t VoxelMesh::GetMemoryUsage() const
+{
+    return (m_vertexCount * sizeof(Vertex)) + (m_indexCount * sizeof(uint16_t));
+}
+
 inline ID3D11Buffer* VoxelMesh::GetVertexBuffer() const
 {
-    return m_vertexBuffer.get();
+    return m_vertexBlock ? m_meshHeap.GetBuffer(*m_vertexBlock) : nullptr;
 }
 
 inline ID3D11Buffer* VoxelMesh::GetIndexBuffer() const
 {
-    return m_indexBuffer.get();
+    return m_indexBlock ? m_meshHeap.GetBuffer(*m_indexBlock) : nullptr;
+}
+
+inline size_t VoxelMesh::GetBaseVertex() const
+{
+    return m_vertexBlock ? m_vertexBlock->offset : 0;
+}
+
+inline size_t VoxelMesh::GetStartIndex() const
+{
+    return m_indexBlock ? m_indexBlock->offset : 0;
 }
 
 inline bool VoxelMesh::IsReady() const
@@ -116,5 +194,25 @@ inline bool VoxelMesh::IsReady() const
     return m_ready;
 }
 
+inline const std::vector<box3f>& VoxelMesh::GetOccluders() const
+{
+    return m_occluders;
+}
+
+inline void VoxelMesh::SetGeometricError(float error)
+{
+    m_geometricError = error;
+}
+
+inline float VoxelMesh::GetGeometricError() const
+{
+    return m_geometricError;
+}
+
+inline NodeTimeline& VoxelMesh::GetTimeline()
+{
+    return m_timeline;
+}
+
 
 #endif  // __NYX_VOXELMESH_H__
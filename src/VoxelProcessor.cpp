@@ -5,17 +5,61 @@
 
 #include "Prefix.h"
 #include "GraphicsDevice.h"
+#include "NodeTimeline.h"
 #include "Profiler.h"
+#include "ScratchArena.h"
+#include "VoxelField.h"
 #include "VoxelMesh.h"
 #include "VoxelManager.h"
 #include "VoxelProcessor.h"
 
 #include "MarchingCubes.inl"
 
+//
+//  Totals of useful and cancelled chunk jobs, reported at exit.
+//
+static struct JobStatistics
+{
+    size_t completedCount;
+    size_t cancelledCount[VoxelProcessor::Stage_Count];
+
+    JobStatistics()
+    : completedCount(0)
+    {
+        std::fill(cancelledCount, cancelledCount + VoxelProcessor::Stage_Count, 0);
+    }
+
+    ~JobStatistics()
+    {
+        size_t cancelled = 0;
+        for (size_t i = 0; i < VoxelProcessor::Stage_Count; ++i)
+        {
+            cancelled += cancelledCount[i];
+        }
+        if (!completedCount && !cancelled)
+        {
+            return;
+        }
+        char buf[512];
+        sprintf_s(buf, "Completed: %u\nCancelled before readback: %u\nCancelled before meshing: %u\nCancelled before copy: %u\nWasted: %.02f%%\n",
+                       static_cast<uint>(completedCount),
+                       static_cast<uint>(cancelledCount[VoxelProcessor::Stage_ReadVoxelField]),
+                       static_cast<uint>(cancelledCount[VoxelProcessor::Stage_GenerateMesh]),
+                       static_cast<uint>(cancelledCount[VoxelProcessor::Stage_CopyMesh]),
+                       (static_cast<double>(cancelled) / static_cast<double>(completedCount + cancelled)) * 100.0);
+        OutputDebugStringA("======================= JOB STATISTICS =====================\n");
+        OutputDebugStringA(buf);
+    }
+} s_jobStatistics;
+
 std::weak_ptr<VoxelProcessor::SharedProperties> VoxelProcessor::m_sharedWeakPtr;
 
 VoxelProcessor::VoxelProcessor(GraphicsDevice& graphicsDevice)
 : m_graphicsDevice(graphicsDevice),
+  m_activeCellCount(0),
+  m_cellsAreReady(false),
+  m_voxelField(nullptr),
+  m_cellList(nullptr),
   m_verticesAreReady(false),
   m_indicesAreReady(false)
 {
@@ -108,90 +152,10 @@ VoxelProcessor::VoxelProcessor(GraphicsDevice& graphicsDevice)
                                         NULL,
                                         AttachPtr(m_shared->genVoxelsPS))); 
 
-
-        //
-        //  Create the list_cells vertex shader and input layout.
-        //
-        const char* path = "assets/shaders/marching_cubes_list_cells_vs.hlsl";
-        D3DCHECK(D3DX11CompileFromFileA(path,                               //  pSrcFile
-                                        NULL,                               //  pDefines
-                                        NULL,                               //  pInclude
-                                        "main",                             //  pFunctionName
-                                        "vs_4_0",                           //  pProfile
-                                        0,                                  //  Flags1
-                                        0,                                  //  Flags2
-                                        NULL,                               //  pPump
-                                        AttachPtr(bytecode),                //  ppShader
-                                        AttachPtr(errors),                  //  ppErrorMsgs
-                                        NULL));                             //  pHResult
-        D3DCHECK(m_graphicsDevice.GetD3DDevice().CreateVertexShader(
-                                        bytecode->GetBufferPointer(),
-                                        bytecode->GetBufferSize(),
-                                        NULL,
-                                        AttachPtr(m_shared->listCellsVS)));
-
-        D3D11_INPUT_ELEMENT_DESC listCellsInputElements[] =
-        {
-            {
-                "POSITION",                                                 //  SemanticName
-                0,                                                          //  SemanticIndex
-                DXGI_FORMAT_R32_UINT,                                       //  Format
-                0,                                                          //  InputSlot
-                0,                                                          //  AlignedByteOffset
-                D3D11_INPUT_PER_VERTEX_DATA,                                //  InputSlotClass
-                0                                                           //  InstanceDataStepRate
-            }
-        };
-        D3DCHECK(m_graphicsDevice.GetD3DDevice().CreateInputLayout(
-                                        listCellsInputElements,
-                                        sizeof(listCellsInputElements) / sizeof(listCellsInputElements[0]),
-                                        bytecode->GetBufferPointer(),
-                                        bytecode->GetBufferSize(),
-                                        AttachPtr(m_shared->listCellsLayout)));
-
-        //
-        //  Create the list_cells geometry shader.
-        //
-        path = "assets/shaders/marching_cubes_list_cells_gs.hlsl";
-        D3DCHECK(D3DX11CompileFromFileA(path,                               //  pSrcFile
-                                        NULL,                               //  pDefines
-                                        NULL,                               //  pInclude
-                                        "main",                             //  pFunctionName
-                                        "gs_4_0",                           //  pProfile
-                                        0,                                  //  Flags1
-                                        0,                                  //  Flags2
-                                        NULL,                               //  pPump
-                                        AttachPtr(bytecode),                //  ppShader
-                                        AttachPtr(errors),                  //  ppErrorMsgs
-                                        NULL));                             //  pHResult
-        
-        D3D11_SO_DECLARATION_ENTRY listCellsGSStreamOutDecl[] =
-        {
-            {
-                0,                                                          //  Stream
-                "POSITION",                                                 //  SemanticName
-                0,                                                          //  SemanticIndex
-                0,                                                          //  StartComponent
-                1,                                                          //  ComponentCount
-                0                                                           //  OutputSlot
-            }
-        };
-        size_t listCellsGSStreamOutStride = sizeof(uint32_t);
-        D3DCHECK(m_graphicsDevice.GetD3DDevice().CreateGeometryShaderWithStreamOutput(
-                                    bytecode->GetBufferPointer(),           //  pShaderBytecode
-                                    bytecode->GetBufferSize(),              //  BytecodeLength
-                                    listCellsGSStreamOutDecl,           //  pSODeclaration
-                                    1,                                      //  NumEntries
-                                    &listCellsGSStreamOutStride,        //  pBufferStrides
-                                    1,                                      //  NumStrides
-                                    0,                                      //  RasterizedStream
-                                    NULL,                                   //  pClassLinkage
-                                    AttachPtr(m_shared->listCellsGS))); //  ppGeometryShader
-
         //
         //  Create the list_vertices vertex shader and input layout.
         //
-        path = "assets/shaders/marching_cubes_list_vertices_vs.hlsl";
+        const char* path = "assets/shaders/marching_cubes_list_vertices_vs.hlsl";
         D3DCHECK(D3DX11CompileFromFileA(path,                               //  pSrcFile
                                         NULL,                               //  pDefines
                                         NULL,                               //  pInclude
@@ -505,7 +469,7 @@ VoxelProcessor::VoxelProcessor(GraphicsDevice& graphicsDevice)
 
 
         //
-        //  Create the cell buffer used as input for list_cells.
+        //  Create the cell buffer used as input for gen_voxels.
         //
         const size_t MaxCells = CellDimensions.x * CellDimensions.y * CellDimensions.z;
         std::vector<uint32_t> cells(MaxCells);
@@ -731,7 +695,7 @@ VoxelProcessor::VoxelProcessor(GraphicsDevice& graphicsDevice)
     }
 
     //
-    //  Create the cell marker buffer used as output for list_cells and input for
+    //  Create the cell marker buffer filled by ListCells() and used as input for
     //  list_vertices and gen_indices.
     //
     const size_t MaxCells = CellDimensions.x * CellDimensions.y * CellDimensions.z;
@@ -739,7 +703,7 @@ VoxelProcessor::VoxelProcessor(GraphicsDevice& graphicsDevice)
     {
         MaxCells * sizeof(uint32_t),                                    //  ByteWidth
         D3D11_USAGE_DEFAULT,                                            //  Usage
-        D3D11_BIND_STREAM_OUTPUT | D3D11_BIND_VERTEX_BUFFER,            //  BindFlags
+        D3D11_BIND_VERTEX_BUFFER,                                       //  BindFlags
         0,                                                              //  CPUAccessFlags
         0,                                                              //  MiscFlags
         0                                                               //  StructureByteStride
@@ -1015,12 +979,39 @@ VoxelProcessor::VoxelProcessor(GraphicsDevice& graphicsDevice)
                                                 static_cast<float>(CellDimensions.y),
                                                 static_cast<float>(CellDimensions.z),
                                                 1.0f);
+    m_shaderConstants.voxelFieldSize = XMFLOAT4(32.0f,
+                                                32.0f,
+                                                32.0f,
+                                                1.0f);
+    m_shaderConstants.voxelFieldSubSize = XMFLOAT4(30.0f,
+                                                   30.0f,
+                                                   30.0f,
+                                                   1.0f);
+    m_shaderConstants.voxelFieldOffset = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
     memcpy(m_shaderConstants.edgeCellOffsets, EdgeCellOffsets, sizeof(EdgeCellOffsets));
     memcpy(m_shaderConstants.EdgeXOffsets, EdgeXOffsets, sizeof(EdgeXOffsets));
+
+    //
+    //  Create the arena for the CPU-side buffers. It starts out large enough
+    //  for a chunk's density field and grows if a chunk has unusually many
+    //  active cells; after that chunks are processed without heap allocations.
+    //
+    assert(CellDimensions.x == ChunkField::CellCount &&
+           CellDimensions.y == ChunkField::CellCount &&
+           CellDimensions.z == ChunkField::CellCount);
+    m_scratchArena.reset(new ScratchArena(1024 * 1024));
 }
 
 VoxelProcessor::~VoxelProcessor()
 {
+    char buf[512];
+    sprintf_s(buf, "Chunks: %u\nHeap allocations: %u\nCapacity: %u\nPeak bytes used: %u\n",
+                   static_cast<uint>(m_scratchArena->GetResetCount()),
+                   static_cast<uint>(m_scratchArena->GetHeapAllocationCount()),
+                   static_cast<uint>(m_scratchArena->GetCapacity()),
+                   static_cast<uint>(m_scratchArena->GetPeakBytesUsed()));
+    OutputDebugStringA("===================== SCRATCH ARENA ========================\n");
+    OutputDebugStringA(buf);
 }
 
 void VoxelProcessor::Process(std::shared_ptr<VoxelMesh> geometry,
@@ -1038,26 +1029,18 @@ void VoxelProcessor::Process(std::shared_ptr<VoxelMesh> geometry,
                                                1.0f);
     m_shaderConstants.chunkDimensions = size;
     m_shaderConstants.chunkDepth = depth;
-    m_shaderConstants.voxelFieldSize = XMFLOAT4(32.0f,
-                                                32.0f,
-                                                32.0f,
-                                                1.0f);
-    m_shaderConstants.voxelFieldSubSize = XMFLOAT4(30.0f,
-                                                   30.0f,
-                                                   30.0f,
-                                                   1.0f);
-    m_shaderConstants.voxelFieldOffset = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 
     static Profiler profiler("VoxelProcessor::Generate()");
     profiler.Begin();
 
+    //  Only the density field is generated here; the remaining passes are
+    //  run from Update() once it has been read back and the cells listed.
+    m_cellsAreReady = false;
+    m_scratchArena->Reset();
+    m_voxelField = nullptr;
+    m_cellList = nullptr;
     UpdateConstantBuffer();
     GenerateVoxels();
-    ListCells();
-	ListVertices();
-	GenerateVertices();
-	SplatVertices();
-	GenerateIndices();
 
     profiler.End();
 }
@@ -1068,6 +1051,46 @@ void VoxelProcessor::Update()
 
     if (m_geometryPtr)
     {
+        if (!m_cellsAreReady)
+        {
+            //  The readback is skipped, not waited for; the next job's copy to
+            //  the staging texture supersedes this one.
+            if (CancelIfDropped(Stage_ReadVoxelField) || !ReadVoxelField())
+            {
+                return;
+            }
+            ListCells();
+            ListOccluders();
+            MeasureGeometricError();
+            m_cellsAreReady = true;
+            m_geometryPtr->GetTimeline().Mark(NodeTimeline::Event_DensityDone);
+
+            //  If no cells intersect the isosurface then the mesh is empty and
+            //  there is no need to run the rest of the pipeline.
+            if (!m_activeCellCount)
+            {
+                m_geometryPtr->Resize(0, 0);
+                m_geometryPtr->SetReady(true);
+                m_geometryPtr->GetTimeline().Mark(NodeTimeline::Event_Uploaded);
+                m_geometryPtr.reset();
+                s_jobStatistics.completedCount++;
+                return;
+            }
+
+            if (CancelIfDropped(Stage_GenerateMesh))
+            {
+                return;
+            }
+            ListVertices();
+            GenerateVertices();
+            SplatVertices();
+            GenerateIndices();
+            return;
+        }
+        if (CancelIfDropped(Stage_CopyMesh))
+        {
+            return;
+        }
         if (!m_vertexCount)
         {
             D3D11_QUERY_DATA_SO_STATISTICS stats;
@@ -1095,65 +1118,20 @@ void VoxelProcessor::Update()
 
         if (m_verticesAreReady && m_indicesAreReady)
         {  
-            //
-            //  Copy the results from the staging texture to the VoxelField object.
-            //
-            /*
-            D3D11_MAPPED_SUBRESOURCE map;
-            context.Map(m_stagingTexture.get(), 0, D3D11_MAP_READ, 0, &map);
-            memcpy(m_nodePtr->GetFieldPtr(), map.pData, map.DepthPitch * 32);
-            context.Unmap(m_stagingTexture.get(), 0);
-            */
             //
             //  Copy the vertex and index buffers to the VoxelMesh object.
             //
+            NodeTimeline& timeline = m_geometryPtr->GetTimeline();
+            timeline.Mark(NodeTimeline::Event_MeshDone);
             m_geometryPtr->Resize(m_vertexCount, m_indexCount);
-
-            if (m_vertexCount)
-            {
-                D3D11_BOX vertexSrcBox =
-                {
-                    0,                                                          //  left
-                    0,                                                          //  top
-                    0,                                                          //  front
-                    m_vertexCount * sizeof(VoxelMesh::Vertex),              //  right
-                    1,                                                          //  bottom
-                    1                                                           //  back
-                };
-                context.CopySubresourceRegion(m_geometryPtr->GetVertexBuffer(), //  pDstResource
-                                              0,                                //  DstSubresource
-                                              0,                                //  DstX
-                                              0,                                //  DstY
-                                              0,                                //  DstZ
-                                              m_vertexBuffer.get(),             //  pSrcResource
-                                              0,                                //  SrcSubresource
-                                              &vertexSrcBox);                   //  pSrcBox
-            }
-
-            if (m_indexCount)
-            {
-                D3D11_BOX indexSrcBox =
-                {
-                    0,
-                    0,
-                    0,
-                    m_indexCount * sizeof(uint16_t),
-                    1,
-                    1
-                };
-                context.CopySubresourceRegion(m_geometryPtr->GetIndexBuffer(),  //  pDstResource
-                                              0,                                //  DstSubresource
-                                              0,                                //  DstX
-                                              0,                                //  DstY
-                                              0,                                //  DstZ
-                                              m_indexBuffer.get(),              //  pSrcResource
-                                              0,                                //  SrcSubresource
-                                              &indexSrcBox);                    //  pSrcBox
-            }
+            m_geometryPtr->CopyFrom(m_vertexBuffer.get(), m_indexBuffer.get());
             m_geometryPtr->SetReady(true);
+            timeline.Mark(NodeTimeline::Event_Uploaded);
             m_geometryPtr.reset();
+            m_cellsAreReady = false;
             m_verticesAreReady = false;
             m_indicesAreReady = false;
+            s_jobStatistics.completedCount++;
         }
     }
 }
@@ -1163,6 +1141,28 @@ bool VoxelProcessor::IsReady()
     return m_geometryPtr == nullptr;
 }
 
+uint3 VoxelProcessor::GetMeshCellCount()
+{
+    return uint3(CellDimensions.x - 1, CellDimensions.y - 1, CellDimensions.z - 1);
+}
+
+bool VoxelProcessor::CancelIfDropped(Stage stage)
+{
+    if (!m_geometryPtr.unique())
+    {
+        return false;
+    }
+
+    //  Queries still in flight are reissued by the next job, so they can
+    //  simply be forgotten.
+    m_geometryPtr.reset();
+    m_cellsAreReady = false;
+    m_verticesAreReady = false;
+    m_indicesAreReady = false;
+    s_jobStatistics.cancelledCount[stage]++;
+    return true;
+}
+
 void VoxelProcessor::GenerateVoxels()
 {
     static Profiler profiler("VoxelProcessor::GenerateVoxels");
@@ -1224,6 +1224,39 @@ void VoxelProcessor::GenerateVoxels()
     profiler.End();
 }
 
+bool VoxelProcessor::ReadVoxelField()
+{
+    ID3D11DeviceContext& context = m_graphicsDevice.GetD3DContext();
+
+    D3D11_MAPPED_SUBRESOURCE map;
+    HRESULT hr = context.Map(m_stagingTexture.get(),                        //  pResource
+                             0,                                             //  Subresource
+                             D3D11_MAP_READ,                                //  MapType
+                             D3D11_MAP_FLAG_DO_NOT_WAIT,                    //  MapFlags
+                             &map);                                         //  pMappedResource
+    if (hr == DXGI_ERROR_WAS_STILL_DRAWING)
+    {
+        return false;
+    }
+    D3DCHECK(hr);
+
+    static Profiler profiler("VoxelProcessor::ReadVoxelField()");
+    profiler.Begin();
+    m_voxelField = new (m_scratchArena->Allocate(sizeof(ChunkField)))
+        ChunkField(*m_scratchArena,
+                   float3(m_shaderConstants.voxelFieldSubSize.x,
+                          m_shaderConstants.voxelFieldSubSize.y,
+                          m_shaderConstants.voxelFieldSubSize.z),
+                   float3(m_shaderConstants.voxelFieldOffset.x,
+                          m_shaderConstants.voxelFieldOffset.y,
+                          m_shaderConstants.voxelFieldOffset.z));
+    m_voxelField->Load(map.pData, map.RowPitch, map.DepthPitch);
+    context.Unmap(m_stagingTexture.get(), 0);
+    profiler.End();
+
+    return true;
+}
+
 void VoxelProcessor::ListCells()
 {
     ID3D11DeviceContext& context = m_graphicsDevice.GetD3DContext();
@@ -1234,35 +1267,63 @@ void VoxelProcessor::ListCells()
     //
     //  Stage 0 (list cells)
     //
-    size_t offset = 0,
-            stride = sizeof(uint32_t);
-    ID3D11Buffer* cellBufferPtr = m_shared->cellBuffer.get();
-    ID3D11Buffer* cellMarkerBufferPtr = m_cellMarkerBuffer.get();
-    ID3D11ShaderResourceView* shaderResourceViewPtrs[] =
+    m_activeCellCount = m_voxelField->ListCells(*m_scratchArena, m_cellList);
+    if (m_activeCellCount)
     {
-        m_voxelSRV.get()
-    };
-    ID3D11SamplerState* densitySamplerPtr = m_shared->densitySampler.get();
-    ID3D11Buffer* constantBufferPtr = m_constantBuffer.get();
-    size_t cellCount = m_shaderConstants.cellCount[0] *
-                        m_shaderConstants.cellCount[1] *
-                        m_shaderConstants.cellCount[2];
+        D3D11_BOX cellDstBox =
+        {
+            0,                                                              //  left
+            0,                                                              //  top
+            0,                                                              //  front
+            m_activeCellCount * sizeof(uint32_t),                           //  right
+            1,                                                              //  bottom
+            1                                                               //  back
+        };
+        context.UpdateSubresource(m_cellMarkerBuffer.get(),                 //  pDstResource
+                                  0,                                        //  DstSubresource
+                                  &cellDstBox,                              //  pDstBox
+                                  m_cellList,                               //  pSrcData
+                                  0,                                        //  SrcRowPitch
+                                  0);                                       //  SrcDepthPitch
+    }
 
-    context.IASetVertexBuffers(0, 1, &cellBufferPtr, &stride, &offset);
-    context.IASetIndexBuffer(0, DXGI_FORMAT_R16_UINT, 0);
-    context.IASetInputLayout(m_shared->listCellsLayout.get());
-    context.IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_POINTLIST);
-    context.SOSetTargets(1, &cellMarkerBufferPtr, &offset);
-    context.VSSetShader(m_shared->listCellsVS.get(), NULL, 0);
-    context.VSSetShaderResources(0, 1, shaderResourceViewPtrs);
-    context.VSSetSamplers(0, 1, &densitySamplerPtr);
-    context.VSSetConstantBuffers(0, 1, &constantBufferPtr);
-    context.GSSetShader(m_shared->listCellsGS.get(), NULL, 0);
-    context.PSSetShader(NULL, NULL, 0);
-    context.OMSetRenderTargets(0, NULL, NULL);
-    context.OMSetDepthStencilState(m_shared->depthStencilState.get(), 0);
-    context.Draw(cellCount, 0);
-    context.SOSetTargets(0, NULL, NULL);
+    profiler.End();
+}
+
+void VoxelProcessor::ListOccluders()
+{
+    static Profiler profiler("VoxelProcessor::ListOccluders()");
+    profiler.Begin();
+
+    box3f* boxes;
+    size_t boxCount = m_voxelField->ListSolidBoxes(*m_scratchArena, boxes);
+
+    //  Scale from corner coordinates to world space, as gen_vertices does
+    float3 origin(m_shaderConstants.chunkPosition.x,
+                  m_shaderConstants.chunkPosition.y,
+                  m_shaderConstants.chunkPosition.z);
+    float3 scale(m_shaderConstants.chunkDimensions.x / (CellDimensions.x - 1),
+                 m_shaderConstants.chunkDimensions.y / (CellDimensions.y - 1),
+                 m_shaderConstants.chunkDimensions.z / (CellDimensions.z - 1));
+    for (size_t i = 0; i < boxCount; ++i)
+    {
+        boxes[i].first = origin + (boxes[i].first * scale);
+        boxes[i].second = origin + (boxes[i].second * scale);
+    }
+    m_geometryPtr->SetOccluders(boxes, boxCount);
+
+    profiler.End();
+}
+
+void VoxelProcessor::MeasureGeometricError()
+{
+    static Profiler profiler("VoxelProcessor::MeasureGeometricError()");
+    profiler.Begin();
+
+    //  Only the field within a couple of cells of the surface affects the
+    //  mesh.
+    float cellSize = m_shaderConstants.chunkDimensions.x / (CellDimensions.x - 1);
+    m_geometryPtr->SetGeometricError(m_voxelField->GetResampleError(cellSize * 2.0f));
 
     profiler.End();
 }
@@ -1288,9 +1349,6 @@ void VoxelProcessor::ListVertices()
     };
     ID3D11SamplerState* densitySamplerPtr = m_shared->densitySampler.get();
     ID3D11Buffer* constantBufferPtr = m_constantBuffer.get();
-    size_t cellCount = m_shaderConstants.cellCount[0] *
-                        m_shaderConstants.cellCount[1] *
-                        m_shaderConstants.cellCount[2];
 
     context.IASetVertexBuffers(0, 1, &cellMarkerBufferPtr, &stride, &offset);
     context.IASetIndexBuffer(0, DXGI_FORMAT_R16_UINT, 0);
@@ -1305,7 +1363,7 @@ void VoxelProcessor::ListVertices()
     context.PSSetShader(NULL, NULL, 0);
     context.OMSetRenderTargets(0, NULL, NULL);
     context.OMSetDepthStencilState(m_shared->depthStencilState.get(), 0);
-    context.DrawAuto();
+    context.Draw(m_activeCellCount, 0);
     context.SOSetTargets(0, NULL, NULL);
 
     profiler.End();
@@ -1427,9 +1485,6 @@ void VoxelProcessor::GenerateIndices()
         m_vertexMapSRV.get()
     };
     ID3D11Buffer* constantBufferPtr = m_constantBuffer.get();
-    size_t cellCount = m_shaderConstants.cellCount[0] *
-                        m_shaderConstants.cellCount[1] *
-                        m_shaderConstants.cellCount[2];
 
     context.Begin(m_indexQuery.get());
     context.IASetVertexBuffers(0, 1, &cellMarkerBufferPtr, &stride, &offset);
@@ -1444,7 +1499,7 @@ void VoxelProcessor::GenerateIndices()
     context.PSSetShader(NULL, NULL, 0);
     context.OMSetRenderTargets(0, NULL, NULL);
     context.OMSetDepthStencilState(m_shared->depthStencilState.get(), 0);
-    context.DrawAuto();
+    context.Draw(m_activeCellCount, 0);
     context.SOSetTargets(0, NULL, NULL);
 
     ID3D11ShaderResourceView* nullPtrs[] = {0, 0, 0};
@@ -10,12 +10,25 @@
 //  Forward declarations.
 //
 class GraphicsDevice;
+class ScratchArena;
+template <size_t N> class VoxelField;
 class VoxelManager;
 class VoxelMesh;
 
 class VoxelProcessor : public boost::noncopyable
 {
 public:
+    //
+    //  Stages at which an in-flight job can be cancelled.
+    //
+    enum Stage
+    {
+        Stage_ReadVoxelField,
+        Stage_GenerateMesh,
+        Stage_CopyMesh,
+        Stage_Count
+    };
+
     //
     //  Constructor.
     //
@@ -33,6 +46,10 @@ public:
     //
     //  Processes a node.
     //
+    //  The processor shares ownership of the mesh with the node. If the
+    //  processor becomes its only owner, the node has been dropped and the
+    //  job is cancelled at the next stage boundary.
+    //
     //  Parameters:
     //      [out] geometry
     //          Geometry to process.
@@ -56,7 +73,23 @@ public:
     //
     bool IsReady();
 
+    //
+    //  Returns the number of cells along each axis of a chunk's mesh, which
+    //  is one fewer than the density samples.
+    //
+    static uint3 GetMeshCellCount();
+
 private:
+    //
+    //  Checks whether the node the current job belongs to has been dropped,
+    //  and if so abandons the job.
+    //
+    //  Parameters:
+    //      [in] stage
+    //          Stage the job is about to enter.
+    //
+    bool CancelIfDropped(Stage stage);
+
     //
     //  Updates the constant buffer.
     //
@@ -68,10 +101,30 @@ private:
     void GenerateVoxels();
 
     //
-    //  Runs the list_cells pass.
+    //  Reads the density field back from the staging texture.
+    //
+    //  Returns false if the GPU has not finished generating it yet.
+    //
+    bool ReadVoxelField();
+
+    //
+    //  Lists the cells intersecting the isosurface on the CPU and uploads
+    //  them to the cell marker buffer.
     //
     void ListCells();
 
+    //
+    //  Lists the solid boxes of the density field and stores them on the
+    //  mesh as occluders.
+    //
+    void ListOccluders();
+
+    //
+    //  Estimates the geometric error of the chunk from its density field and
+    //  stores it on the mesh.
+    //
+    void MeasureGeometricError();
+
 	//
 	//	Runs the list_vertices pass.
 	//
@@ -102,10 +155,6 @@ private:
         boost::intrusive_ptr<ID3D11GeometryShader> genVoxelsGS;
         boost::intrusive_ptr<ID3D11PixelShader> genVoxelsPS;
         
-        boost::intrusive_ptr<ID3D11InputLayout> listCellsLayout;
-        boost::intrusive_ptr<ID3D11VertexShader> listCellsVS;
-        boost::intrusive_ptr<ID3D11GeometryShader> listCellsGS;
-
         boost::intrusive_ptr<ID3D11InputLayout> listVerticesLayout;
         boost::intrusive_ptr<ID3D11VertexShader> listVerticesVS;
         boost::intrusive_ptr<ID3D11GeometryShader> listVerticesGS;
@@ -156,6 +205,7 @@ private:
     static const int TriTable[256][16];
     static std::weak_ptr<SharedProperties> m_sharedWeakPtr;
     static const uint3 CellDimensions;
+    typedef VoxelField<32> ChunkField;
     size_t m_width;
     size_t m_height;
     size_t m_depth;
@@ -164,9 +214,14 @@ private:
     ShaderConstants m_shaderConstants;
     size_t m_vertexCount;
 	size_t m_indexCount;
+    size_t m_activeCellCount;
+    bool m_cellsAreReady;
     bool m_verticesAreReady;
     bool m_indicesAreReady;
     std::shared_ptr<VoxelMesh> m_geometryPtr;
+    std::unique_ptr<ScratchArena> m_scratchArena;
+    ChunkField* m_voxelField;
+    uint32_t* m_cellList;
 
     boost::intrusive_ptr<ID3D11Buffer> m_cellMarkerBuffer;
     boost::intrusive_ptr<ID3D11Buffer> m_vertexMarkerBuffer;
@@ -7,14 +7,17 @@
 #include "Camera.h"
 #include "GraphicsDevice.h"
 #include "RenderContext.h"
+#include "RenderQueue.h"
 #include "SceneManager.h"
+#include "UploadRing.h"
 #include "VoxelMesh.h"
 #include "VoxelRenderer.h"
 
 std::weak_ptr<VoxelRenderer::SharedProperties> VoxelRenderer::m_sharedWeakPtr;
 
 VoxelRenderer::VoxelRenderer(GraphicsDevice& graphicsDevice)
-: m_graphicsDevice(graphicsDevice)
+: m_graphicsDevice(graphicsDevice),
+  m_renderQueue(new RenderQueue())
 {
     if (!m_sharedWeakPtr.expired())
     {
@@ -74,6 +77,15 @@ VoxelRenderer::VoxelRenderer(GraphicsDevice& graphicsDevice)
                 16,                                                         //  AlignedByteOffset
                 D3D11_INPUT_PER_VERTEX_DATA,                                //  InputSlotClass
                 0                                                           //  InstanceDataStepRate
+            },
+            {
+                "INSTANCE",                                                 //  SemanticName
+                0,                                                          //  SemanticIndex
+                DXGI_FORMAT_R32G32B32A32_FLOAT,                             //  Format
+                1,                                                          //  InputSlot
+                0,                                                          //  AlignedByteOffset
+                D3D11_INPUT_PER_INSTANCE_DATA,                              //  InputSlotClass
+                1                                                           //  InstanceDataStepRate
             }
         };
         D3DCHECK(m_graphicsDevice.GetD3DDevice().CreateInputLayout(
@@ -270,9 +282,8 @@ void VoxelRenderer::Draw(const VoxelMesh& geometry, float3 position)
     {
         &geometry,
         position,
-        0,
         1.0f,
-        true
+        RenderQueue::Pass_Opaque
     };
     m_renderOps.push_back(op);
 }
@@ -283,11 +294,10 @@ void VoxelRenderer::DrawGapFiller(const VoxelMesh& geometry, float3 position)
     {
         &geometry,
         position,
-        0,
         1.0f,
-        true
+        RenderQueue::Pass_GapFiller
     };
-    m_gapFillerRenderOps.push_back(op);    
+    m_renderOps.push_back(op);    
 }
 
 void VoxelRenderer::DrawTransparent(const VoxelMesh& geometry, float3 position, float alpha)
@@ -296,134 +306,123 @@ void VoxelRenderer::DrawTransparent(const VoxelMesh& geometry, float3 position,
     {
         &geometry,
         position,
-        0,
         alpha,
-        false
+        RenderQueue::Pass_Transparent
     };
-    m_transparentRenderOps.push_back(op);    
+    m_renderOps.push_back(op);    
 }
 
 void VoxelRenderer::Flush(RenderContext& renderContext,
                           const SceneConstants& sceneConstants)
 {
-    //  Set up global shader constants
-    m_constants.projectionViewMatrix = sceneConstants.viewMatrix *
-                                       sceneConstants.projectionMatrix;
-    m_constants.clipPlane = sceneConstants.clipPlane;
+    if (m_renderOps.empty())
+    {
+        return;
+    }
 
-    //  Calculate camera distances for all queued render ops
+    //  Sort all queued render ops at once by pass, then by camera distance
+    //  (front to back for opaque render ops, back to front for transparent)
     float3 cameraPos = sceneConstants.cameraPos;
+    m_renderQueue->Clear();
     for (size_t i = 0; i < m_renderOps.size(); ++i)
     {
         float3 diff = m_renderOps[i].position - cameraPos;
-        m_renderOps[i].distance2 = Dot(diff, diff);
+        m_renderQueue->Add(static_cast<RenderQueue::Pass>(m_renderOps[i].pass), Dot(diff, diff));
     }
-    for (size_t i = 0; i < m_gapFillerRenderOps.size(); ++i)
-    {
-        float3 diff = m_gapFillerRenderOps[i].position - cameraPos;
-        m_gapFillerRenderOps[i].distance2 = Dot(diff, diff);
-    }
-    for (size_t i = 0; i < m_transparentRenderOps.size(); ++i)
-    {
-        float3 diff = m_transparentRenderOps[i].position - cameraPos;
-        m_transparentRenderOps[i].distance2 = Dot(diff, diff);
-    }
-    
-    //  Sort by camera distance (front to back for opaque render ops,
-    //  back to front for transparent)
-    auto transparentSorter = [](const RenderOp& lhs, const RenderOp& rhs)
-    {
-        return lhs.distance2 > rhs.distance2;
-    };
-    auto opaqueSorter = [](const RenderOp& lhs, const RenderOp& rhs)
+    m_renderQueue->Sort();
+
+    //  Write the per-frame constants and the per-op instance data once
+    m_constants.projectionViewMatrix = sceneConstants.viewMatrix *
+                                       sceneConstants.projectionMatrix;
+    m_constants.clipPlane = sceneConstants.clipPlane;
+    memcpy(renderContext.Map(m_constantBuffer.get(), D3D11_MAP_WRITE_DISCARD),
+           &m_constants,
+           sizeof(m_constants));
+    renderContext.Unmap(m_constantBuffer.get());
+    size_t instanceOffset = UploadInstances(renderContext);
+
+    //  Bind the state shared by every render op
+    ID3D11ShaderResourceView* shaderResourceViewPtrs[] =
     {
-        return lhs.distance2 < rhs.distance2;
+        m_shared->textureViews[0].get(),
+        m_shared->textureViews[1].get(),
+        m_shared->textureViews[2].get(),
+        m_shared->textureViews[3].get(),
+        m_shared->textureViews[4].get(),
+        m_shared->textureViews[5].get(),
+        m_shared->textureViews[6].get()
     };
-    std::sort(m_renderOps.begin(), m_renderOps.end(), opaqueSorter);
-    std::sort(m_gapFillerRenderOps.begin(), m_gapFillerRenderOps.end(), opaqueSorter);
-    std::sort(m_transparentRenderOps.begin(), m_transparentRenderOps.end(), transparentSorter);
+    renderContext.SetInputLayout(m_shared->inputLayout.get(), D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    renderContext.SetVertexBuffer(1,
+                                  m_graphicsDevice.GetUploadRing().GetBuffer(),
+                                  sizeof(float4),
+                                  instanceOffset);
+    renderContext.SetShaders(m_shared->vertexShader.get(), NULL, m_shared->pixelShader.get());
+    renderContext.SetConstantBuffer(0, m_constantBuffer.get());
+    renderContext.SetShaderResources(7, shaderResourceViewPtrs);
+    renderContext.SetSampler(0, m_shared->samplerState.get());
 
     //  Finally time to draw them
+    size_t i = 0;
     renderContext.PushDepthStencilState(m_shared->depthStencilState);
-    for (size_t i = 0; i < m_renderOps.size(); i++)
-    {
-        Draw(m_renderOps[i]);
-    }
-    m_renderOps.clear();
+    i = DrawPass(renderContext, i, RenderQueue::Pass_Opaque);
     renderContext.PopDepthStencilState();
 
     renderContext.PushDepthStencilState(m_shared->fillGapsDepthStencilState);
-    for (size_t i = 0; i < m_gapFillerRenderOps.size(); ++i)
-    {
-        Draw(m_gapFillerRenderOps[i]);
-    }
-    m_gapFillerRenderOps.clear();
+    i = DrawPass(renderContext, i, RenderQueue::Pass_GapFiller);
     renderContext.PopDepthStencilState();
 
     renderContext.PushDepthStencilState(m_shared->transparentDepthStencilState);
     renderContext.PushBlendState(m_shared->blendState);
-    for (size_t i = 0; i < m_transparentRenderOps.size(); i++)
-    {
-        Draw(m_transparentRenderOps[i]);
-    }
-    m_transparentRenderOps.clear();
+    i = DrawPass(renderContext, i, RenderQueue::Pass_Transparent);
     renderContext.PopBlendState();
     renderContext.PopDepthStencilState();
+    m_renderOps.clear();
 }
 
-void VoxelRenderer::Draw(const RenderOp& op)
+size_t VoxelRenderer::DrawPass(RenderContext& renderContext, size_t start, uint32_t pass)
 {
-    ID3D11DeviceContext& context = m_graphicsDevice.GetD3DContext();
-
-    //
-    //  Update the constant buffer.
-    //
-    m_constants.worldMatrix = float4x4::Translation(op.position);
-    m_constants.alpha[0] = op.alpha;
-
-    D3D11_MAPPED_SUBRESOURCE map;
-    D3DCHECK(m_graphicsDevice.GetD3DContext().Map(m_constantBuffer.get(),   //  pResource
-                                                 0,                         //  Subresource
-                                                 D3D11_MAP_WRITE_DISCARD,   //  MapType
-                                                 0,                         //  MapFlags
-                                                 &map));                    //  pMappedResource
-    memcpy(map.pData, &m_constants, sizeof(m_constants));
-    m_graphicsDevice.GetD3DContext().Unmap(m_constantBuffer.get(), 0);
-
-    //
-    //  Execute the render op.
-    //
-    ID3D11Buffer* vertexBufferPtr = op.geometry->GetVertexBuffer();
-    size_t offset = 0,
-           stride = sizeof(VoxelMesh::Vertex);
-    ID3D11ShaderResourceView* shaderResourceViewPtrs[] =
+    //  Meshes share the mesh heap's pages, so the buffers only need binding
+    //  when the page changes
+    ID3D11Buffer* vertexBuffer = nullptr;
+    ID3D11Buffer* indexBuffer = nullptr;
+    size_t i = start, count = m_renderQueue->GetCount();
+    for (; i < count && m_renderQueue->GetPass(i) == pass; ++i)
     {
-        m_shared->textureViews[0].get(),
-        m_shared->textureViews[1].get(),
-        m_shared->textureViews[2].get(),
-        m_shared->textureViews[3].get(),
-        m_shared->textureViews[4].get(),
-        m_shared->textureViews[5].get(),
-        m_shared->textureViews[6].get()
-    };
-    ID3D11SamplerState* samplerPtr = m_shared->samplerState.get();
-
-    context.IASetVertexBuffers(0, 1, &vertexBufferPtr, &stride, &offset);
-    context.IASetIndexBuffer(op.geometry->GetIndexBuffer(), DXGI_FORMAT_R16_UINT, 0);
-    context.IASetInputLayout(m_shared->inputLayout.get());
-    context.IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
-    ID3D11Buffer* constantBufferPtr = m_constantBuffer.get();
-    context.VSSetConstantBuffers(0, 1, &constantBufferPtr);
-    context.VSSetShader(m_shared->vertexShader.get(), NULL, 0);
-
-    context.GSSetShader(NULL, NULL, 0);
-
-    context.PSSetShader(m_shared->pixelShader.get(), NULL, 0);
-    context.PSSetConstantBuffers(0, 1, &constantBufferPtr);
-    context.PSSetShaderResources(0, 7, shaderResourceViewPtrs);
-    context.PSSetSamplers(0, 1, &samplerPtr);
+        const VoxelMesh& geometry = *m_renderOps[m_renderQueue->GetIndex(i)].geometry;
+        if (geometry.GetVertexBuffer() != vertexBuffer)
+        {
+            vertexBuffer = geometry.GetVertexBuffer();
+            renderContext.SetVertexBuffer(0, vertexBuffer, sizeof(VoxelMesh::Vertex));
+        }
+        if (geometry.GetIndexBuffer() != indexBuffer)
+        {
+            indexBuffer = geometry.GetIndexBuffer();
+            renderContext.SetIndexBuffer(indexBuffer, DXGI_FORMAT_R16_UINT);
+        }
 
-    context.DrawIndexed(op.geometry->GetIndexCount(), 0, 0);  
+        //  The instance data is in drawing order, so the render op's
+        //  position in the queue selects its instance data
+        renderContext.DrawIndexedInstanced(geometry.GetIndexCount(),
+                                           1,
+                                           geometry.GetStartIndex(),
+                                           geometry.GetBaseVertex(),
+                                           i);
+    }
+    return i;
+}
 
+size_t VoxelRenderer::UploadInstances(RenderContext& renderContext)
+{
+    size_t count = m_renderQueue->GetCount();
+    m_instances.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const RenderOp& op = m_renderOps[m_renderQueue->GetIndex(i)];
+        m_instances[i] = float4(op.position, op.alpha);
+    }
+    return m_graphicsDevice.GetUploadRing().Upload(renderContext,
+                                                   m_instances.data(),
+                                                   count * sizeof(float4),
+                                                   sizeof(float4));
 }
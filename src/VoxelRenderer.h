@@ -12,6 +12,7 @@
 class Camera;
 class GraphicsDevice;
 class RenderContext;
+class RenderQueue;
 class SceneConstants;
 class VoxelMesh;
 
@@ -48,6 +49,10 @@ public:
     //
     //  Flushes queued render ops.
     //
+    //  The position and alpha of every render op are uploaded at once, and
+    //  the shared state is bound once, so that drawing a mesh only binds its
+    //  vertex and index buffers.
+    //
     //  Parameters:
     //      [in] renderContext
     //          Render context.
@@ -62,15 +67,26 @@ private:
     {
         const VoxelMesh* geometry;
         float3 position;
-        float distance2;
         float alpha;
-        bool gapFiller;
+        uint32_t pass;
     };
 
     //
-    //  Implements the actual drawing of voxel meshes.
+    //  Draws the render ops of one pass, starting at a position in the render
+    //  queue.
+    //
+    //  Returns:
+    //      The position of the first render op of the next pass.
+    //
+    size_t DrawPass(RenderContext& renderContext, size_t start, uint32_t pass);
+
+    //
+    //  Uploads the instance data of every queued render op, in drawing order.
+    //
+    //  Returns:
+    //      The offset of the instance data in the upload ring.
     //
-    void Draw(const RenderOp& renderOp);
+    size_t UploadInstances(RenderContext& renderContext);
 
     //
     //  Properties.
@@ -90,8 +106,6 @@ private:
     struct ShaderConstants
     {
         float4x4 projectionViewMatrix;
-        float4x4 worldMatrix;
-        float4 alpha;
         float4 clipPlane;
     };
     static std::weak_ptr<SharedProperties> m_sharedWeakPtr;
@@ -100,8 +114,8 @@ private:
     boost::intrusive_ptr<ID3D11Buffer> m_constantBuffer;
     ShaderConstants m_constants;
     std::vector<RenderOp> m_renderOps;
-    std::vector<RenderOp> m_transparentRenderOps;
-    std::vector<RenderOp> m_gapFillerRenderOps;
+    std::vector<float4> m_instances;
+    std::unique_ptr<RenderQueue> m_renderQueue;
 };
 
 #endif  // __NYX_VOXELRENDERER_H__
@@ -146,12 +146,24 @@ void WaterManager::PreDraw(RenderContext& renderContext, const Camera& camera)
     renderContext.PushViewport(viewport);
     renderContext.PushRasterizerState(m_reflectionRS.get());
 
+    SceneConstants sceneConstants = GetReflectionConstants(camera);
+    m_preventDrawing = true;
+    m_sceneManager.DrawStage(renderContext, sceneConstants);
+    m_preventDrawing = false;
+
+    renderContext.PopRasterizerState();
+    renderContext.PopViewport();
+    renderContext.PopRenderTarget();
+}
+
+SceneConstants WaterManager::GetReflectionConstants(const Camera& camera)
+{
     SceneConstants sceneConstants;
     sceneConstants.projectionMatrix = camera.GetProjectionMatrix();
     sceneConstants.viewMatrix = camera.GetViewMatrix();
     sceneConstants.cameraPos = camera.GetPosition();
     sceneConstants.clipPlane = float4(0, 1.0f, 0, 0);
-    sceneConstants.lowDetail = true;
+    sceneConstants.view = SceneView_Reflection;
     
     //  Mirror the view matrix along the water plane
     XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(&sceneConstants.viewMatrix),
@@ -159,14 +171,7 @@ void WaterManager::PreDraw(RenderContext& renderContext, const Camera& camera)
                                      XMLoadFloat4x4(reinterpret_cast<XMFLOAT4X4*>(&sceneConstants.viewMatrix))));
     float4x4 combinedMatrix = sceneConstants.viewMatrix * sceneConstants.projectionMatrix;
     sceneConstants.frustum = combinedMatrix;
-
-    m_preventDrawing = true;
-    m_sceneManager.DrawStage(renderContext, sceneConstants);
-    m_preventDrawing = false;
-
-    renderContext.PopRasterizerState();
-    renderContext.PopViewport();
-    renderContext.PopRenderTarget();
+    return sceneConstants;
 }
 
 void WaterManager::Draw(RenderContext& renderContext,
@@ -43,6 +43,13 @@ public:
     void PreDraw(RenderContext& renderContext,
                  const Camera& camera);
 
+    //
+    //  Returns the scene constants for drawing the reflection of the scene
+    //  in the water plane, as seen from a camera. Everything below the plane
+    //  is clipped.
+    //
+    static SceneConstants GetReflectionConstants(const Camera& camera);
+
 private:
     //
     //  Properties.
@@ -293,8 +293,6 @@ void WaterRenderer::Draw(RenderContext& renderContext,
                          const SceneConstants& sceneConstants,
                          ID3D11ShaderResourceView& reflectionSrv)
 {
-    ID3D11DeviceContext& context = m_graphicsDevice.GetD3DContext();
-    
     //
     //  Update the constant buffer.
     //
@@ -302,52 +300,34 @@ void WaterRenderer::Draw(RenderContext& renderContext,
     m_shaderConstants.projectionMatrix = sceneConstants.projectionMatrix;
     m_shaderConstants.cameraPos = sceneConstants.cameraPos;
     
-    D3D11_MAPPED_SUBRESOURCE map;
-    D3DCHECK(m_graphicsDevice.GetD3DContext().Map(m_constantBuffer.get(),   //  pResource
-                                                 0,                         //  Subresource
-                                                 D3D11_MAP_WRITE_DISCARD,   //  MapType
-                                                 0,                         //  MapFlags
-                                                 &map));                    //  pMappedResource
-    memcpy(map.pData, &m_shaderConstants, sizeof(m_shaderConstants));
-    m_graphicsDevice.GetD3DContext().Unmap(m_constantBuffer.get(), 0);
+    memcpy(renderContext.Map(m_constantBuffer.get(), D3D11_MAP_WRITE_DISCARD),
+           &m_shaderConstants,
+           sizeof(m_shaderConstants));
+    renderContext.Unmap(m_constantBuffer.get());
 
     //
     //  Execute the render op.
     //
-    ID3D11Buffer* vertexBufferPtr = m_shared->vertexBuffer.get();
-    size_t offset = 0,
-           stride = sizeof(Vertex);
     ID3D11ShaderResourceView* srvs[] =
     {
         m_shared->noiseTextureView.get(),
         &reflectionSrv
     };
-    ID3D11SamplerState* samplers[] =
-    {
-        m_shared->noiseSampler.get()
-    };
-
-    context.IASetVertexBuffers(0, 1, &vertexBufferPtr, &stride, &offset);
-    context.IASetIndexBuffer(m_shared->indexBuffer.get(), DXGI_FORMAT_R16_UINT, 0);
-    context.IASetInputLayout(m_shared->inputLayout.get());
-    context.IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
-    
-    ID3D11Buffer* constantBufferPtr = m_constantBuffer.get();
-    context.VSSetShaderResources(0, sizeof(srvs) / sizeof(srvs[0]), srvs);
-    context.VSSetSamplers(0, sizeof(samplers) / sizeof(samplers[0]), samplers);
-    context.VSSetConstantBuffers(0, 1, &constantBufferPtr);
-    context.VSSetShader(m_shared->vertexShader.get(), NULL, 0);
-    
-    context.GSSetShader(NULL, NULL, 0);
 
-    context.PSSetShader(m_shared->pixelShader.get(), NULL, 0);
-    context.PSSetShaderResources(0, sizeof(srvs) / sizeof(srvs[0]), srvs);
-    context.PSSetSamplers(0, sizeof(samplers) / sizeof(samplers[0]), samplers);
+    renderContext.SetVertexBuffer(0, m_shared->vertexBuffer.get(), sizeof(Vertex));
+    renderContext.SetIndexBuffer(m_shared->indexBuffer.get(), DXGI_FORMAT_R16_UINT);
+    renderContext.SetInputLayout(m_shared->inputLayout.get(), D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+    renderContext.SetShaders(m_shared->vertexShader.get(), NULL, m_shared->pixelShader.get());
+    renderContext.SetConstantBuffer(0, m_constantBuffer.get());
+    renderContext.SetVertexShaderResources(sizeof(srvs) / sizeof(srvs[0]), srvs);
+    renderContext.SetVertexSampler(0, m_shared->noiseSampler.get());
+    renderContext.SetShaderResources(sizeof(srvs) / sizeof(srvs[0]), srvs);
+    renderContext.SetSampler(0, m_shared->noiseSampler.get());
     
     renderContext.PushRasterizerState(m_shared->rasterizerState);
     renderContext.PushBlendState(m_shared->blendState);
     
-    context.DrawIndexed(m_shared->indexCount, 0, 0);
+    renderContext.DrawIndexed(m_shared->indexCount, 0, 0);
 
     renderContext.PopBlendState();
     renderContext.PopRasterizerState();